@@ -1,7 +1,9 @@
 #ifndef ALPINO_COMPACT_CORPUSREADER_HH
 #define ALPINO_COMPACT_CORPUSREADER_HH
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 
@@ -22,10 +24,41 @@ public:
     CompactCorpusReader(std::string const &dataFilename, std::string const &indexFilename);
     virtual ~CompactCorpusReader();
 
+    /**
+     * Statistics of the cache of decompressed data chunks, which is
+     * shared by all compact corpus readers. <i>size</i> and
+     * <i>capacity</i> are in bytes.
+     */
+    struct ChunkCacheStats
+    {
+        size_t hits;
+        size_t misses;
+        size_t size;
+        size_t capacity;
+    };
+
+    /**
+     * Set the maximum number of bytes of decompressed data that is cached.
+     * A capacity of 0 disables the cache.
+     */
+    static void setChunkCacheCapacity(size_t capacity);
+    static ChunkCacheStats chunkCacheStats();
+    /** Remove all chunks from the cache and reset the statistics. */
+    static void clearChunkCache();
+
 private:
     virtual EntryIterator getEntries(SortOrder sortOrder) const;
+    virtual EntryIterator getEntriesWithContents(SortOrder sortOrder) const;
+    virtual EntryIterator getCandidateEntries(std::string const &query,
+        SortOrder sortOrder) const;
     virtual std::string getName() const;
+    virtual std::vector<Token> getTokens(std::string const &entry,
+        std::vector<std::string> const &attributes,
+        std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
     virtual std::string readEntry(std::string const &filename) const;
+    virtual DataView readEntryView(std::string const &filename) const;
+    virtual std::vector<std::string> readEntries(
+        std::vector<std::string> const &entries) const;
     virtual size_t getSize() const;
 
     CompactCorpusReaderPrivate *d_private;
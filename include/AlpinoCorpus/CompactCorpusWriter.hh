@@ -1,7 +1,9 @@
 #ifndef ALPINOCORPUS_COMPACT_CORPUS_WRITER
 #define ALPINOCORPUS_COMPACT_CORPUS_WRITER
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/CorpusWriter.hh>
@@ -13,7 +15,47 @@ class CompactCorpusWriterPrivate;
 class CompactCorpusWriter : public CorpusWriter
 {
 public:
+    /** Options for writing compact corpora. */
+    struct Options
+    {
+        Options() : compressionLevel(9), nThreads(1), singlePass(false) {}
+
+        /** zlib compression level, 0 (none) to 9 (best). */
+        int compressionLevel;
+
+        /** Number of compression threads (0: use all cores). */
+        size_t nThreads;
+
+        /**
+         * Write compressed data directly to the data file, rather than
+         * through a temporary file. This reserves 64 KB in the header for
+         * the chunk table.
+         */
+        bool singlePass;
+
+        /**
+         * Attributes for which an inverted index is written. The index
+         * is used to find candidate entries for XPath queries. No index
+         * is written if the list is empty.
+         */
+        std::vector<std::string> indexedAttributes;
+
+        /**
+         * Attributes of tokens that are stored separately, so that
+         * sentences can be shown without parsing entries. No token store
+         * is written if the list is empty.
+         */
+        std::vector<std::string> tokenAttributes;
+    };
+
+    /** Attributes that are commonly used in Alpino treebank queries. */
+    static std::vector<std::string> defaultIndexedAttributes();
+
+    /** Token attributes that are commonly shown in sentences. */
+    static std::vector<std::string> defaultTokenAttributes();
+
     CompactCorpusWriter(std::string const &basename);
+    CompactCorpusWriter(std::string const &basename, Options const &options);
     virtual ~CompactCorpusWriter();
 
 private:
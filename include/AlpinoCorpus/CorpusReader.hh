@@ -6,11 +6,15 @@
 #include <memory>
 #include <queue>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusInfo.hh>
+#include <AlpinoCorpus/DataView.hh>
 #include <AlpinoCorpus/DLLDefines.hh>
 #include <AlpinoCorpus/IterImpl.hh>
 #include <AlpinoCorpus/LexItem.hh>
+#include <AlpinoCorpus/Sentence.hh>
+#include <AlpinoCorpus/Token.hh>
 #include <AlpinoCorpus/util/Either.hh>
 #include <AlpinoCorpus/util/NonCopyable.hh>
 
@@ -22,8 +26,9 @@ class Stylesheet;
  * The sort order for iterators.
  *
  * Note that this is currently just a hint to the iterator implementation.
- * Most iterators currently only support the order that is natural to the
- * underlying corpus.
+ * Directory, compact and DB XML corpora support numerical order when
+ * iterating over entries, other iterators only support the order that is
+ * natural to the underlying corpus.
  */
 enum SortOrder {
     /**
@@ -33,7 +38,8 @@ enum SortOrder {
     NaturalOrder,
 
     /**
-     * Sort using numeric order.
+     * Sort using numeric order: numbers in entry names are compared by
+     * their value.
      */
     NumericalOrder
 };
@@ -43,6 +49,12 @@ enum SortOrder {
  *
  * A corpus is conceptually a mapping of names to XML documents.
  * Both are represented as strings.
+ *
+ * Reading entries (read(), readView(), readMany() and tokens()) is
+ * thread-safe: parallel iterators read entries on their worker threads.
+ * Readers must therefore implement readEntry(), readEntryView(),
+ * readEntries(), readEntryMarkQueries() and getTokens() such that they
+ * can be called concurrently. Iterators are not thread-safe.
  */
 class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
 {
@@ -58,11 +70,18 @@ class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
         EntryIterator &operator=(EntryIterator const &other);
         bool hasNext();
         bool hasProgress() const;
+
+        /**
+         * Does next() return the contents of entries? Otherwise, the
+         * contents of returned entries are empty or query matches.
+         */
+        bool hasContents() const;
         Entry next(CorpusReader const &reader);
         double progress() const;
 
         /**
-         * Interrupt an iterator that is blocking.
+         * Interrupt an iterator that is blocking. This can be called
+         * from another thread while hasNext() or next() is running.
          */
         void interrupt();
 
@@ -83,6 +102,17 @@ class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
         bool operator==(MarkerQuery const &other) const;
     };
 
+    /**
+     * Statistics of the cache of compiled queries, which is shared by
+     * all readers. <i>size</i> and <i>capacity</i> are numbers of queries.
+     */
+    struct QueryCacheStats {
+        size_t hits;
+        size_t misses;
+        size_t size;
+        size_t capacity;
+    };
+
     virtual ~CorpusReader() {}
 
     /** Return canonical name of corpus */
@@ -91,13 +121,22 @@ class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
     /** Iterator over entry names. */
     EntryIterator entries(SortOrder order = NaturalOrder) const;
 
+    /**
+     * Iterator over entries. If the iterator's hasContents() returns
+     * <tt>true</tt>, entries are returned with their contents. Readers
+     * that store entries sequentially can read them in a single pass,
+     * which is faster than reading entries one by one.
+     */
+    EntryIterator entriesWithContents(SortOrder order = NaturalOrder) const;
+
     /**
      * Iterator over entry names, contents are transformed with
-     * the given stylesheet.
+     * the given stylesheet. Transformations are applied on <i>nThreads</i>
+     * worker threads (or one thread per core if <i>nThreads</i> is zero).
      */
     EntryIterator entriesWithStylesheet(Stylesheet const &stylesheet,
       std::list<MarkerQuery> const &markerQueries = std::list<MarkerQuery>(),
-      SortOrder sortOrder = NaturalOrder) const;
+      SortOrder sortOrder = NaturalOrder, size_t nThreads = 1) const;
 
     enum QueryDialect { XPATH, XQUERY };
 
@@ -109,13 +148,23 @@ class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
         SortOrder sortOrder = NaturalOrder) const;
 
     /**
-     * Execute a query, applying the given stylesheet to each entry. The
-     * end of the range is given by end().
+     * Execute an XPath query, evaluating entries on <i>nThreads</i> worker
+     * threads (or one thread per core if <i>nThreads</i> is zero). If
+     * <i>preserveOrder</i> is <tt>false</tt>, results are returned in the
+     * order in which they become available.
+     */
+    EntryIterator parallelQuery(std::string const &q, size_t nThreads = 0,
+        bool preserveOrder = true, SortOrder sortOrder = NaturalOrder) const;
+
+    /**
+     * Execute a query, applying the given stylesheet to each entry on
+     * <i>nThreads</i> worker threads (or one thread per core if
+     * <i>nThreads</i> is zero). The end of the range is given by end().
      */ 
     EntryIterator queryWithStylesheet(QueryDialect d, std::string const &q,
         Stylesheet const &stylesheet,
         std::list<MarkerQuery> const &markerQueries,
-        SortOrder sortOrder = NaturalOrder) const;
+        SortOrder sortOrder = NaturalOrder, size_t nThreads = 1) const;
     
     /**
      * Return content of a single treebank entry. Mark elements if a marker
@@ -124,6 +173,20 @@ class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
     std::string read(std::string const &entry,
       std::list<MarkerQuery> const &queries = std::list<MarkerQuery>()) const;
 
+    /**
+     * Return the content of a single treebank entry as a read-only view.
+     * Readers that keep entries in memory can return a view of their own
+     * buffers, avoiding a copy.
+     */
+    DataView readView(std::string const &entry) const;
+
+    /**
+     * Return the contents of multiple treebank entries, in the order of
+     * <i>entries</i>. Readers can read the entries in a more efficient
+     * order than one-by-one reading allows.
+     */
+    std::vector<std::string> readMany(std::vector<std::string> const &entries) const;
+
     /**
      * Retrieve a sentence. The sentence is returned as a list of lexical
      * items, where each item contains the (query) match depth. The
@@ -138,6 +201,45 @@ class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
       std::string const &defaultValue,
       CorpusInfo const &corpusInfo) const;
 
+    /**
+     * Retrieve the sentences of several entries, as sentence() does.
+     * Readers can read the entries in a more efficient order, and
+     * the query is only compiled once.
+     */
+    std::vector<std::vector<LexItem> > sentences(
+      std::vector<std::string> const &entries, std::string const &query,
+      std::string const &attribute, std::string const &defaultValue,
+      CorpusInfo const &corpusInfo) const;
+
+    /**
+     * Retrieve a sentence, as sentence() does, in a compact representation
+     * that avoids allocations per lexical item.
+     */
+    Sentence compactSentence(std::string const &entry,
+      std::string const &query, std::string const &attribute,
+      std::string const &defaultValue,
+      CorpusInfo const &corpusInfo) const;
+
+    /**
+     * Retrieve the sentences of several entries, as sentences() does, in
+     * a compact representation.
+     */
+    std::vector<Sentence> compactSentences(
+      std::vector<std::string> const &entries, std::string const &query,
+      std::string const &attribute, std::string const &defaultValue,
+      CorpusInfo const &corpusInfo) const;
+
+    /**
+     * Retrieve the tokens of a sentence, ordered by their begin position,
+     * with the values of the given attributes. Tokens that lack an
+     * attribute get <i>defaultValue</i>. Readers that store tokens
+     * separately do not need to parse the entry.
+     */
+    std::vector<Token> tokens(std::string const &entry,
+      std::vector<std::string> const &attributes,
+      std::string const &defaultValue,
+      CorpusInfo const &corpusInfo) const;
+
     /** The treebank  type. For now, this is defined to be the name of the root
      *  element, e.g. 'alpino_ds' for Alpino treebanks. */
     std::string type() const;
@@ -145,21 +247,70 @@ class ALPINO_CORPUS_EXPORT CorpusReader : private util::NonCopyable
     /** The number of entries in the corpus. */
     size_t size() const;
 
+    /**
+     * Set the maximum number of compiled queries that are cached. A
+     * capacity of 0 disables the cache.
+     */
+    static void setQueryCacheCapacity(size_t capacity);
+
+    static QueryCacheStats queryCacheStats();
+
+    /** Remove all compiled queries from the cache and reset the statistics. */
+    static void clearQueryCache();
+
+    /**
+     * Read up to <i>depth</i> entries ahead on a background thread while
+     * entries are filtered by a query or transformed by a stylesheet.
+     * Entries are no longer read ahead when the entries that were read
+     * ahead take <i>maxMemory</i> bytes. A depth of 0 (the default)
+     * disables reading ahead.
+     */
+    static void setPrefetchLimits(size_t depth,
+        size_t maxMemory = 64 * 1024 * 1024);
+
   private:
     virtual EntryIterator getEntries(SortOrder sortOrder) const = 0;
+
+    /**
+     * Entries with their contents, if the reader can provide them more
+     * efficiently than by reading entries. The default implementation
+     * returns getEntries().
+     */
+    virtual EntryIterator getEntriesWithContents(SortOrder sortOrder) const;
+
+    /**
+     * Entries that could match an XPath query. Readers that have an index
+     * can use this to avoid evaluating the query on every entry. The
+     * default implementation returns getEntriesWithContents().
+     */
+    virtual EntryIterator getCandidateEntries(std::string const &query,
+        SortOrder sortOrder) const;
     virtual std::string getName() const = 0;
-    virtual std::vector<LexItem> getSentence(std::string const &entry,
+    virtual Sentence getSentence(std::string const &entry,
         std::string const &query, std::string const &attribute,
         std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
+    virtual std::vector<Sentence> getSentences(
+        std::vector<std::string> const &entries, std::string const &query,
+        std::string const &attribute, std::string const &defaultValue,
+        CorpusInfo const &corpusInfo) const;
     virtual size_t getSize() const = 0;
+    virtual std::vector<Token> getTokens(std::string const &entry,
+        std::vector<std::string> const &attributes,
+        std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
     virtual std::string readEntry(std::string const &entry) const = 0;
+    virtual DataView readEntryView(std::string const &entry) const;
+    virtual std::vector<std::string> readEntries(
+        std::vector<std::string> const &entries) const;
     virtual std::string readEntryMarkQueries(std::string const &entry,
         std::list<MarkerQuery> const &queries) const;
     virtual EntryIterator runXPath(std::string const &, SortOrder sortOrder) const;
+    virtual EntryIterator runParallelXPath(std::string const &q,
+      size_t nThreads, bool preserveOrder, SortOrder sortOrder) const;
     virtual EntryIterator runXQuery(std::string const &, SortOrder sortOrder) const;
     virtual EntryIterator runQueryWithStylesheet(QueryDialect d,
       std::string const &q, Stylesheet const &stylesheet,
-      std::list<MarkerQuery> const &markerQueries, SortOrder sortOrder) const;
+      std::list<MarkerQuery> const &markerQueries, SortOrder sortOrder,
+      size_t nThreads) const;
     virtual Either<std::string, Empty> validQuery(QueryDialect d, bool variables, std::string const &q) const;
 
     // Initialized lazily in type();
@@ -0,0 +1,78 @@
+#ifndef ALPINOCORPUS_DATAVIEW_HH
+#define ALPINOCORPUS_DATAVIEW_HH
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace alpinocorpus {
+
+/**
+ * A read-only view of a sequence of bytes, such as the contents of a
+ * corpus entry. The view shares ownership of the underlying storage (for
+ * instance a decompressed data chunk), so it remains valid after the
+ * storage is released by its original owner. Copying a view does not
+ * copy the data.
+ */
+class DataView
+{
+public:
+    DataView() : d_data(0), d_size(0) {}
+
+    /** View of a string, the string is moved into the view. */
+    explicit DataView(std::string data);
+
+    /**
+     * View of <i>size</i> bytes at <i>data</i>, which is kept alive by
+     * <i>owner</i>.
+     */
+    DataView(std::shared_ptr<void const> owner, char const *data,
+        size_t size) :
+        d_owner(owner), d_data(data), d_size(size) {}
+
+    char const *data() const;
+    size_t size() const;
+    bool empty() const;
+
+    /** Copy the data to a string. */
+    std::string str() const;
+
+private:
+    std::shared_ptr<void const> d_owner;
+    char const *d_data;
+    size_t d_size;
+};
+
+inline DataView::DataView(std::string data)
+{
+    std::shared_ptr<std::string> owner(
+        std::make_shared<std::string>(std::move(data)));
+    d_owner = owner;
+    d_data = owner->data();
+    d_size = owner->size();
+}
+
+inline char const *DataView::data() const
+{
+    return d_data;
+}
+
+inline size_t DataView::size() const
+{
+    return d_size;
+}
+
+inline bool DataView::empty() const
+{
+    return d_size == 0;
+}
+
+inline std::string DataView::str() const
+{
+    return std::string(d_data, d_size);
+}
+
+}
+
+#endif // ALPINOCORPUS_DATAVIEW_HH
@@ -3,6 +3,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 
@@ -26,7 +27,10 @@ class DbCorpusReader : public CorpusReader
     EntryIterator getEntries(SortOrder sortOrder) const;
     std::string getName() const;
     std::string readEntry(std::string const &) const;
+    std::vector<std::string> readEntries(std::vector<std::string> const &) const;
     EntryIterator runXPath(std::string const &, SortOrder sortOrder) const;
+    EntryIterator runParallelXPath(std::string const &, size_t nThreads,
+        bool preserveOrder, SortOrder sortOrder) const;
     EntryIterator runXQuery(std::string const &, SortOrder sortOrder) const;
     size_t getSize() const;
 
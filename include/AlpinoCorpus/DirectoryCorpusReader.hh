@@ -2,6 +2,7 @@
 #define ALPINO_DIRECTORYCORPUSREADER_HH
 
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 
@@ -29,6 +30,8 @@ private:
     virtual EntryIterator getEntries(SortOrder sortOrder) const;
     virtual std::string getName() const;
     virtual std::string readEntry(std::string const &entry) const;
+    virtual std::vector<std::string> readEntries(
+        std::vector<std::string> const &entries) const;
     virtual size_t getSize() const;
 
     DirectoryCorpusReaderPrivate *d_private;
@@ -14,10 +14,15 @@ namespace alpinocorpus {
         //virtual bool equals(IterImpl const &) const = 0;
         virtual bool hasNext() = 0;
         virtual bool hasProgress();
+
+        // Iterators that return the contents of entries with their
+        // names must override this.
+        virtual bool hasContents();
         virtual Entry next(CorpusReader const &rdr) = 0;
         virtual double progress();
 
-        // Query iterators must override this
+        // Query iterators must override this. interrupt() can be called
+        // from another thread while hasNext() or next() is running.
         virtual void interrupt();
     };
 
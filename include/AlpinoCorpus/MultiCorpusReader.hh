@@ -1,7 +1,10 @@
 #ifndef MULTI_CORPUSREADER_HH
 #define MULTI_CORPUSREADER_HH
 
+#include <cstddef>
+#include <map>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 
@@ -16,13 +19,37 @@ public:
   virtual ~MultiCorpusReader();
   void push_back(std::string const &name, std::string const &filename,
       bool recursive);
+
+  /**
+   * Set the limits of the pool of open sub-corpus readers, which is used
+   * to read entries. The least recently used readers are closed when the
+   * pool has more than <i>maxReaders</i> readers, or when the estimated
+   * memory use of the readers exceeds <i>maxMemory</i> bytes. A pool with
+   * a maximum of zero readers opens a reader for every read.
+   */
+  void setReaderPoolLimits(size_t maxReaders, size_t maxMemory);
+
+  /**
+   * Group entry paths by the corpus that they belong to. The result maps
+   * corpus names to the names of the entries within that corpus. Throws
+   * std::runtime_error if a path does not belong to any corpus.
+   */
+  std::map<std::string, std::vector<std::string> > groupByCorpus(
+      std::vector<std::string> const &paths) const;
 private:
   EntryIterator getEntries(SortOrder sortOrder) const;
   std::string getName() const;
   size_t getSize() const;
+  std::vector<Token> getTokens(std::string const &entry,
+      std::vector<std::string> const &attributes,
+      std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
   std::string readEntry(std::string const &) const;
+  DataView readEntryView(std::string const &) const;
+  std::vector<std::string> readEntries(std::vector<std::string> const &) const;
   std::string readEntryMarkQueries(std::string const &entry, std::list<MarkerQuery> const &queries) const;
   EntryIterator runXPath(std::string const &query, SortOrder sortOrder) const;
+  EntryIterator runParallelXPath(std::string const &query, size_t nThreads,
+      bool preserveOrder, SortOrder sortOrder) const;
   EntryIterator runXQuery(std::string const &query, SortOrder sortOrder) const;
   Either<std::string, Empty> validQuery(QueryDialect d, bool variables, std::string const &query) const;
 
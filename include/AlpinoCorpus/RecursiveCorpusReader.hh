@@ -2,6 +2,7 @@
 #define RECURSIVE_CORPUSREADER_HH
 
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/util/Either.hh>
@@ -27,9 +28,16 @@ private:
   EntryIterator getEntries(SortOrder sortOrder) const;
   std::string getName() const;
   size_t getSize() const;
+  std::vector<Token> getTokens(std::string const &entry,
+      std::vector<std::string> const &attributes,
+      std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
   std::string readEntry(std::string const &) const;
+  DataView readEntryView(std::string const &) const;
+  std::vector<std::string> readEntries(std::vector<std::string> const &) const;
   std::string readEntryMarkQueries(std::string const &entry, std::list<MarkerQuery> const &queries) const;
   EntryIterator runXPath(std::string const &query) const;
+  EntryIterator runParallelXPath(std::string const &query, size_t nThreads,
+      bool preserveOrder, SortOrder sortOrder) const;
   EntryIterator runXQuery(std::string const &, SortOrder sortOrder) const;
   Either<std::string, Empty> validQuery(QueryDialect d, bool variables, std::string const &query) const;
 
@@ -0,0 +1,112 @@
+#ifndef ALPINOCORPUS_SENTENCE_HH
+#define ALPINOCORPUS_SENTENCE_HH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <AlpinoCorpus/LexItem.hh>
+
+namespace alpinocorpus {
+
+/**
+ * A sentence as a list of lexical items, like std::vector<LexItem>, but
+ * stored compactly: the words of all items share a single buffer and the
+ * match ids of all items share a single array. Building a sentence does
+ * not allocate per item.
+ */
+class Sentence
+{
+public:
+    /** The number of items. */
+    size_t size() const;
+    bool empty() const;
+
+    /** The begin position of an item. */
+    size_t begin(size_t item) const;
+
+    /** The word of an item, which is not NUL-terminated. */
+    char const *wordData(size_t item) const;
+    size_t wordSize(size_t item) const;
+    std::string word(size_t item) const;
+
+    /** The (query) match ids of an item, in increasing order. */
+    size_t const *matchesBegin(size_t item) const;
+    size_t const *matchesEnd(size_t item) const;
+    size_t nMatches(size_t item) const;
+
+    /** Add an item. The match ids should be unique. */
+    void push_back(char const *word, size_t wordSize, size_t begin,
+        size_t const *matches, size_t nMatches);
+
+    void reserve(size_t items, size_t wordBytes);
+
+    /** Order the items as LexItem does, by begin position and word. */
+    void sort();
+
+    /** Convert to lexical items. */
+    std::vector<LexItem> lexItems() const;
+
+private:
+    struct Item
+    {
+        size_t begin;
+        size_t wordOffset;
+        size_t wordSize;
+        size_t matchesOffset;
+        size_t nMatches;
+    };
+
+    std::vector<Item> d_items;
+    std::string d_words;
+    std::vector<size_t> d_matches;
+};
+
+inline size_t Sentence::size() const
+{
+    return d_items.size();
+}
+
+inline bool Sentence::empty() const
+{
+    return d_items.empty();
+}
+
+inline size_t Sentence::begin(size_t item) const
+{
+    return d_items[item].begin;
+}
+
+inline char const *Sentence::wordData(size_t item) const
+{
+    return d_words.data() + d_items[item].wordOffset;
+}
+
+inline size_t Sentence::wordSize(size_t item) const
+{
+    return d_items[item].wordSize;
+}
+
+inline std::string Sentence::word(size_t item) const
+{
+    return std::string(wordData(item), wordSize(item));
+}
+
+inline size_t const *Sentence::matchesBegin(size_t item) const
+{
+    return d_matches.data() + d_items[item].matchesOffset;
+}
+
+inline size_t const *Sentence::matchesEnd(size_t item) const
+{
+    return matchesBegin(item) + d_items[item].nMatches;
+}
+
+inline size_t Sentence::nMatches(size_t item) const
+{
+    return d_items[item].nMatches;
+}
+
+}
+
+#endif // ALPINOCORPUS_SENTENCE_HH
@@ -7,6 +7,8 @@
 
 #include <libxslt/xsltInternals.h>
 
+#include <AlpinoCorpus/DataView.hh>
+
 namespace alpinocorpus {
 
 class Stylesheet
@@ -31,6 +33,13 @@ public:
     static Stylesheet *readFile(std::string const &filename);
 
     std::string transform(std::string const &xml) const;
+    std::string transform(DataView const &xml) const;
+
+    /**
+     * Apply the stylesheet to a parsed document. The document is not
+     * modified.
+     */
+    std::string transform(xmlDocPtr doc) const;
 private:
     std::shared_ptr<xsltStylesheet> d_xslPtr;
 };
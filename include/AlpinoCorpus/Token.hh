@@ -0,0 +1,22 @@
+#ifndef ALPINOCORPUS_TOKEN_HH
+#define ALPINOCORPUS_TOKEN_HH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace alpinocorpus {
+
+/**
+ * A token of a sentence, with the values of the requested attributes
+ * (in the order in which they were requested).
+ */
+struct Token
+{
+    size_t begin;
+    std::vector<std::string> values;
+};
+
+}
+
+#endif // ALPINOCORPUS_TOKEN_HH
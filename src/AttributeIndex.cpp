@@ -0,0 +1,493 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <libxml/xmlreader.h>
+
+#include "AttributeIndex.hh"
+#include "SimpleXPath.hh"
+#include "util/LittleEndian.hh"
+
+// Attribute index layout, all integers are little-endian:
+//
+// header (56 bytes):
+//   magic            8 bytes, "ACATTRIX"
+//   version          uint32
+//   reserved         uint32
+//   entry count      uint64
+//   key count        uint64
+//   attributes size  uint64
+//   keys size        uint64
+//   postings size    uint64
+// attributes (attributes size bytes):
+//   names of the indexed attributes, NUL-terminated
+// records (key count * 32 bytes), sorted by key (bytewise):
+//   key offset       uint64
+//   key length       uint32
+//   posting count    uint32
+//   postings offset  uint64
+//   postings length  uint64
+// keys (keys size bytes):
+//   attribute name, NUL, attribute value
+// postings (postings size bytes):
+//   entry numbers, encoded as variable-length deltas (7 bits per byte,
+//   least significant group first, high bit set on all but the last byte)
+
+using alpinocorpus::util::readUint;
+using alpinocorpus::util::writeUint;
+
+namespace {
+    char const ATTRIBUTE_INDEX_MAGIC[8] = {'A', 'C', 'A', 'T', 'T', 'R', 'I', 'X'};
+    uint32_t const ATTRIBUTE_INDEX_VERSION = 1;
+
+    size_t const HEADER_SIZE = 56;
+    size_t const RECORD_SIZE = 32;
+
+    void writeVarint(std::string *buf, uint32_t val)
+    {
+        while (val >= 0x80)
+        {
+            buf->push_back(static_cast<char>((val & 0x7f) | 0x80));
+            val >>= 7;
+        }
+        buf->push_back(static_cast<char>(val));
+    }
+
+    std::string makeKey(std::string const &attribute, std::string const &value)
+    {
+        std::string key(attribute);
+        key.push_back('\0');
+        key += value;
+        return key;
+    }
+
+    void intersect(std::vector<uint32_t> *entries,
+        std::vector<uint32_t> const &other)
+    {
+        std::vector<uint32_t> result;
+        std::set_intersection(entries->begin(), entries->end(),
+            other.begin(), other.end(), std::back_inserter(result));
+        entries->swap(result);
+    }
+
+    void unite(std::vector<uint32_t> *entries,
+        std::vector<uint32_t> const &other)
+    {
+        std::vector<uint32_t> result;
+        std::set_union(entries->begin(), entries->end(),
+            other.begin(), other.end(), std::back_inserter(result));
+        entries->swap(result);
+    }
+}
+
+namespace alpinocorpus {
+
+AttributeIndex::AttributeIndex(std::string const &filename) :
+    d_file(filename)
+{
+    unsigned char const *data = d_file.data();
+
+    if (d_file.size() < HEADER_SIZE ||
+            std::memcmp(data, ATTRIBUTE_INDEX_MAGIC, sizeof(ATTRIBUTE_INDEX_MAGIC)) != 0)
+        throw std::runtime_error("AttributeIndex: not an attribute index: " + filename);
+
+    if (readUint(data + 8, 4) != ATTRIBUTE_INDEX_VERSION)
+        throw std::runtime_error("AttributeIndex: unsupported index version: " + filename);
+
+    d_nEntries = readUint(data + 16, 8);
+    d_nKeys = readUint(data + 24, 8);
+    uint64_t attributesSize = readUint(data + 32, 8);
+    uint64_t keysSize = readUint(data + 40, 8);
+    uint64_t postingsSize = readUint(data + 48, 8);
+
+    // Check the sizes separately first, so that their sum cannot
+    // overflow.
+    size_t fileSize = d_file.size();
+    if (d_nKeys > fileSize / RECORD_SIZE || attributesSize > fileSize ||
+            keysSize > fileSize || postingsSize > fileSize ||
+            fileSize != HEADER_SIZE + attributesSize + d_nKeys * RECORD_SIZE +
+            keysSize + postingsSize)
+        throw std::runtime_error("AttributeIndex: corrupt index: " + filename);
+
+    char const *attributes = reinterpret_cast<char const *>(data + HEADER_SIZE);
+    char const *attributesEnd = attributes + attributesSize;
+    while (attributes != attributesEnd)
+    {
+        char const *end = std::find(attributes, attributesEnd, '\0');
+        if (end == attributesEnd)
+            throw std::runtime_error("AttributeIndex: corrupt index: " + filename);
+
+        d_attributes.insert(std::string(attributes, end));
+        attributes = end + 1;
+    }
+
+    d_records = data + HEADER_SIZE + attributesSize;
+    d_keys = d_records + d_nKeys * RECORD_SIZE;
+    d_postings = d_keys + keysSize;
+
+    // Keys and postings are used without further checks. Every posting
+    // takes at least one byte.
+    for (size_t i = 0; i < d_nKeys; ++i)
+    {
+        unsigned char const *rec = record(i);
+        uint64_t keyOffset = readUint(rec, 8);
+        uint64_t keyLength = readUint(rec + 8, 4);
+        uint64_t count = readUint(rec + 12, 4);
+        uint64_t postingsOffset = readUint(rec + 16, 8);
+        uint64_t postingsLength = readUint(rec + 24, 8);
+
+        if (keyOffset > keysSize || keyLength > keysSize - keyOffset ||
+                postingsOffset > postingsSize ||
+                postingsLength > postingsSize - postingsOffset ||
+                count > postingsLength)
+            throw std::runtime_error("AttributeIndex: corrupt index: " + filename);
+    }
+}
+
+unsigned char const *AttributeIndex::record(size_t i) const
+{
+    return d_records + i * RECORD_SIZE;
+}
+
+bool AttributeIndex::isIndexed(std::string const &attribute) const
+{
+    return d_attributes.find(attribute) != d_attributes.end();
+}
+
+bool AttributeIndex::postings(std::string const &attribute,
+    std::string const &value, std::vector<uint32_t> *entries) const
+{
+    entries->clear();
+
+    if (!isIndexed(attribute))
+        return false;
+
+    std::string key(makeKey(attribute, value));
+
+    size_t lo = 0;
+    size_t hi = d_nKeys;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        unsigned char const *rec = record(mid);
+
+        int cmp = key.compare(0, std::string::npos,
+            reinterpret_cast<char const *>(d_keys + readUint(rec, 8)),
+            readUint(rec + 8, 4));
+
+        if (cmp == 0)
+        {
+            size_t count = readUint(rec + 12, 4);
+            unsigned char const *p = d_postings + readUint(rec + 16, 8);
+            unsigned char const *end = p + readUint(rec + 24, 8);
+
+            entries->reserve(count);
+
+            // Entries are used as positions in the corpus, so corrupt
+            // postings must not produce entries that do not exist.
+            uint64_t entry = 0;
+            while (p != end)
+            {
+                uint64_t delta = 0;
+                for (size_t shift = 0; ; shift += 7)
+                {
+                    if (p == end || shift > 28)
+                        throw std::runtime_error("AttributeIndex: corrupt postings");
+
+                    delta |= static_cast<uint64_t>(*p & 0x7f) << shift;
+                    if ((*p++ & 0x80) == 0)
+                        break;
+                }
+
+                entry += delta;
+                if (entry >= d_nEntries)
+                    throw std::runtime_error("AttributeIndex: corrupt postings");
+
+                entries->push_back(entry);
+            }
+
+            return true;
+        }
+        else if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return true;
+}
+
+bool AttributeIndex::candidates(std::string const &query,
+    std::vector<uint32_t> *entries) const
+{
+    SimpleXPathExprPtr expr(parseSimpleXPath(query));
+
+    // Only restrict queries that return nodes. Other queries (e.g.
+    // boolean expressions) produce a result for every entry.
+    if (!expr || expr->type != SimpleXPathExpr::Path)
+        return false;
+
+    // Without valid postings, all entries are candidates.
+    try {
+        return candidates(*expr, entries);
+    } catch (std::runtime_error const &) {
+        entries->clear();
+        return false;
+    }
+}
+
+bool AttributeIndex::candidates(SimpleXPathExpr const &expr,
+    std::vector<uint32_t> *entries) const
+{
+    switch (expr.type)
+    {
+    case SimpleXPathExpr::Path:
+        return pathCandidates(expr, entries);
+    case SimpleXPathExpr::And:
+    {
+        // Every operand must hold, so we can use any restriction.
+        bool restricted = false;
+        for (std::vector<SimpleXPathExprPtr>::const_iterator iter =
+                expr.operands.begin(); iter != expr.operands.end(); ++iter)
+        {
+            std::vector<uint32_t> operandEntries;
+            if (!candidates(**iter, &operandEntries))
+                continue;
+
+            if (restricted)
+                intersect(entries, operandEntries);
+            else
+                entries->swap(operandEntries);
+
+            restricted = true;
+        }
+
+        return restricted;
+    }
+    case SimpleXPathExpr::Or:
+    {
+        // Every operand must be restricted.
+        entries->clear();
+        for (std::vector<SimpleXPathExprPtr>::const_iterator iter =
+                expr.operands.begin(); iter != expr.operands.end(); ++iter)
+        {
+            std::vector<uint32_t> operandEntries;
+            if (!candidates(**iter, &operandEntries))
+                return false;
+
+            unite(entries, operandEntries);
+        }
+
+        return true;
+    }
+    case SimpleXPathExpr::Not:
+        return false;
+    case SimpleXPathExpr::Equals:
+    case SimpleXPathExpr::NotEquals:
+    {
+        // A comparison can only be true if the compared path exists.
+        SimpleXPathExpr const &path = *expr.operands[0];
+        bool restricted = pathCandidates(path, entries);
+
+        SimpleXPathStep const &last = path.steps.back();
+        if (expr.type != SimpleXPathExpr::Equals || expr.numeric ||
+                last.axis != SimpleXPathStep::Attribute || last.name == "*" ||
+                !isIndexed(last.name))
+            return restricted;
+
+        std::vector<uint32_t> valueEntries;
+        for (std::vector<std::string>::const_iterator iter = expr.literals.begin();
+                iter != expr.literals.end(); ++iter)
+        {
+            std::vector<uint32_t> literalEntries;
+            postings(last.name, *iter, &literalEntries);
+            unite(&valueEntries, literalEntries);
+        }
+
+        if (restricted)
+            intersect(entries, valueEntries);
+        else
+            entries->swap(valueEntries);
+
+        return true;
+    }
+    }
+
+    return false;
+}
+
+bool AttributeIndex::pathCandidates(SimpleXPathExpr const &path,
+    std::vector<uint32_t> *entries) const
+{
+    // The path can only select a node if all predicates hold for some node.
+    bool restricted = false;
+    for (std::vector<SimpleXPathStep>::const_iterator step = path.steps.begin();
+            step != path.steps.end(); ++step)
+        for (std::vector<SimpleXPathExprPtr>::const_iterator pred =
+                step->predicates.begin(); pred != step->predicates.end(); ++pred)
+        {
+            std::vector<uint32_t> predEntries;
+            if (!candidates(**pred, &predEntries))
+                continue;
+
+            if (restricted)
+                intersect(entries, predEntries);
+            else
+                entries->swap(predEntries);
+
+            restricted = true;
+        }
+
+    return restricted;
+}
+
+AttributeIndexWriter::AttributeIndexWriter(std::string const &filename,
+        std::vector<std::string> const &attributes) :
+    d_filename(filename), d_attributes(attributes.begin(), attributes.end()),
+    d_nEntries(0), d_failed(false)
+{
+}
+
+AttributeIndexWriter::~AttributeIndexWriter()
+{
+    // The attribute index is optional, readers do a full scan if it is
+    // missing. Do not leave an index behind that lacks entries.
+    try {
+        if (d_failed)
+            std::remove(d_filename.c_str());
+        else
+            write();
+    } catch (...) {
+        std::remove(d_filename.c_str());
+    }
+}
+
+void AttributeIndexWriter::add(char const *xml, size_t len)
+{
+    if (d_nEntries == std::numeric_limits<uint32_t>::max())
+        d_failed = true;
+
+    uint32_t entry = d_nEntries++;
+
+    if (d_failed)
+        return;
+
+    std::shared_ptr<xmlTextReader> reader(
+        xmlReaderForMemory(xml, len, NULL, NULL, XML_PARSE_NONET),
+        xmlFreeTextReader);
+    if (!reader)
+    {
+        d_failed = true;
+        return;
+    }
+
+    int r;
+    while ((r = xmlTextReaderRead(reader.get())) == 1)
+    {
+        if (xmlTextReaderNodeType(reader.get()) != XML_READER_TYPE_ELEMENT)
+            continue;
+
+        while (xmlTextReaderMoveToNextAttribute(reader.get()) == 1)
+        {
+            std::string attribute(reinterpret_cast<char const *>(
+                xmlTextReaderConstName(reader.get())));
+            if (d_attributes.find(attribute) == d_attributes.end())
+                continue;
+
+            xmlChar const *value = xmlTextReaderConstValue(reader.get());
+            std::vector<uint32_t> &entries = d_postings[makeKey(attribute,
+                value == 0 ? "" : reinterpret_cast<char const *>(value))];
+            if (entries.empty() || entries.back() != entry)
+                entries.push_back(entry);
+        }
+    }
+
+    // Entries that cannot be parsed would be missing from the index.
+    if (r != 0)
+        d_failed = true;
+}
+
+void AttributeIndexWriter::write() const
+{
+    typedef std::unordered_map<std::string, std::vector<uint32_t> > PostingsMap;
+
+    std::vector<PostingsMap::const_iterator> sorted;
+    for (PostingsMap::const_iterator iter = d_postings.begin();
+            iter != d_postings.end(); ++iter)
+        sorted.push_back(iter);
+
+    std::sort(sorted.begin(), sorted.end(),
+        [](PostingsMap::const_iterator a, PostingsMap::const_iterator b) {
+            return a->first < b->first;
+        });
+
+    std::string attributes;
+    for (std::set<std::string>::const_iterator iter = d_attributes.begin();
+            iter != d_attributes.end(); ++iter)
+    {
+        attributes += *iter;
+        attributes.push_back('\0');
+    }
+
+    std::string keys;
+    std::string postings;
+    std::vector<uint64_t> postingsOffsets;
+    for (std::vector<PostingsMap::const_iterator>::const_iterator iter =
+            sorted.begin(); iter != sorted.end(); ++iter)
+    {
+        keys += (*iter)->first;
+
+        postingsOffsets.push_back(postings.size());
+        uint32_t prev = 0;
+        std::vector<uint32_t> const &entries = (*iter)->second;
+        for (std::vector<uint32_t>::const_iterator entry = entries.begin();
+                entry != entries.end(); ++entry)
+        {
+            writeVarint(&postings, *entry - prev);
+            prev = *entry;
+        }
+    }
+    postingsOffsets.push_back(postings.size());
+
+    std::ofstream out(d_filename.c_str(), std::ios::binary);
+    if (!out)
+        throw std::runtime_error("AttributeIndexWriter: could not open " + d_filename);
+
+    out.write(ATTRIBUTE_INDEX_MAGIC, sizeof(ATTRIBUTE_INDEX_MAGIC));
+    writeUint(out, ATTRIBUTE_INDEX_VERSION, 4);
+    writeUint(out, 0, 4);
+    writeUint(out, d_nEntries, 8);
+    writeUint(out, sorted.size(), 8);
+    writeUint(out, attributes.size(), 8);
+    writeUint(out, keys.size(), 8);
+    writeUint(out, postings.size(), 8);
+
+    out.write(attributes.data(), attributes.size());
+
+    uint64_t keyOffset = 0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        writeUint(out, keyOffset, 8);
+        writeUint(out, sorted[i]->first.size(), 4);
+        writeUint(out, sorted[i]->second.size(), 4);
+        writeUint(out, postingsOffsets[i], 8);
+        writeUint(out, postingsOffsets[i + 1] - postingsOffsets[i], 8);
+        keyOffset += sorted[i]->first.size();
+    }
+
+    out.write(keys.data(), keys.size());
+    out.write(postings.data(), postings.size());
+
+    out.close();
+    if (!out)
+        throw std::runtime_error("AttributeIndexWriter: could not write " + d_filename);
+}
+
+}
@@ -0,0 +1,105 @@
+#ifndef ALPINOCORPUS_ATTRIBUTEINDEX_HH
+#define ALPINOCORPUS_ATTRIBUTEINDEX_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SimpleXPath.hh"
+#include "util/MappedFile.hh"
+
+namespace alpinocorpus {
+
+/**
+ * Inverted index of attribute values. For each (attribute, value) pair,
+ * the index lists the entries that contain an element with that attribute
+ * value. Entries are identified by their position in the corpus (in the
+ * order in which they were written).
+ *
+ * The index is memory-mapped, postings are delta-encoded variable-length
+ * integers.
+ */
+class AttributeIndex
+{
+public:
+    /**
+     * Open an attribute index, throws std::runtime_error if the file
+     * cannot be mapped or is not a valid attribute index.
+     */
+    AttributeIndex(std::string const &filename);
+
+    /** The number of entries in the indexed corpus. */
+    size_t nEntries() const;
+
+    bool isIndexed(std::string const &attribute) const;
+
+    /**
+     * Get the (sorted) entries that have the given attribute value.
+     * Returns <tt>false</tt> if the attribute is not indexed. Throws
+     * std::runtime_error if the postings are corrupt.
+     */
+    bool postings(std::string const &attribute, std::string const &value,
+        std::vector<uint32_t> *entries) const;
+
+    /**
+     * Get the (sorted) entries that could match an XPath query. Returns
+     * <tt>false</tt> if the index cannot restrict the entries for this
+     * query, in which case all entries are candidates.
+     */
+    bool candidates(std::string const &query,
+        std::vector<uint32_t> *entries) const;
+
+private:
+    bool candidates(SimpleXPathExpr const &expr,
+        std::vector<uint32_t> *entries) const;
+    bool pathCandidates(SimpleXPathExpr const &path,
+        std::vector<uint32_t> *entries) const;
+    unsigned char const *record(size_t i) const;
+
+    util::MappedFile d_file;
+    size_t d_nEntries;
+    size_t d_nKeys;
+    std::set<std::string> d_attributes;
+    unsigned char const *d_records;
+    unsigned char const *d_keys;
+    unsigned char const *d_postings;
+};
+
+inline size_t AttributeIndex::nEntries() const
+{
+    return d_nEntries;
+}
+
+/**
+ * Writer for attribute indexes. Entries are collected in memory and the
+ * index is written when the writer is destructed.
+ */
+class AttributeIndexWriter
+{
+public:
+    AttributeIndexWriter(std::string const &filename,
+        std::vector<std::string> const &attributes);
+    ~AttributeIndexWriter();
+
+    /** Add the next entry. */
+    void add(char const *xml, size_t len);
+
+private:
+    AttributeIndexWriter(AttributeIndexWriter const &) = delete;
+    AttributeIndexWriter &operator=(AttributeIndexWriter const &) = delete;
+
+    void write() const;
+
+    std::string d_filename;
+    std::set<std::string> d_attributes;
+    std::unordered_map<std::string, std::vector<uint32_t> > d_postings;
+    uint32_t d_nEntries;
+    bool d_failed;
+};
+
+}
+
+#endif // ALPINOCORPUS_ATTRIBUTEINDEX_HH
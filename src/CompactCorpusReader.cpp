@@ -1,7 +1,10 @@
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CompactCorpusReader.hh>
 #include "CompactCorpusReaderPrivate.hh"
+#include "DzChunkCache.hh"
 
 namespace alpinocorpus {
 
@@ -21,16 +24,53 @@ CompactCorpusReader::~CompactCorpusReader()
     delete d_private;
 }
 
+void CompactCorpusReader::setChunkCacheCapacity(size_t capacity)
+{
+    DzChunkCache::instance().setCapacity(capacity);
+}
+
+CompactCorpusReader::ChunkCacheStats CompactCorpusReader::chunkCacheStats()
+{
+    DzChunkCache::Stats cacheStats = DzChunkCache::instance().stats();
+    ChunkCacheStats stats = {cacheStats.hits, cacheStats.misses,
+        cacheStats.size, cacheStats.capacity};
+    return stats;
+}
+
+void CompactCorpusReader::clearChunkCache()
+{
+    DzChunkCache::instance().clear();
+}
+
 CorpusReader::EntryIterator CompactCorpusReader::getEntries(SortOrder sortOrder) const
 {
     return d_private->getEntries(sortOrder);
 }
 
+CorpusReader::EntryIterator CompactCorpusReader::getEntriesWithContents(
+    SortOrder sortOrder) const
+{
+    return d_private->getEntriesWithContents(sortOrder);
+}
+
+CorpusReader::EntryIterator CompactCorpusReader::getCandidateEntries(
+    std::string const &query, SortOrder sortOrder) const
+{
+    return d_private->getCandidateEntries(query, sortOrder);
+}
+
 std::string CompactCorpusReader::getName() const
 {
     return d_private->getName();
 }
 
+std::vector<Token> CompactCorpusReader::getTokens(std::string const &entry,
+    std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+{
+    return d_private->getTokens(entry, attributes, defaultValue, corpusInfo);
+}
+
 size_t CompactCorpusReader::getSize() const
 {
     return d_private->getSize();
@@ -41,4 +81,15 @@ std::string CompactCorpusReader::readEntry(std::string const &filename) const
   return d_private->readEntry(filename);
 }
 
+DataView CompactCorpusReader::readEntryView(std::string const &filename) const
+{
+  return d_private->readEntryView(filename);
+}
+
+std::vector<std::string> CompactCorpusReader::readEntries(
+    std::vector<std::string> const &entries) const
+{
+  return d_private->readEntries(entries);
+}
+
 }   // namespace alpinocorpus
@@ -1,23 +1,29 @@
-#include <fstream>
+#include <algorithm>
 #include <memory>
 #include <mutex>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
+#include <utility>
 #include <vector>
 
 #include <boost/filesystem.hpp>
 
 #include <AlpinoCorpus/Error.hh>
 
+#include "CompactIndex.hh"
 #include "DzIstream.hh"
 #include "CompactCorpusReaderPrivate.hh"
-#include "util/base64.hh"
+#include "EntryOrder.hh"
+#include "util/NameCompare.hh"
 
 namespace {
     char const * const DATA_EXT = ".data.dz";
     char const * const INDEX_EXT = ".index";
+    char const * const BINARY_INDEX_EXT = ".bin";
+    char const * const ATTRIBUTE_INDEX_EXT = ".attr";
+    char const * const TOKEN_STORE_EXT = ".tokens";
+    char const * const ORDER_EXT = ".order";
 }
 
 namespace bf = boost::filesystem;
@@ -66,8 +72,40 @@ void CompactCorpusReaderPrivate::construct(std::string const &canonical,
 
 CorpusReader::EntryIterator CompactCorpusReaderPrivate::getEntries(SortOrder sortOrder) const
 {
-    ItemVector::const_iterator begin(d_indices.begin());
-    return EntryIterator(new IndexIter(begin, d_indices.end()));
+    if (sortOrder == NumericalOrder)
+        return EntryIterator(new IndexIter(d_index, numericalOrder()));
+
+    return EntryIterator(new IndexIter(d_index));
+}
+
+CorpusReader::EntryIterator CompactCorpusReaderPrivate::getEntriesWithContents(
+    SortOrder sortOrder) const
+{
+    // The stream reader is shared, so it cannot be used for a scan. A
+    // scan also only follows the order of the index.
+    if (!d_mappedData || sortOrder != NaturalOrder)
+        return getEntries(sortOrder);
+
+    return EntryIterator(new ScanIter(d_index, d_mappedData));
+}
+
+CorpusReader::EntryIterator CompactCorpusReaderPrivate::getCandidateEntries(
+    std::string const &query, SortOrder sortOrder) const
+{
+    if (!d_attributeIndex)
+        return getEntriesWithContents(sortOrder);
+
+    // Candidates are read one by one, since most of the data is skipped.
+    std::shared_ptr<std::vector<uint32_t> > selection(
+        new std::vector<uint32_t>);
+    if (!d_attributeIndex->candidates(query, selection.get()))
+        return getEntriesWithContents(sortOrder);
+
+    if (sortOrder == NumericalOrder)
+        return EntryIterator(new IndexIter(d_index,
+            numericalOrder(selection)));
+
+    return EntryIterator(new IndexIter(d_index, selection));
 }
 
 std::string CompactCorpusReaderPrivate::getName() const
@@ -77,7 +115,7 @@ std::string CompactCorpusReaderPrivate::getName() const
 
 size_t CompactCorpusReaderPrivate::getSize() const
 {
-  return d_indices.size();
+  return d_index->size();
 }
 
 bool endsWith(std::string const &str, std::string const &end)
@@ -105,71 +143,315 @@ void CompactCorpusReaderPrivate::canonicalize(std::string &filename)
 
 IterImpl *CompactCorpusReaderPrivate::IndexIter::copy() const
 {
-    // No pointer members.
+    // The index is immutable, so it can be shared.
     return new IndexIter(*this);
 }
 
 bool CompactCorpusReaderPrivate::IndexIter::hasNext()
 {
-  return d_iter != d_end;
+  if (d_selection)
+    return d_pos != d_selection->size();
+
+  return d_pos != d_index->size();
 }
 
 Entry CompactCorpusReaderPrivate::IndexIter::next(CorpusReader const &)
 {
-    Entry e = {(*d_iter)->name, ""};
+    size_t entry = d_selection ? (*d_selection)[d_pos] : d_pos;
+    Entry e = {d_index->name(entry), ""};
+
+    ++d_pos;
+
+    return e;
+}
+
+IterImpl *CompactCorpusReaderPrivate::ScanIter::copy() const
+{
+    // The copy gets its own scanner, which is created when the copy
+    // is first advanced.
+    ScanIter *iter = new ScanIter(d_index, d_data);
+    iter->d_pos = d_pos;
+    return iter;
+}
+
+bool CompactCorpusReaderPrivate::ScanIter::hasContents()
+{
+    return true;
+}
+
+bool CompactCorpusReaderPrivate::ScanIter::hasNext()
+{
+    return d_pos != d_index->size();
+}
+
+Entry CompactCorpusReaderPrivate::ScanIter::next(CorpusReader const &)
+{
+    if (!d_scanner)
+        d_scanner.reset(new DzMappedScanner(d_data));
+
+    size_t offset;
+    size_t size;
+    d_index->extent(d_pos, &offset, &size);
+
+    Entry e = {d_index->name(d_pos), d_scanner->read(offset, size)};
 
-    ++d_iter;
+    ++d_pos;
 
     return e;
 }
 
+CompactCorpusReaderPrivate::SelectionPtr
+    CompactCorpusReaderPrivate::numericalOrder() const
+{
+    std::lock_guard<std::mutex> lock(d_orderMutex);
+
+    if (d_numericalOrder)
+        return d_numericalOrder;
+
+    // Use the order that is stored next to the index, if it is up to
+    // date. Like the attribute index, it should not be older than the
+    // corpus data and should cover all entries.
+    std::string orderPath = d_indexPath + ORDER_EXT;
+    bf::path orderP(orderPath);
+    boost::system::error_code err;
+    if (bf::is_regular_file(orderP, err) &&
+        bf::last_write_time(orderP, err) >= bf::last_write_time(d_dataPath, err) &&
+        !err)
+    {
+        try {
+            EntryOrder order(orderPath);
+            if (order.size() == d_index->size())
+            {
+                d_numericalOrder.reset(new std::vector<uint32_t>(order.entries()));
+                return d_numericalOrder;
+            }
+        } catch (std::runtime_error const &) {
+        }
+    }
+
+    NameKeys keys;
+    keys.reserve(d_index->size());
+    for (size_t i = 0; i < d_index->size(); ++i)
+        keys.push_back(d_index->name(i));
+
+    std::shared_ptr<std::vector<uint32_t> > order(
+        new std::vector<uint32_t>(keys.order()));
+    d_numericalOrder = order;
+
+    // Store the order for later readers. This is optional, the corpus
+    // may be on a read-only file system.
+    try {
+        writeEntryOrder(orderPath, *order);
+    } catch (std::runtime_error const &) {
+    }
+
+    return d_numericalOrder;
+}
+
+/*
+ * Order a selection of entries (in index order) numerically.
+ */
+CompactCorpusReaderPrivate::SelectionPtr
+    CompactCorpusReaderPrivate::numericalOrder(SelectionPtr selection) const
+{
+    std::vector<bool> selected(d_index->size());
+    for (std::vector<uint32_t>::const_iterator iter = selection->begin();
+            iter != selection->end(); ++iter)
+        selected[*iter] = true;
+
+    SelectionPtr order = numericalOrder();
+
+    std::shared_ptr<std::vector<uint32_t> > sorted(
+        new std::vector<uint32_t>);
+    sorted->reserve(selection->size());
+    for (std::vector<uint32_t>::const_iterator iter = order->begin();
+            iter != order->end(); ++iter)
+        if (selected[*iter])
+            sorted->push_back(*iter);
+
+    return sorted;
+}
+
 void CompactCorpusReaderPrivate::open(std::string const &dataPath,
     std::string const &indexPath)
 {
-    std::ifstream indexStream(indexPath.c_str());
-    if (!indexStream)
-        throw OpenError(indexPath);
+    d_dataPath = dataPath;
+    d_indexPath = indexPath;
+    d_index = openIndex(indexPath);
+    openAttributeIndex(dataPath, indexPath);
+    openTokenStore(dataPath, indexPath);
 
-    d_dataStream = DzIstreamPtr(new DzIstream(dataPath.c_str()));
-    if (!d_dataStream)
-        throw OpenError(indexPath);
+    try {
+        d_mappedData = DzMappedReaderPtr(new DzMappedReader(dataPath));
+    } catch (std::runtime_error const &) {
+        // Mapping can fail, e.g. on file systems that do not support
+        // it. Use the (locking) stream reader instead.
+        d_dataStream = DzIstreamPtr(new DzIstream(dataPath.c_str()));
+        if (!d_dataStream)
+            throw OpenError(dataPath);
+    }
+}
 
-    // Read indices
-    std::string line;
-    while(std::getline(indexStream, line))
+CompactCorpusReaderPrivate::CompactIndexPtr CompactCorpusReaderPrivate::openIndex(
+    std::string const &indexPath)
+{
+    // Prefer the binary index, unless it is older than the text index.
+    bf::path binaryIndexP(indexPath + BINARY_INDEX_EXT);
+    boost::system::error_code err;
+    if (bf::is_regular_file(binaryIndexP, err) &&
+        bf::last_write_time(binaryIndexP, err) >= bf::last_write_time(indexPath, err) &&
+        !err)
     {
-        std::istringstream iss(line);
-        
-        std::string name;
-        std::getline(iss, name, '\t');
-        
-        std::string offset64;
-        std::getline(iss, offset64, '\t');
-        size_t offset = util::b64_decode<size_t>(offset64);
-        
-        std::string size64;
-        std::getline(iss, size64);
-        size_t size = util::b64_decode<size_t>(size64);
-        
-        IndexItemPtr item(new IndexItem(name, offset, size));
-        d_indices.push_back(item);
-        d_namedIndices[name] = item;
-    }}
+        try {
+            return CompactIndexPtr(new BinaryCompactIndex(binaryIndexP.string()));
+        } catch (std::runtime_error const &) {
+            // Fall back to the text index.
+        }
+    }
+
+    try {
+        return CompactIndexPtr(new TextCompactIndex(indexPath));
+    } catch (std::runtime_error const &e) {
+        throw OpenError(indexPath, e.what());
+    }
+}
+
+void CompactCorpusReaderPrivate::openAttributeIndex(std::string const &dataPath,
+    std::string const &indexPath)
+{
+    // The attribute index is optional. Only use it when it is not older
+    // than the corpus and covers all entries.
+    bf::path attrIndexP(indexPath + ATTRIBUTE_INDEX_EXT);
+    boost::system::error_code err;
+    if (!bf::is_regular_file(attrIndexP, err) ||
+        bf::last_write_time(attrIndexP, err) < bf::last_write_time(dataPath, err) ||
+        err)
+        return;
+
+    try {
+        AttributeIndexPtr attrIndex(new AttributeIndex(attrIndexP.string()));
+        if (attrIndex->nEntries() == d_index->size())
+            d_attributeIndex = attrIndex;
+    } catch (std::runtime_error const &) {
+    }
+}
+
+void CompactCorpusReaderPrivate::openTokenStore(std::string const &dataPath,
+    std::string const &indexPath)
+{
+    // Like the attribute index, the token store is optional and only
+    // used when it is up to date.
+    bf::path tokenStoreP(indexPath + TOKEN_STORE_EXT);
+    boost::system::error_code err;
+    if (!bf::is_regular_file(tokenStoreP, err) ||
+        bf::last_write_time(tokenStoreP, err) < bf::last_write_time(dataPath, err) ||
+        err)
+        return;
+
+    try {
+        TokenStorePtr tokenStore(new TokenStore(tokenStoreP.string()));
+        if (tokenStore->nEntries() == d_index->size())
+            d_tokenStore = tokenStore;
+    } catch (std::runtime_error const &) {
+    }
+}
+
+std::vector<Token> CompactCorpusReaderPrivate::getTokens(
+    std::string const &entry, std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+{
+    size_t offset;
+    size_t size;
+    size_t entryNr;
+    if (d_tokenStore && d_tokenStore->covers(attributes, corpusInfo) &&
+            d_index->find(entry, &offset, &size, &entryNr))
+    {
+        // The store is an optional index, if it is corrupt, extract
+        // the tokens from the entry.
+        try {
+            return d_tokenStore->tokens(entryNr, attributes, defaultValue);
+        } catch (std::runtime_error const &) {
+        }
+    }
+
+    DataView xmlData = readEntryView(entry);
+    return extractTokens(xmlData.data(), xmlData.size(), attributes,
+        defaultValue, corpusInfo);
+}
 
 std::string CompactCorpusReaderPrivate::readEntry(std::string const &filename) const
 {
-    IndexMap::const_iterator iter = d_namedIndices.find(filename);
-    if (iter == d_namedIndices.end())
+    size_t offset;
+    size_t size;
+    if (!d_index->find(filename, &offset, &size))
         throw Error("CompactCorpusReaderPrivate::read: requesting unknown data!");
 
+    if (d_mappedData)
+        return d_mappedData->read(offset, size);
+
+    std::string data(size, '\0');
+    if (data.empty())
+        return data;
+
     std::lock_guard<std::mutex> lock(d_readMutex);
-    
-    std::vector<unsigned char> data(iter->second->size);
-    d_dataStream->seekg(iter->second->offset, std::ios::beg);
-    d_dataStream->read(reinterpret_cast<char *>(&data[0]), iter->second->size);
 
+    d_dataStream->seekg(offset, std::ios::beg);
+    d_dataStream->read(&data[0], size);
+
+    return data;
+}
+
+DataView CompactCorpusReaderPrivate::readEntryView(std::string const &filename) const
+{
+    if (!d_mappedData)
+        return DataView(readEntry(filename));
+
+    size_t offset;
+    size_t size;
+    if (!d_index->find(filename, &offset, &size))
+        throw Error("CompactCorpusReaderPrivate::read: requesting unknown data!");
+
+    return d_mappedData->readView(offset, size);
+}
+
+std::vector<std::string> CompactCorpusReaderPrivate::readEntries(
+    std::vector<std::string> const &entries) const
+{
+    std::vector<std::pair<size_t, size_t> > extents(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+        if (!d_index->find(entries[i], &extents[i].first, &extents[i].second))
+            throw Error("CompactCorpusReaderPrivate::read: requesting unknown data!");
+
+    if (d_mappedData)
+        return d_mappedData->readMany(extents);
+
+    // Read the stream in the order of the data, so that seeks do not
+    // have to restart decompression of a chunk.
+    std::vector<size_t> order(extents.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [&extents](size_t a, size_t b) {
+            return extents[a].first < extents[b].first;
+        });
+
+    std::vector<std::string> data(entries.size());
+
+    std::lock_guard<std::mutex> lock(d_readMutex);
+
+    for (std::vector<size_t>::const_iterator iter = order.begin();
+            iter != order.end(); ++iter)
+    {
+        std::pair<size_t, size_t> const &extent = extents[*iter];
+        if (extent.second == 0)
+            continue;
+
+        data[*iter].resize(extent.second);
+        d_dataStream->seekg(extent.first, std::ios::beg);
+        d_dataStream->read(&data[*iter][0], extent.second);
+    }
 
-    return std::string(reinterpret_cast<char const *>(&data[0]), data.size());
+    return data;
 }
 
 }   // namespace alpinocorpus
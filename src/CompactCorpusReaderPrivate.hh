@@ -4,48 +4,66 @@
 #include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/Entry.hh>
 #include <AlpinoCorpus/IterImpl.hh>
 
+#include "AttributeIndex.hh"
+#include "CompactIndex.hh"
 #include "DzIstream.hh"
+#include "DzMappedReader.hh"
+#include "TokenStore.hh"
 
 namespace alpinocorpus
 {
-    struct IndexItem
-{
-    IndexItem(std::string const &newName, size_t newOffset, size_t newSize)
-     : name(newName), offset(newOffset), size(newSize) {}
-    IndexItem() : name(""), offset(0), size(0) {}
-
-    std::string name;
-    size_t offset;
-    size_t size;
-};
 
 class CompactCorpusReaderPrivate : public CorpusReader
 {
-    typedef std::shared_ptr<IndexItem> IndexItemPtr;
-    typedef std::unordered_map<std::string, IndexItemPtr> IndexMap;
+    typedef std::shared_ptr<AttributeIndex const> AttributeIndexPtr;
+    typedef std::shared_ptr<CompactIndex const> CompactIndexPtr;
+    typedef std::shared_ptr<std::vector<uint32_t> const> SelectionPtr;
     typedef std::shared_ptr<DzIstream> DzIstreamPtr;
-    typedef std::vector<IndexItemPtr> ItemVector;
+    typedef std::shared_ptr<DzMappedReader> DzMappedReaderPtr;
+    typedef std::shared_ptr<TokenStore const> TokenStorePtr;
 
     class IndexIter : public IterImpl
     {
-        ItemVector::const_iterator d_iter;
-        ItemVector::const_iterator d_end;
+        CompactIndexPtr d_index;
+        SelectionPtr d_selection;
+        size_t d_pos;
 
     public:
-        IndexIter(ItemVector::const_iterator i,
-            ItemVector::const_iterator const end) : d_iter(i), d_end(end) { }
+        IndexIter(CompactIndexPtr index) : d_index(index), d_pos(0) { }
+        /** Iterate over the selected entries of the index. */
+        IndexIter(CompactIndexPtr index, SelectionPtr selection) :
+            d_index(index), d_selection(selection), d_pos(0) { }
         IterImpl *copy() const;
         bool hasNext();
         Entry next(CorpusReader const &rdr);
     };
 
+    /**
+     * Iterate over all entries in the order of the index, with their
+     * contents. The data file is inflated in a single pass.
+     */
+    class ScanIter : public IterImpl
+    {
+        CompactIndexPtr d_index;
+        DzMappedReaderPtr d_data;
+        std::shared_ptr<DzMappedScanner> d_scanner;
+        size_t d_pos;
+
+    public:
+        ScanIter(CompactIndexPtr index, DzMappedReaderPtr data) :
+            d_index(index), d_data(data), d_pos(0) { }
+        IterImpl *copy() const;
+        bool hasContents();
+        bool hasNext();
+        Entry next(CorpusReader const &rdr);
+    };
+
 public:
     /**
      * Construct from a single file (data or index); the other file is sought
@@ -57,8 +75,17 @@ public:
     virtual ~CompactCorpusReaderPrivate() {}
 
     virtual EntryIterator getEntries(SortOrder sortOrder) const;
+    virtual EntryIterator getEntriesWithContents(SortOrder sortOrder) const;
+    virtual EntryIterator getCandidateEntries(std::string const &query,
+        SortOrder sortOrder) const;
     virtual std::string getName() const;
+    virtual std::vector<Token> getTokens(std::string const &entry,
+        std::vector<std::string> const &attributes,
+        std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
     virtual std::string readEntry(std::string const &filename) const;
+    virtual DataView readEntryView(std::string const &filename) const;
+    virtual std::vector<std::string> readEntries(
+        std::vector<std::string> const &entries) const;
     virtual size_t getSize() const;
 
 private:
@@ -66,13 +93,31 @@ private:
     void construct(std::string const &);
     void construct(std::string const &, std::string const &, std::string const &);
     void open(std::string const &, std::string const &);
-	
+    static CompactIndexPtr openIndex(std::string const &indexPath);
+    void openAttributeIndex(std::string const &dataPath,
+        std::string const &indexPath);
+    void openTokenStore(std::string const &dataPath,
+        std::string const &indexPath);
+    SelectionPtr numericalOrder() const;
+    SelectionPtr numericalOrder(SelectionPtr selection) const;
+
+    // Memory-mapped data, used for lock-free reads. If the data file
+    // could not be mapped, we fall back to d_dataStream.
+    DzMappedReaderPtr d_mappedData;
     DzIstreamPtr d_dataStream;
-    std::vector<IndexItemPtr> d_indices;
-	IndexMap d_namedIndices;
+    CompactIndexPtr d_index;
+    AttributeIndexPtr d_attributeIndex;
+    TokenStorePtr d_tokenStore;
     std::string d_name;
+    std::string d_dataPath;
+    std::string d_indexPath;
 
+    // Protects d_dataStream.
     mutable std::mutex d_readMutex;
+
+    // Entries in numerical order, read or computed on first use.
+    mutable SelectionPtr d_numericalOrder;
+    mutable std::mutex d_orderMutex;
 };
 
 }
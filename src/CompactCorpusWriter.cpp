@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CompactCorpusWriter.hh>
 #include <AlpinoCorpus/CorpusReader.hh>
@@ -9,9 +10,29 @@
 namespace alpinocorpus {
 
 CompactCorpusWriter::CompactCorpusWriter(std::string const &basename) :
-    d_private(new CompactCorpusWriterPrivate(basename))
+    d_private(new CompactCorpusWriterPrivate(basename, Options()))
 {}
 
+CompactCorpusWriter::CompactCorpusWriter(std::string const &basename,
+        Options const &options) :
+    d_private(new CompactCorpusWriterPrivate(basename, options))
+{}
+
+std::vector<std::string> CompactCorpusWriter::defaultIndexedAttributes()
+{
+    static char const *attributes[] = {"cat", "lemma", "pos", "postag",
+        "pt", "rel", "root", "word"};
+    return std::vector<std::string>(attributes,
+        attributes + sizeof(attributes) / sizeof(attributes[0]));
+}
+
+std::vector<std::string> CompactCorpusWriter::defaultTokenAttributes()
+{
+    static char const *attributes[] = {"word", "lemma", "pos"};
+    return std::vector<std::string>(attributes,
+        attributes + sizeof(attributes) / sizeof(attributes[0]));
+}
+
 CompactCorpusWriter::~CompactCorpusWriter()
 {
     delete d_private;
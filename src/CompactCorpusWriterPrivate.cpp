@@ -1,6 +1,7 @@
 #include <fstream>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/Entry.hh>
@@ -12,14 +13,21 @@
 
 using namespace std;
 
+namespace {
+    // Number of entries that is read at once when copying a corpus.
+    size_t const READ_BATCH_SIZE = 256;
+}
+
 namespace alpinocorpus {
 
 
-CompactCorpusWriterPrivate::CompactCorpusWriterPrivate(std::string const &basename) :
+CompactCorpusWriterPrivate::CompactCorpusWriterPrivate(std::string const &basename,
+		CompactCorpusWriter::Options const &options) :
 	d_offset(0)
 {
 	std::string dataFilename = basename + ".data.dz";
-	d_dataStream.reset(new DzOstream(dataFilename.c_str()));
+	d_dataStream.reset(new DzOstream(dataFilename.c_str(),
+		options.compressionLevel, options.nThreads, options.singlePass));
 	if (!d_dataStream)
 		throw OpenError(dataFilename, "Could not open file for writing");
 
@@ -27,10 +35,23 @@ CompactCorpusWriterPrivate::CompactCorpusWriterPrivate(std::string const &basena
 	d_indexStream.reset(new std::ofstream(indexFilename.c_str()));
 	if (!d_indexStream)
 		throw OpenError(indexFilename, "Could not open file for writing");
+
+	d_binaryIndex.reset(new BinaryCompactIndexWriter(indexFilename + ".bin"));
+
+	if (!options.indexedAttributes.empty())
+		d_attributeIndex.reset(new AttributeIndexWriter(indexFilename + ".attr",
+			options.indexedAttributes));
+
+	if (!options.tokenAttributes.empty())
+		d_tokenStore.reset(new TokenStoreWriter(indexFilename + ".tokens",
+			options.tokenAttributes));
 }
 
 void CompactCorpusWriterPrivate::copy(CompactCorpusWriterPrivate const &other)
 {
+	d_attributeIndex = other.d_attributeIndex;
+	d_binaryIndex = other.d_binaryIndex;
+	d_tokenStore = other.d_tokenStore;
 	d_dataStream = other.d_dataStream;
 	d_indexStream = other.d_indexStream;
 	d_offset = other.d_offset;
@@ -43,6 +64,12 @@ void CompactCorpusWriterPrivate::writeEntry(std::string const &name, std::string
 	*d_dataStream << data;
 	*d_indexStream << name << "\t" << util::b64_encode(d_offset) << "\t" <<
 		util::b64_encode(data.size()) << endl;
+	if (d_binaryIndex)
+		d_binaryIndex->add(name, d_offset, data.size());
+	if (d_attributeIndex)
+		d_attributeIndex->add(data.c_str(), data.size());
+	if (d_tokenStore)
+		d_tokenStore->add(data.c_str(), data.size());
 	d_offset += data.size();
 }
 
@@ -53,6 +80,12 @@ void CompactCorpusWriterPrivate::writeEntry(std::string const &name, char const
 	d_dataStream->write(buf, len);
 	*d_indexStream << name << "\t" << util::b64_encode(d_offset) << "\t" <<
 		util::b64_encode(len) << endl;
+	if (d_binaryIndex)
+		d_binaryIndex->add(name, d_offset, len);
+	if (d_attributeIndex)
+		d_attributeIndex->add(buf, len);
+	if (d_tokenStore)
+		d_tokenStore->add(buf, len);
 	d_offset += len;
 }
 
@@ -66,11 +99,20 @@ void CompactCorpusWriterPrivate::writeEntry(CorpusReader const &corpus, bool fai
 
 void CompactCorpusWriterPrivate::writeFailFirst(CorpusReader const &corpus)
 {
+    // Read entries in batches, so that the reader can read them in the
+    // order that is most efficient for the reader.
+    std::vector<std::string> names;
+
     CorpusReader::EntryIterator i = corpus.entries();
     while(i.hasNext())
     {
-        Entry e = i.next(corpus);
-        write(e.name, corpus.read(e.name));
+        names.clear();
+        while (names.size() < READ_BATCH_SIZE && i.hasNext())
+            names.push_back(i.next(corpus).name);
+
+        std::vector<std::string> contents(corpus.readMany(names));
+        for (size_t j = 0; j < names.size(); ++j)
+            write(names[j], contents[j]);
     }
 }
 
@@ -5,13 +5,21 @@
 #include <memory>
 #include <mutex>
 
+#include <AlpinoCorpus/CompactCorpusWriter.hh>
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/CorpusWriter.hh>
 
+#include "AttributeIndex.hh"
+#include "CompactIndex.hh"
+#include "TokenStore.hh"
+
 namespace alpinocorpus
 {
 
 typedef std::shared_ptr<std::ostream> ostreamPtr;
+typedef std::shared_ptr<AttributeIndexWriter> AttributeIndexWriterPtr;
+typedef std::shared_ptr<BinaryCompactIndexWriter> BinaryCompactIndexWriterPtr;
+typedef std::shared_ptr<TokenStoreWriter> TokenStoreWriterPtr;
 
 class CompactCorpusWriterPrivate : public CorpusWriter
 {
@@ -21,7 +29,8 @@ class CompactCorpusWriterPrivate : public CorpusWriter
     };
 
 public:
-	CompactCorpusWriterPrivate(std::string const &basename);
+	CompactCorpusWriterPrivate(std::string const &basename,
+		CompactCorpusWriter::Options const &options);
 	CompactCorpusWriterPrivate(ostreamPtr dataStream, ostreamPtr indexStream) :
 		d_dataStream(dataStream), d_indexStream(indexStream), d_offset(0) {}
 	CompactCorpusWriterPrivate() :
@@ -37,6 +46,11 @@ private:
     void writeFailFirst(CorpusReader const &corpus);
     void writeFailSafe(CorpusReader const &corpus);
 
+	// Declared first, so that the binary and attribute indexes and the
+	// token store are written after the data and text index are closed.
+	AttributeIndexWriterPtr d_attributeIndex;
+	BinaryCompactIndexWriterPtr d_binaryIndex;
+	TokenStoreWriterPtr d_tokenStore;
 	ostreamPtr d_dataStream;
 	ostreamPtr d_indexStream;
 	size_t d_offset;
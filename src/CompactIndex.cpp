@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <AlpinoCorpus/Error.hh>
+
+#include "CompactIndex.hh"
+#include "util/LittleEndian.hh"
+#include "util/base64.hh"
+
+// Binary index layout, all integers are little-endian:
+//
+// header (32 bytes):
+//   magic          8 bytes, "ACINDEX\0"
+//   version        uint32
+//   record size    uint32
+//   entry count    uint64
+//   names size     uint64
+// records (entry count * 32 bytes), in the order the entries were written:
+//   data offset    uint64
+//   data size      uint64
+//   name offset    uint64
+//   name length    uint32
+//   reserved       uint32
+// sorted (entry count * 4 bytes):
+//   uint32 record numbers, sorted by entry name (bytewise)
+// names (names size bytes):
+//   entry names, not terminated
+
+using alpinocorpus::util::readUint;
+using alpinocorpus::util::writeUint;
+
+namespace {
+    char const BINARY_INDEX_MAGIC[8] = {'A', 'C', 'I', 'N', 'D', 'E', 'X', '\0'};
+    uint32_t const BINARY_INDEX_VERSION = 1;
+
+    size_t const HEADER_SIZE = 32;
+    size_t const RECORD_SIZE = 32;
+    size_t const SORTED_SIZE = 4;
+
+    // Number of names per front-coding block of the text index.
+    size_t const NAME_BLOCK_SIZE = 16;
+    uint32_t const NO_ENTRY = std::numeric_limits<uint32_t>::max();
+
+    void writeVarint(std::string *buf, size_t val)
+    {
+        while (val >= 0x80)
+        {
+            buf->push_back(static_cast<char>((val & 0x7f) | 0x80));
+            val >>= 7;
+        }
+        buf->push_back(static_cast<char>(val));
+    }
+
+    size_t readVarint(unsigned char const **p)
+    {
+        size_t val = 0;
+        for (size_t shift = 0; ; shift += 7)
+        {
+            unsigned char byte = *(*p)++;
+            val |= static_cast<size_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return val;
+        }
+    }
+
+    int compareNames(char const *name1, size_t len1, char const *name2,
+        size_t len2)
+    {
+        int r = std::memcmp(name1, name2, std::min(len1, len2));
+        if (r != 0)
+            return r;
+
+        return len1 < len2 ? -1 : (len1 == len2 ? 0 : 1);
+    }
+}
+
+namespace alpinocorpus {
+
+TextCompactIndex::TextCompactIndex(std::string const &filename)
+{
+    std::ifstream indexStream(filename.c_str());
+    if (!indexStream)
+        throw std::runtime_error("could not open index");
+
+    std::hash<std::string> hash;
+    std::vector<size_t> hashes;
+    std::string prevName;
+
+    std::string line;
+    while(std::getline(indexStream, line))
+    {
+        std::istringstream iss(line);
+        
+        std::string name;
+        std::getline(iss, name, '\t');
+        
+        std::string offset64;
+        std::getline(iss, offset64, '\t');
+        size_t offset = util::b64_decode<size_t>(offset64);
+        
+        std::string size64;
+        std::getline(iss, size64);
+        size_t size = util::b64_decode<size_t>(size64);
+
+        if (d_offsets.size() == NO_ENTRY)
+            throw std::runtime_error("TextCompactIndex: too many entries");
+        if (size > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("TextCompactIndex: entry too large: " + name);
+
+        addName(name, prevName);
+        d_offsets.push_back(offset);
+        d_sizes.push_back(size);
+        hashes.push_back(hash(name));
+
+        prevName.swap(name);
+    }
+
+    buildTable(hashes);
+
+    d_names.shrink_to_fit();
+    d_blocks.shrink_to_fit();
+    d_offsets.shrink_to_fit();
+    d_sizes.shrink_to_fit();
+}
+
+void TextCompactIndex::addName(std::string const &name,
+    std::string const &prevName)
+{
+    if (d_offsets.size() % NAME_BLOCK_SIZE == 0)
+    {
+        d_blocks.push_back(d_names.size());
+        writeVarint(&d_names, name.size());
+        d_names += name;
+        return;
+    }
+
+    size_t prefix = 0;
+    size_t maxPrefix = std::min(name.size(), prevName.size());
+    while (prefix < maxPrefix && name[prefix] == prevName[prefix])
+        ++prefix;
+
+    writeVarint(&d_names, prefix);
+    writeVarint(&d_names, name.size() - prefix);
+    d_names.append(name, prefix, std::string::npos);
+}
+
+void TextCompactIndex::decodeName(size_t i, std::string *name) const
+{
+    unsigned char const *p = reinterpret_cast<unsigned char const *>(
+        d_names.data()) + d_blocks[i / NAME_BLOCK_SIZE];
+
+    size_t len = readVarint(&p);
+    name->assign(reinterpret_cast<char const *>(p), len);
+    p += len;
+
+    for (size_t j = i % NAME_BLOCK_SIZE; j != 0; --j)
+    {
+        size_t prefix = readVarint(&p);
+        size_t suffix = readVarint(&p);
+        name->resize(prefix);
+        name->append(reinterpret_cast<char const *>(p), suffix);
+        p += suffix;
+    }
+}
+
+void TextCompactIndex::buildTable(std::vector<size_t> const &hashes)
+{
+    // Keep the load factor at or below 0.5, so that there is always an
+    // empty slot and probe sequences stay short.
+    size_t tableSize = 1;
+    while (tableSize < 2 * hashes.size())
+        tableSize <<= 1;
+
+    d_table.assign(tableSize, NO_ENTRY);
+    size_t mask = tableSize - 1;
+
+    std::string name;
+    std::string candidate;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        size_t slot = hashes[i] & mask;
+        for (; d_table[slot] != NO_ENTRY; slot = (slot + 1) & mask)
+        {
+            size_t j = d_table[slot];
+            if (hashes[j] != hashes[i])
+                continue;
+
+            decodeName(i, &name);
+            decodeName(j, &candidate);
+            if (name == candidate)
+                break;
+        }
+
+        d_table[slot] = i;
+    }
+}
+
+size_t TextCompactIndex::size() const
+{
+    return d_offsets.size();
+}
+
+std::string TextCompactIndex::name(size_t i) const
+{
+    std::string name;
+    decodeName(i, &name);
+    return name;
+}
+
+void TextCompactIndex::extent(size_t i, size_t *offset, size_t *size) const
+{
+    *offset = d_offsets[i];
+    *size = d_sizes[i];
+}
+
+bool TextCompactIndex::find(std::string const &name, size_t *offset,
+    size_t *size, size_t *entry) const
+{
+    size_t mask = d_table.size() - 1;
+
+    std::string candidate;
+    for (size_t slot = std::hash<std::string>()(name) & mask;
+        d_table[slot] != NO_ENTRY; slot = (slot + 1) & mask)
+    {
+        size_t i = d_table[slot];
+        decodeName(i, &candidate);
+        if (candidate != name)
+            continue;
+
+        extent(i, offset, size);
+        if (entry != 0)
+            *entry = i;
+
+        return true;
+    }
+
+    return false;
+}
+
+BinaryCompactIndex::BinaryCompactIndex(std::string const &filename) :
+    d_file(filename)
+{
+    unsigned char const *data = d_file.data();
+
+    if (d_file.size() < HEADER_SIZE ||
+            std::memcmp(data, BINARY_INDEX_MAGIC, sizeof(BINARY_INDEX_MAGIC)) != 0)
+        throw std::runtime_error("BinaryCompactIndex: not a binary index: " + filename);
+
+    if (readUint(data + 8, 4) != BINARY_INDEX_VERSION ||
+            readUint(data + 12, 4) != RECORD_SIZE)
+        throw std::runtime_error("BinaryCompactIndex: unsupported index version: " + filename);
+
+    uint64_t count = readUint(data + 16, 8);
+    uint64_t namesSize = readUint(data + 24, 8);
+
+    if (count > std::numeric_limits<uint32_t>::max() ||
+            namesSize > d_file.size() ||
+            d_file.size() != HEADER_SIZE + count * (RECORD_SIZE + SORTED_SIZE) + namesSize)
+        throw std::runtime_error("BinaryCompactIndex: corrupt index: " + filename);
+
+    d_size = count;
+    d_namesSize = namesSize;
+    d_records = data + HEADER_SIZE;
+    d_sorted = d_records + d_size * RECORD_SIZE;
+    d_names = d_sorted + d_size * SORTED_SIZE;
+}
+
+unsigned char const *BinaryCompactIndex::record(size_t i) const
+{
+    return d_records + i * RECORD_SIZE;
+}
+
+// Records are not checked when the index is opened, so that opening
+// does not touch every page. They are checked when they are used.
+unsigned char const *BinaryCompactIndex::sortedRecord(size_t pos) const
+{
+    size_t i = readUint(d_sorted + pos * SORTED_SIZE, 4);
+    if (i >= d_size)
+        throw Error("BinaryCompactIndex: corrupt index");
+
+    return record(i);
+}
+
+void BinaryCompactIndex::recordName(unsigned char const *rec,
+    char const **name, size_t *len) const
+{
+    uint64_t nameOffset = readUint(rec + 16, 8);
+    uint64_t nameLength = readUint(rec + 24, 4);
+    if (nameOffset > d_namesSize || nameLength > d_namesSize - nameOffset)
+        throw Error("BinaryCompactIndex: corrupt index");
+
+    *name = reinterpret_cast<char const *>(d_names + nameOffset);
+    *len = nameLength;
+}
+
+size_t BinaryCompactIndex::size() const
+{
+    return d_size;
+}
+
+std::string BinaryCompactIndex::name(size_t i) const
+{
+    char const *recName;
+    size_t recNameLen;
+    recordName(record(i), &recName, &recNameLen);
+    return std::string(recName, recNameLen);
+}
+
+void BinaryCompactIndex::extent(size_t i, size_t *offset, size_t *size) const
+{
+    unsigned char const *rec = record(i);
+    *offset = readUint(rec, 8);
+    *size = readUint(rec + 8, 8);
+}
+
+bool BinaryCompactIndex::find(std::string const &name, size_t *offset,
+    size_t *size, size_t *entry) const
+{
+    // Find the last entry with the given name (like the text index,
+    // the last duplicate wins).
+    size_t lo = 0;
+    size_t hi = d_size;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        char const *recName;
+        size_t recNameLen;
+        recordName(sortedRecord(mid), &recName, &recNameLen);
+
+        int cmp = compareNames(name.data(), name.size(), recName, recNameLen);
+
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    if (lo == 0)
+        return false;
+
+    unsigned char const *rec = sortedRecord(lo - 1);
+    size_t i = (rec - d_records) / RECORD_SIZE;
+
+    char const *recName;
+    size_t recNameLen;
+    recordName(rec, &recName, &recNameLen);
+    if (compareNames(name.data(), name.size(), recName, recNameLen) != 0)
+        return false;
+
+    *offset = readUint(rec, 8);
+    *size = readUint(rec + 8, 8);
+    if (entry != 0)
+        *entry = i;
+
+    return true;
+}
+
+BinaryCompactIndexWriter::BinaryCompactIndexWriter(std::string const &filename) :
+    d_filename(filename)
+{
+}
+
+BinaryCompactIndexWriter::~BinaryCompactIndexWriter()
+{
+    // The binary index is optional, readers fall back to the text index
+    // if it is missing or corrupt.
+    try {
+        write();
+    } catch (...) {
+        std::remove(d_filename.c_str());
+    }
+}
+
+void BinaryCompactIndexWriter::add(std::string const &name, size_t offset,
+    size_t size)
+{
+    if (d_records.size() == std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("BinaryCompactIndexWriter: too many entries");
+
+    Record record = {d_names.size(), static_cast<uint32_t>(name.size()),
+        offset, size};
+    d_records.push_back(record);
+    d_names += name;
+}
+
+void BinaryCompactIndexWriter::write() const
+{
+    std::vector<uint32_t> sorted(d_records.size());
+    for (size_t i = 0; i < sorted.size(); ++i)
+        sorted[i] = i;
+
+    std::vector<Record> const &records = d_records;
+    std::string const &names = d_names;
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [&records, &names](uint32_t i, uint32_t j) {
+            return compareNames(names.data() + records[i].nameOffset,
+                records[i].nameLength, names.data() + records[j].nameOffset,
+                records[j].nameLength) < 0;
+        });
+
+    std::ofstream out(d_filename.c_str(), std::ios::binary);
+    if (!out)
+        throw std::runtime_error("BinaryCompactIndexWriter: could not open " + d_filename);
+
+    out.write(BINARY_INDEX_MAGIC, sizeof(BINARY_INDEX_MAGIC));
+    writeUint(out, BINARY_INDEX_VERSION, 4);
+    writeUint(out, RECORD_SIZE, 4);
+    writeUint(out, d_records.size(), 8);
+    writeUint(out, d_names.size(), 8);
+
+    for (std::vector<Record>::const_iterator iter = d_records.begin();
+        iter != d_records.end(); ++iter)
+    {
+        writeUint(out, iter->offset, 8);
+        writeUint(out, iter->size, 8);
+        writeUint(out, iter->nameOffset, 8);
+        writeUint(out, iter->nameLength, 4);
+        writeUint(out, 0, 4);
+    }
+
+    for (std::vector<uint32_t>::const_iterator iter = sorted.begin();
+        iter != sorted.end(); ++iter)
+        writeUint(out, *iter, 4);
+
+    out.write(d_names.data(), d_names.size());
+
+    out.close();
+    if (!out)
+        throw std::runtime_error("BinaryCompactIndexWriter: could not write " + d_filename);
+}
+
+}
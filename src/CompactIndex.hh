@@ -0,0 +1,147 @@
+#ifndef ALPINO_COMPACT_INDEX_HH
+#define ALPINO_COMPACT_INDEX_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "util/MappedFile.hh"
+
+namespace alpinocorpus
+{
+
+/**
+ * Index of a compact corpus: maps entry names to the offset and size of
+ * their (uncompressed) data. Entries are numbered in the order in which
+ * they were written.
+ */
+class CompactIndex
+{
+public:
+    virtual ~CompactIndex() {}
+
+    virtual size_t size() const = 0;
+    virtual std::string name(size_t i) const = 0;
+
+    /** Get the offset and size of the data of entry <i>i</i>. */
+    virtual void extent(size_t i, size_t *offset, size_t *size) const = 0;
+
+    /**
+     * Find the data of an entry, returns <tt>false</tt> if there is no
+     * entry with the given name. If <i>entry</i> is not null, the number
+     * of the entry is stored in it.
+     */
+    virtual bool find(std::string const &name, size_t *offset,
+        size_t *size, size_t *entry = 0) const = 0;
+};
+
+/**
+ * Index that is read from a text (.index) file. Entry names are
+ * front-coded in a single buffer and found through an open-addressing
+ * hash table of entry numbers, so that the index does not allocate per
+ * entry.
+ */
+class TextCompactIndex : public CompactIndex
+{
+public:
+    TextCompactIndex(std::string const &filename);
+
+    size_t size() const;
+    std::string name(size_t i) const;
+    void extent(size_t i, size_t *offset, size_t *size) const;
+    bool find(std::string const &name, size_t *offset, size_t *size,
+        size_t *entry = 0) const;
+
+private:
+    void addName(std::string const &name, std::string const &prevName);
+    void decodeName(size_t i, std::string *name) const;
+    void buildTable(std::vector<size_t> const &hashes);
+
+    // Front-coded names: each block of names starts with a complete
+    // name, the other names are stored as the length of the prefix that
+    // they share with the preceding name plus the remaining suffix.
+    std::string d_names;
+    std::vector<uint64_t> d_blocks;
+
+    std::vector<uint64_t> d_offsets;
+    std::vector<uint32_t> d_sizes;
+
+    // Entry numbers, with linear probing. For duplicate names, the
+    // last entry is stored.
+    std::vector<uint32_t> d_table;
+};
+
+/**
+ * Index that is read from a memory-mapped binary (.index.bin) file. The
+ * index is used in place, opening it does not allocate per entry.
+ */
+class BinaryCompactIndex : public CompactIndex
+{
+public:
+    /**
+     * Open a binary index, throws std::runtime_error if the file cannot
+     * be mapped or is not a valid binary index. Records are only checked
+     * when they are used, name() and find() throw Error if a record is
+     * corrupt.
+     */
+    BinaryCompactIndex(std::string const &filename);
+
+    size_t size() const;
+    std::string name(size_t i) const;
+    void extent(size_t i, size_t *offset, size_t *size) const;
+    bool find(std::string const &name, size_t *offset, size_t *size,
+        size_t *entry = 0) const;
+
+private:
+    unsigned char const *record(size_t i) const;
+
+    /** The record at position <i>pos</i> of the sorted table. */
+    unsigned char const *sortedRecord(size_t pos) const;
+
+    /** Get the name of a record, throws Error if it is out of bounds. */
+    void recordName(unsigned char const *rec, char const **name,
+        size_t *len) const;
+
+    util::MappedFile d_file;
+    size_t d_size;
+    size_t d_namesSize;
+    unsigned char const *d_records;
+    unsigned char const *d_sorted;
+    unsigned char const *d_names;
+};
+
+/**
+ * Writer for binary indexes. Entries are collected in memory and the
+ * index is written when the writer is destructed.
+ */
+class BinaryCompactIndexWriter
+{
+public:
+    BinaryCompactIndexWriter(std::string const &filename);
+    ~BinaryCompactIndexWriter();
+
+    void add(std::string const &name, size_t offset, size_t size);
+
+private:
+    BinaryCompactIndexWriter(BinaryCompactIndexWriter const &) = delete;
+    BinaryCompactIndexWriter &operator=(BinaryCompactIndexWriter const &) = delete;
+
+    void write() const;
+
+    struct Record
+    {
+        uint64_t nameOffset;
+        uint32_t nameLength;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::string d_filename;
+    std::vector<Record> d_records;
+    std::string d_names;
+};
+
+}
+
+#endif  // ALPINO_COMPACT_INDEX_HH
@@ -0,0 +1,186 @@
+#include <cassert>
+#include <list>
+#include <memory>
+#include <regex>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <libxml/xpath.h>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Error.hh>
+#include <AlpinoCorpus/Stylesheet.hh>
+
+#include "CompiledMarkers.hh"
+#include "SimpleXPath.hh"
+#include "util/LibXml.hh"
+#include "util/split.hh"
+
+namespace {
+    // Number of compiled marker queries that is kept.
+    size_t const EXPR_CACHE_CAPACITY = 256;
+
+    typedef std::shared_ptr<xmlXPathCompExpr> ExprPtr;
+
+    xmlChar const *toXmlStr(char const *str)
+    {
+        return reinterpret_cast<xmlChar const *>(str);
+    }
+
+    ExprPtr compileExpr(std::string const &query)
+    {
+        if (!alpinocorpus::parseSimpleXPath(query))
+            return ExprPtr();
+
+        // Queries that libxml2 does not understand (such as XPath 2.0
+        // sequences) are not errors, they are left to the Xerces marker.
+        std::shared_ptr<xmlXPathContext> ctx(xmlXPathNewContext(0),
+            xmlXPathFreeContext);
+        if (!ctx)
+            return ExprPtr();
+        ctx->error = &alpinocorpus::util::ignoreStructuredError;
+
+        return ExprPtr(xmlXPathCtxtCompile(ctx.get(),
+            toXmlStr(query.c_str())), xmlXPathFreeCompExpr);
+    }
+
+    // LRU cache of compiled marker queries, keyed by the query text as
+    // given by the caller. Queries that cannot be compiled are cached as
+    // null pointers, so that they are not parsed again for every entry.
+    class ExprCache
+    {
+    public:
+        ExprPtr get(std::string const &query)
+        {
+            {
+                std::lock_guard<std::mutex> lock(d_mutex);
+
+                Index::iterator iter = d_index.find(query);
+                if (iter != d_index.end())
+                {
+                    d_lru.splice(d_lru.begin(), d_lru, iter->second);
+                    return iter->second->second;
+                }
+            }
+
+            // Discard pre-filters, as CorpusReader::read() does.
+            auto parts = split_string(query, std::regex("\\+\\|\\+"));
+            assert(parts.size() > 0);
+            ExprPtr expr(compileExpr(parts.back()));
+
+            std::lock_guard<std::mutex> lock(d_mutex);
+
+            Index::iterator iter = d_index.find(query);
+            if (iter != d_index.end())
+                return iter->second->second;
+
+            d_lru.push_front(LruList::value_type(query, expr));
+            d_index[query] = d_lru.begin();
+
+            while (d_lru.size() > EXPR_CACHE_CAPACITY)
+            {
+                d_index.erase(d_lru.back().first);
+                d_lru.pop_back();
+            }
+
+            return expr;
+        }
+
+    private:
+        typedef std::list<std::pair<std::string, ExprPtr> > LruList;
+        typedef std::unordered_map<std::string, LruList::iterator> Index;
+
+        std::mutex d_mutex;
+        LruList d_lru;
+        Index d_index;
+    };
+
+    ExprCache &exprCache()
+    {
+        static ExprCache cache;
+        return cache;
+    }
+}
+
+namespace alpinocorpus {
+
+CompiledMarkersPtr CompiledMarkers::compile(
+    std::list<CorpusReader::MarkerQuery> const &queries)
+{
+    std::shared_ptr<CompiledMarkers> markers(new CompiledMarkers);
+
+    for (std::list<CorpusReader::MarkerQuery>::const_iterator iter =
+            queries.begin(); iter != queries.end(); ++iter)
+    {
+        ExprPtr expr(exprCache().get(iter->query));
+        if (!expr)
+            return CompiledMarkersPtr();
+
+        Marker marker = { expr, iter->attr, iter->value };
+        markers->d_markers.push_back(marker);
+    }
+
+    return markers;
+}
+
+std::vector<xmlNodePtr> CompiledMarkers::matches(xmlDocPtr doc,
+    size_t marker) const
+{
+    std::shared_ptr<xmlXPathContext> ctx(xmlXPathNewContext(doc),
+        xmlXPathFreeContext);
+    if (!ctx)
+        throw Error("Could not create an XPath context for marking nodes.");
+
+    std::shared_ptr<xmlXPathObject> result(
+        xmlXPathCompiledEval(d_markers.at(marker).expr.get(), ctx.get()),
+        xmlXPathFreeObject);
+    if (!result)
+        throw Error("Could not evaluate the expression on the given document.");
+
+    std::vector<xmlNodePtr> elements;
+
+    xmlNodeSetPtr nodes = result->nodesetval;
+    if (result->type != XPATH_NODESET || nodes == 0)
+        return elements;
+
+    for (int i = 0; i < nodes->nodeNr; ++i)
+        // Skip non-element nodes
+        if (nodes->nodeTab[i]->type == XML_ELEMENT_NODE)
+            elements.push_back(nodes->nodeTab[i]);
+
+    return elements;
+}
+
+void CompiledMarkers::mark(xmlDocPtr doc) const
+{
+    // Markers are added per query, so that later queries see the
+    // markers of earlier queries, as in the Xerces marker.
+    for (size_t i = 0; i < d_markers.size(); ++i)
+    {
+        std::vector<xmlNodePtr> elements(matches(doc, i));
+        for (std::vector<xmlNodePtr>::const_iterator iter = elements.begin();
+                iter != elements.end(); ++iter)
+            xmlSetProp(*iter, toXmlStr(d_markers[i].attr.c_str()),
+                toXmlStr(d_markers[i].value.c_str()));
+    }
+}
+
+std::string CompiledMarkers::transform(Stylesheet const &stylesheet,
+    std::string const &xml) const
+{
+    std::shared_ptr<xmlDoc> doc(
+        xmlReadMemory(xml.data(), xml.size(), 0, 0, 0), xmlFreeDoc);
+    if (!doc)
+        throw Error("Could not parse XML data.");
+
+    mark(doc.get());
+
+    return stylesheet.transform(doc.get());
+}
+
+}
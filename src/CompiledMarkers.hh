@@ -0,0 +1,81 @@
+#ifndef ALPINOCORPUS_COMPILEDMARKERS_HH
+#define ALPINOCORPUS_COMPILEDMARKERS_HH
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libxml/tree.h>
+#include <libxml/xpath.h>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+
+namespace alpinocorpus {
+
+class CompiledMarkers;
+class Stylesheet;
+typedef std::shared_ptr<CompiledMarkers const> CompiledMarkersPtr;
+
+/**
+ * Marker queries, compiled for evaluation on libxml2 trees. This allows
+ * callers that work on a libxml2 tree to mark nodes without serializing
+ * and parsing the entry again.
+ *
+ * Only queries in the XPath subset of SimpleXPath are compiled, since
+ * they have the same meaning in XPath 1.0 and XPath 2.0. Compiled queries
+ * are cached, so compiling the same marker queries again is cheap.
+ */
+class CompiledMarkers
+{
+public:
+    /**
+     * Compile marker queries. Returns a null pointer if one of the
+     * queries cannot be evaluated by libxml2.
+     */
+    static CompiledMarkersPtr compile(
+        std::list<CorpusReader::MarkerQuery> const &queries);
+
+    /**
+     * Get the elements that match the query of the given marker, in
+     * document order, without marking them.
+     */
+    std::vector<xmlNodePtr> matches(xmlDocPtr doc, size_t marker) const;
+
+    bool empty() const;
+
+    /**
+     * Add the marker attributes to the elements that match the queries.
+     * Can be used from multiple threads simultaneously, as long as the
+     * documents differ.
+     */
+    void mark(xmlDocPtr doc) const;
+
+    /**
+     * Parse a document, mark it, and apply a stylesheet to the marked
+     * tree. The document is only parsed once.
+     */
+    std::string transform(Stylesheet const &stylesheet,
+        std::string const &xml) const;
+
+private:
+    struct Marker
+    {
+        std::shared_ptr<xmlXPathCompExpr> expr;
+        std::string attr;
+        std::string value;
+    };
+
+    CompiledMarkers() {}
+
+    std::vector<Marker> d_markers;
+};
+
+inline bool CompiledMarkers::empty() const
+{
+    return d_markers.empty();
+}
+
+}
+
+#endif // ALPINOCORPUS_COMPILEDMARKERS_HH
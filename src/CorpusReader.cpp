@@ -1,19 +1,22 @@
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <list>
 #include <memory>
 #include <regex>
-#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <AlpinoCorpus/CorpusInfo.hh>
 #include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/DataView.hh>
 #include <AlpinoCorpus/Error.hh>
 #include <AlpinoCorpus/IterImpl.hh>
 #include <AlpinoCorpus/RecursiveCorpusReader.hh>
+#include <AlpinoCorpus/Sentence.hh>
 #include <AlpinoCorpus/Stylesheet.hh>
 
 #include <typeinfo>
@@ -31,18 +34,21 @@
 
 #include <xqilla/xqilla-dom3.hpp>
 
+#include "CompiledMarkers.hh"
 #include "FilterIter.hh"
+#include "ParallelFilterIter.hh"
+#include "ParallelStylesheetIter.hh"
+#include "PrefetchIter.hh"
+#include "QueryCache.hh"
 #include "StylesheetIter.hh"
+#include "TokenStore.hh"
+#include "util/LibXml.hh"
 #include "util/parseString.hh"
 #include "util/split.hh"
 
 namespace xerces = XERCES_CPP_NAMESPACE;
 
 namespace {
-    void ignoreStructuredError(void *userdata, xmlErrorPtr err)
-    {
-    }
-
     xmlChar const *toXmlStr(char const *str)
     {
         return reinterpret_cast<xmlChar const *>(str);
@@ -53,102 +59,210 @@ namespace {
         return reinterpret_cast<char const *>(str);
     }
 
+    // The value of an attribute. Values that consist of a single text
+    // node are returned without copying, others are copied to <i>buf</i>.
+    char const *attributeValue(xmlAttrPtr attr, std::string *buf)
+    {
+        xmlNodePtr children = attr->children;
+        if (attr->type == XML_ATTRIBUTE_NODE && children != 0 &&
+                children->type == XML_TEXT_NODE && children->next == 0)
+            return fromXmlStr(children->content);
 
-    std::vector<alpinocorpus::LexItem> collectLexicals(
-        std::shared_ptr<xmlDoc> doc,
-        std::unordered_map<xmlNode *, std::set<size_t> > const &matchDepth,
-        std::string const &attribute,
-        std::string const &defaultValue,
-        alpinocorpus::CorpusInfo const &corpusInfo)
+        buf->clear();
+        if (children != 0)
+        {
+            std::shared_ptr<xmlChar> value(xmlNodeGetContent(children), xmlFree);
+            if (value)
+                buf->assign(fromXmlStr(value.get()));
+        }
+
+        return buf->c_str();
+    }
+
+    // Parse a begin position like util::parseString, without allocating.
+    size_t parseBegin(char const *str)
+    {
+        char *end;
+        unsigned long long begin = std::strtoull(str, &end, 10);
+        return end == str ? 0 : begin;
+    }
+
+    // Elements through which query matches are propagated to the lexical
+    // nodes that they dominate.
+    bool propagatesMatches(xmlNode *node)
     {
-        std::vector<alpinocorpus::LexItem> items;
+        return std::strcmp(fromXmlStr(node->name), "node") == 0 ||
+            std::strcmp(fromXmlStr(node->name), "word") == 0 ||
+            std::strcmp(fromXmlStr(node->name), "ne") == 0;
+    }
 
-        std::shared_ptr<xmlXPathContext> xpCtx(
-            xmlXPathNewContext(doc.get()), xmlXPathFreeContext);
-        if (xpCtx == 0)
+    // Collects the lexical items of a sentence and the matches that
+    // dominate them in a single walk over the tree.
+    class SentenceWalker
+    {
+    public:
+        SentenceWalker(std::vector<xmlNodePtr> const &matches,
+                std::string const &attribute, std::string const &defaultValue,
+                alpinocorpus::CorpusInfo const &corpusInfo) :
+            d_attribute(toXmlStr(attribute.c_str())),
+            d_defaultValue(defaultValue),
+            d_lexicalElement(toXmlStr(corpusInfo.lexicalElement().c_str())),
+            d_tokenAttribute(toXmlStr(corpusInfo.tokenAttribute().c_str()))
         {
-            return items;
+            for (size_t i = 0; i < matches.size(); ++i)
+                d_matchIds[matches[i]] = i;
         }
 
-        std::ostringstream oss;
-        oss << "//" << corpusInfo.lexicalElement() <<
-          "[@" << corpusInfo.tokenAttribute() << "]";
-        std::string lexNodeQuery = oss.str();
+        alpinocorpus::Sentence walk(xmlNode *root)
+        {
+            d_sentence = alpinocorpus::Sentence();
+            d_active.clear();
 
-        std::shared_ptr<xmlXPathObject> xpObj(xmlXPathEvalExpression(
-            toXmlStr(lexNodeQuery.c_str()), xpCtx.get()), xmlXPathFreeObject);
-        if (xpObj == 0)
-            return items;
+            walk(root, false, 0);
 
-        xmlNodeSet *nodeSet = xpObj->nodesetval;
-        if (nodeSet != 0)
+            d_sentence.sort();
+
+            return std::move(d_sentence);
+        }
+
+    private:
+        // The matches that reach a node are d_active[start..]. Matches
+        // reach the children of nodes that propagate them and do not
+        // have a token themselves.
+        void walk(xmlNode *node, bool inherit, size_t start)
         {
-            for (int i = 0; i < nodeSet->nodeNr; ++i)
+            if (node->type != XML_ELEMENT_NODE)
+                return;
+
+            size_t top = d_active.size();
+            if (!inherit)
+                start = top;
+
+            if (!d_matchIds.empty())
             {
-                xmlNode *node = nodeSet->nodeTab[i];
+                std::unordered_map<xmlNode *, size_t>::const_iterator matchIter =
+                    d_matchIds.find(node);
+                if (matchIter != d_matchIds.end())
+                    d_active.push_back(matchIter->second);
+            }
 
-                if (node->type == XML_ELEMENT_NODE)
-                {
-                    xmlAttrPtr wordAttr = xmlHasProp(node, toXmlStr(attribute.c_str()));
-                    std::shared_ptr<xmlChar> word;
-                    if (wordAttr == 0)
-                      word = std::shared_ptr<xmlChar>(xmlStrdup(toXmlStr(defaultValue.c_str())), xmlFree);
-                    else
-                      word = std::shared_ptr<xmlChar>(xmlNodeGetContent(wordAttr->children), xmlFree);
-
-                    xmlAttrPtr beginAttr = xmlHasProp(node, toXmlStr("begin"));
-                    size_t begin = 0;
-                    if (beginAttr)
-                    {
-                        std::shared_ptr<xmlChar> beginStr(
-                            xmlNodeGetContent(beginAttr->children), xmlFree);
-                        try {
-                            begin = alpinocorpus::util::parseString<size_t>(fromXmlStr(beginStr.get()));
-                        } catch (std::invalid_argument &e) {
-                        }
-                    }
+            bool propagates = propagatesMatches(node);
+            bool hasToken = xmlHasProp(node, d_tokenAttribute) != 0;
 
-                    alpinocorpus::LexItem item = {fromXmlStr(word.get()), begin, std::set<size_t>() };
+            if (hasToken && node->ns == 0 &&
+                    xmlStrEqual(node->name, d_lexicalElement))
+                addItem(node, propagates ? start : d_active.size());
 
-                    auto matchIter = matchDepth.find(node);
-                    if (matchIter != matchDepth.end())
-                        item.matches = matchIter->second;
+            for (xmlNodePtr child = node->children; child != NULL;
+                    child = child->next)
+                walk(child, propagates && !hasToken, start);
 
-                    items.push_back(item);
-                }
-            }
+            d_active.resize(top);
+        }
+
+        void addItem(xmlNode *node, size_t matchesStart)
+        {
+            xmlAttrPtr wordAttr = xmlHasProp(node, d_attribute);
+            char const *word = wordAttr == 0 ? d_defaultValue.c_str() :
+                attributeValue(wordAttr, &d_wordBuf);
+
+            xmlAttrPtr beginAttr = xmlHasProp(node, toXmlStr("begin"));
+            size_t begin = beginAttr == 0 ? 0 :
+                parseBegin(attributeValue(beginAttr, &d_beginBuf));
+
+            d_sentence.push_back(word, std::strlen(word), begin,
+                d_active.data() + matchesStart, d_active.size() - matchesStart);
+        }
+
+        xmlChar const *d_attribute;
+        std::string d_defaultValue;
+        xmlChar const *d_lexicalElement;
+        xmlChar const *d_tokenAttribute;
+        std::unordered_map<xmlNode *, size_t> d_matchIds;
+
+        std::vector<size_t> d_active;
+        std::string d_wordBuf;
+        std::string d_beginBuf;
+        alpinocorpus::Sentence d_sentence;
+    };
+
+    alpinocorpus::Sentence sentenceFromTree(xmlDocPtr doc,
+        std::vector<xmlNodePtr> const &matches, std::string const &attribute,
+        std::string const &defaultValue,
+        alpinocorpus::CorpusInfo const &corpusInfo)
+    {
+        // We get the sentence node, we should process its children.
+        xmlNode *sentenceNode = xmlDocGetRootElement(doc);
+        if (sentenceNode == NULL) {
+            return alpinocorpus::Sentence();
         }
 
-        std::sort(items.begin(), items.end());
+        SentenceWalker walker(matches, attribute, defaultValue, corpusInfo);
+        return walker.walk(sentenceNode);
+    }
+
+    // Parse an entry once, evaluate the query on it and extract the
+    // sentence from the same tree.
+    alpinocorpus::Sentence extractSentence(char const *xmlData,
+        size_t size, alpinocorpus::CompiledMarkers const &markers,
+        std::string const &attribute, std::string const &defaultValue,
+        alpinocorpus::CorpusInfo const &corpusInfo)
+    {
+        std::shared_ptr<xmlDoc> doc(
+            xmlReadMemory(xmlData, size, NULL, NULL, 0), xmlFreeDoc);
+
+        if (doc == NULL)
+            return alpinocorpus::Sentence();
+
+        std::vector<xmlNodePtr> matches;
+        if (!markers.empty())
+            matches = markers.matches(doc.get(), 0);
 
-        return items;
+        return sentenceFromTree(doc.get(), matches, attribute, defaultValue,
+            corpusInfo);
     }
 
-    // The function adds one to the count of lexical nodes that are dominated
-    // by the given node. We could modify the DOM tree directly to store such
-    // counts in the lexical nodes. But frankly, manipulating the DOM tree is
-    // a drag. Since we do not modify the tree, we can keep the counts by
-    // memory adres. Ugly, but effective. Don't we love that?
-    void markLexicals(xmlNode *node, std::unordered_map<xmlNode *,
-        std::set<size_t> > *matchDepth, size_t matchId, std::string wordAttr)
+    std::list<alpinocorpus::CorpusReader::MarkerQuery> sentenceMarkers(
+        std::string const &query)
     {
-        // Don't attempt to handle a node that we can't.
-        if (node->type != XML_ELEMENT_NODE ||
-              (std::strcmp(fromXmlStr(node->name), "node") != 0 &&
-               std::strcmp(fromXmlStr(node->name), "word") != 0 &&
-               std::strcmp(fromXmlStr(node->name), "ne") != 0))
-            return;
+        auto queries = split_string(query, std::regex("\\+\\|\\+"));
+        assert(queries.size() > 0);
+
+        // Discard pre-filters
+        std::string q = queries.back();
+
+        std::list<alpinocorpus::CorpusReader::MarkerQuery> markers;
 
-        xmlAttrPtr wordProp = xmlHasProp(node, toXmlStr(wordAttr.c_str()));
-        if (wordProp != 0)
-            (*matchDepth)[node].insert(matchId);
-        else // Attempt to recurse...
+        if (!q.empty())
         {
-            for (xmlNodePtr child = node->children;
-                child != NULL; child = child->next)
-              markLexicals(child, matchDepth, matchId, wordAttr);
+            alpinocorpus::CorpusReader::MarkerQuery marker(q,
+                "alpinocorpusActive", "1");
+            markers.push_back(marker);
         }
 
+        return markers;
+    }
+
+    // A sentence without matches, from tokens with a single attribute.
+    alpinocorpus::Sentence sentenceFromTokens(
+        std::vector<alpinocorpus::Token> const &tokens)
+    {
+        size_t wordBytes = 0;
+        for (std::vector<alpinocorpus::Token>::const_iterator iter =
+                tokens.begin(); iter != tokens.end(); ++iter)
+            wordBytes += iter->values[0].size();
+
+        alpinocorpus::Sentence sentence;
+        sentence.reserve(tokens.size(), wordBytes);
+
+        for (std::vector<alpinocorpus::Token>::const_iterator iter =
+                tokens.begin(); iter != tokens.end(); ++iter)
+            sentence.push_back(iter->values[0].data(), iter->values[0].size(),
+                iter->begin, 0, 0);
+
+        sentence.sort();
+
+        return sentence;
     }
 }
 
@@ -192,13 +306,41 @@ namespace alpinocorpus {
         return getEntries(sortOrder);
     }
 
+    CorpusReader::EntryIterator CorpusReader::entriesWithContents(
+        SortOrder sortOrder) const
+    {
+        return getEntriesWithContents(sortOrder);
+    }
+
+    CorpusReader::EntryIterator CorpusReader::getEntriesWithContents(
+        SortOrder sortOrder) const
+    {
+        return getEntries(sortOrder);
+    }
+
+    CorpusReader::EntryIterator CorpusReader::getCandidateEntries(
+        std::string const &, SortOrder sortOrder) const
+    {
+        return getEntriesWithContents(sortOrder);
+    }
+
     CorpusReader::EntryIterator CorpusReader::entriesWithStylesheet(
         Stylesheet const &stylesheet,
         std::list<MarkerQuery> const &markerQueries,
-        SortOrder sortOrder) const
+        SortOrder sortOrder, size_t nThreads) const
     {
-        return EntryIterator(new StylesheetIter(getEntries(sortOrder),
-            stylesheet, markerQueries));
+        if (nThreads != 1)
+            return EntryIterator(new ParallelStylesheetIter(*this,
+                getEntriesWithContents(sortOrder), stylesheet, markerQueries,
+                nThreads));
+
+        // Prefetched contents are of no use if the reader has to mark them.
+        EntryIterator iter = getEntriesWithContents(sortOrder);
+        if (markerQueries.empty() || CompiledMarkers::compile(markerQueries))
+            iter = PrefetchIter::wrap(*this, iter);
+
+        return EntryIterator(new StylesheetIter(iter, stylesheet,
+            markerQueries));
     }
 
     bool CorpusReader::EntryIterator::hasNext()
@@ -219,6 +361,14 @@ namespace alpinocorpus {
         return d_impl->hasProgress();
     }
 
+    bool CorpusReader::EntryIterator::hasContents() const
+    {
+        if (!d_impl)
+            return false;
+
+        return d_impl->hasContents();
+    }
+
     Entry CorpusReader::EntryIterator::next(CorpusReader const &reader)
     {
       return d_impl->next(reader);
@@ -236,45 +386,43 @@ namespace alpinocorpus {
             d_impl->interrupt();
     }
 
-    std::vector<LexItem> CorpusReader::getSentence(std::string const &entry,
+    Sentence CorpusReader::getSentence(std::string const &entry,
         std::string const &query, std::string const &attribute,
         std::string const &defaultValue,
         CorpusInfo const &corpusInfo) const
     {
-        auto queries = split_string(query, std::regex("\\+\\|\\+"));
-        assert(queries.size() > 0);
+        std::list<MarkerQuery> markers(sentenceMarkers(query));
 
-        // Discard pre-filters
-        std::string q = queries.back();
-
-        std::list<MarkerQuery> markers;
+        // Without a query, there is nothing to evaluate on the tree.
+        if (markers.empty())
+            return sentenceFromTokens(getTokens(entry,
+                std::vector<std::string>(1, attribute), defaultValue,
+                corpusInfo));
 
-        if (!q.empty())
+        CompiledMarkersPtr compiled = CompiledMarkers::compile(markers);
+        if (compiled)
         {
-            MarkerQuery marker(q, "alpinocorpusActive", "1");
-            markers.push_back(marker);
+            // Evaluate the query on the tree that the sentence is
+            // extracted from, no marker attributes are necessary.
+            DataView xmlData = readView(entry);
+            return extractSentence(xmlData.data(), xmlData.size(), *compiled,
+                attribute, defaultValue, corpusInfo);
         }
-        std::string xmlData(read(entry, markers));
 
+        std::string xmlData(read(entry, markers));
         std::shared_ptr<xmlDoc> doc(
             xmlReadMemory(xmlData.c_str(), xmlData.size(), NULL, NULL, 0),
             xmlFreeDoc);
 
         if (doc == NULL)
-            return std::vector<LexItem>();
-
-        // We get the sentence node, we should process its children.
-        xmlNode *sentenceNode = xmlDocGetRootElement(doc.get());
-        if (sentenceNode == NULL) {
-            return std::vector<LexItem>();
-        }
+            return Sentence();
 
         std::shared_ptr<xmlXPathContext> xpCtx(
             xmlXPathNewContext(doc.get()), xmlXPathFreeContext);
 
         if (xpCtx == 0)
         {
-            return std::vector<LexItem>();
+            return Sentence();
         }
 
         std::shared_ptr<xmlXPathObject> xpObj(
@@ -283,24 +431,54 @@ namespace alpinocorpus {
             xmlXPathFreeObject);
         if (xpObj == 0) {
             //qDebug() << "Could not make XPath expression to select active nodes.";
-            return std::vector<LexItem>();
+            return Sentence();
         }
 
         // Do we have matches?
+        std::vector<xmlNodePtr> matches;
         xmlNodeSet *nodeSet = xpObj->nodesetval;
-        std::unordered_map<xmlNode *, std::set<size_t> > matchDepth;
         if (nodeSet != 0)
-        {
             for (int i = 0; i < nodeSet->nodeNr; ++i)
-              if (nodeSet->nodeTab[i]->type == XML_ELEMENT_NODE)
-                  markLexicals(nodeSet->nodeTab[i], &matchDepth, i,
-                      corpusInfo.tokenAttribute());
+                if (nodeSet->nodeTab[i]->type == XML_ELEMENT_NODE)
+                    matches.push_back(nodeSet->nodeTab[i]);
+
+        return sentenceFromTree(doc.get(), matches, attribute, defaultValue,
+            corpusInfo);
+    }
+
+    std::vector<Sentence> CorpusReader::getSentences(
+        std::vector<std::string> const &entries, std::string const &query,
+        std::string const &attribute, std::string const &defaultValue,
+        CorpusInfo const &corpusInfo) const
+    {
+        std::vector<Sentence> sentences;
+        sentences.reserve(entries.size());
+
+        std::list<MarkerQuery> markers(sentenceMarkers(query));
+
+        CompiledMarkersPtr compiled = CompiledMarkers::compile(markers);
+        if (!compiled || markers.empty())
+        {
+            for (std::vector<std::string>::const_iterator iter = entries.begin();
+                    iter != entries.end(); ++iter)
+                sentences.push_back(getSentence(*iter, query, attribute,
+                    defaultValue, corpusInfo));
+
+            return sentences;
         }
 
-        std::vector<LexItem> items = collectLexicals(doc, matchDepth,
-            attribute, defaultValue, corpusInfo);
+        std::vector<std::string> contents(readMany(entries));
+        for (std::vector<std::string>::iterator iter = contents.begin();
+                iter != contents.end(); ++iter)
+        {
+            sentences.push_back(extractSentence(iter->data(), iter->size(),
+                *compiled, attribute, defaultValue, corpusInfo));
+
+            // Release the entry as soon as possible.
+            std::string().swap(*iter);
+        }
 
-        return items;
+        return sentences;
     }
 
     
@@ -343,10 +521,63 @@ namespace alpinocorpus {
 
         return readEntryMarkQueries(entry, effectiveQueries);
     }
+
+    DataView CorpusReader::readView(std::string const &entry) const
+    {
+        return readEntryView(entry);
+    }
+
+    DataView CorpusReader::readEntryView(std::string const &entry) const
+    {
+        return DataView(readEntry(entry));
+    }
+
+    std::vector<std::string> CorpusReader::readMany(
+        std::vector<std::string> const &entries) const
+    {
+        return readEntries(entries);
+    }
+
+    std::vector<std::string> CorpusReader::readEntries(
+        std::vector<std::string> const &entries) const
+    {
+        std::vector<std::string> contents;
+        contents.reserve(entries.size());
+
+        for (std::vector<std::string>::const_iterator iter = entries.begin();
+                iter != entries.end(); ++iter)
+            contents.push_back(readEntry(*iter));
+
+        return contents;
+    }
         
     std::string CorpusReader::readEntryMarkQueries(std::string const &entry,
         std::list<MarkerQuery> const &queries) const
     {
+        CompiledMarkersPtr markers = CompiledMarkers::compile(queries);
+        if (markers)
+        {
+            DataView content = readView(entry);
+
+            std::shared_ptr<xmlDoc> doc(
+                xmlReadMemory(content.data(), content.size(), NULL, NULL, 0),
+                xmlFreeDoc);
+            if (!doc)
+                throw Error("Could not parse XML data.");
+
+            markers->mark(doc.get());
+
+            xmlChar *bareOutput = 0;
+            int outputLen = 0;
+            xmlDocDumpMemoryEnc(doc.get(), &bareOutput, &outputLen, "UTF-8");
+            std::shared_ptr<xmlChar> output(bareOutput, xmlFree);
+            if (!output)
+                throw Error("Could not serialize marked XML data.");
+
+            return std::string(fromXmlStr(output.get()), outputLen);
+        }
+
+        // Fall back to XQilla for queries that libxml2 cannot evaluate.
         std::string content = read(entry);
         
         // Prepare the DOM parser.
@@ -460,10 +691,60 @@ namespace alpinocorpus {
     std::vector<LexItem> CorpusReader::sentence(std::string const &entry,
         std::string const &query, std::string const &attribute,
         std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+    {
+        return getSentence(entry, query, attribute, defaultValue,
+            corpusInfo).lexItems();
+    }
+
+    std::vector<std::vector<LexItem> > CorpusReader::sentences(
+        std::vector<std::string> const &entries, std::string const &query,
+        std::string const &attribute, std::string const &defaultValue,
+        CorpusInfo const &corpusInfo) const
+    {
+        std::vector<Sentence> compact(getSentences(entries, query, attribute,
+            defaultValue, corpusInfo));
+
+        std::vector<std::vector<LexItem> > sentences;
+        sentences.reserve(compact.size());
+        for (std::vector<Sentence>::const_iterator iter = compact.begin();
+                iter != compact.end(); ++iter)
+            sentences.push_back(iter->lexItems());
+
+        return sentences;
+    }
+
+    Sentence CorpusReader::compactSentence(std::string const &entry,
+        std::string const &query, std::string const &attribute,
+        std::string const &defaultValue, CorpusInfo const &corpusInfo) const
     {
         return getSentence(entry, query, attribute, defaultValue, corpusInfo);
     }
 
+    std::vector<Sentence> CorpusReader::compactSentences(
+        std::vector<std::string> const &entries, std::string const &query,
+        std::string const &attribute, std::string const &defaultValue,
+        CorpusInfo const &corpusInfo) const
+    {
+        return getSentences(entries, query, attribute, defaultValue,
+            corpusInfo);
+    }
+
+    std::vector<Token> CorpusReader::getTokens(std::string const &entry,
+        std::vector<std::string> const &attributes,
+        std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+    {
+        DataView xmlData = readView(entry);
+        return extractTokens(xmlData.data(), xmlData.size(), attributes,
+            defaultValue, corpusInfo);
+    }
+
+    std::vector<Token> CorpusReader::tokens(std::string const &entry,
+        std::vector<std::string> const &attributes,
+        std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+    {
+        return getTokens(entry, attributes, defaultValue, corpusInfo);
+    }
+
     std::string CorpusReader::type() const {
       if (d_type)
         return *d_type;
@@ -508,6 +789,26 @@ namespace alpinocorpus {
     {
         return getSize();
     }
+
+    void CorpusReader::setQueryCacheCapacity(size_t capacity)
+    {
+        QueryCache::instance().setCapacity(capacity);
+    }
+
+    CorpusReader::QueryCacheStats CorpusReader::queryCacheStats()
+    {
+        return QueryCache::instance().stats();
+    }
+
+    void CorpusReader::clearQueryCache()
+    {
+        QueryCache::instance().clear();
+    }
+
+    void CorpusReader::setPrefetchLimits(size_t depth, size_t maxMemory)
+    {
+        PrefetchIter::setDefaultLimits(depth, maxMemory);
+    }
     
     Either<std::string, Empty> CorpusReader::validQuery(QueryDialect d, bool variables, std::string const &query) const
     {
@@ -524,7 +825,7 @@ namespace alpinocorpus {
             xmlXPathFreeContext);
         if (!variables)
             ctx->flags = XML_XPATH_NOVAR;
-        xmlSetStructuredErrorFunc(ctx.get(), &ignoreStructuredError);
+        xmlSetStructuredErrorFunc(ctx.get(), &util::ignoreStructuredError);
         
         // Compile expression
         std::shared_ptr<xmlXPathCompExpr> r(
@@ -558,25 +859,47 @@ namespace alpinocorpus {
             throw NotImplemented("unknown query language");
     }
 
+    CorpusReader::EntryIterator CorpusReader::parallelQuery(
+        std::string const &q, size_t nThreads, bool preserveOrder,
+        SortOrder sortOrder) const
+    {
+        auto queries = split_string(q, std::regex("\\+\\|\\+"));
+        assert(queries.size() > 0);
+
+        EntryIterator qIter = runParallelXPath(queries[0], nThreads,
+            preserveOrder, sortOrder);
+        for (std::vector<std::string>::const_iterator iter = queries.begin() + 1;
+                iter != queries.end(); ++iter)
+            qIter = EntryIterator(new ParallelFilterIter(*this, qIter, *iter,
+                nThreads, preserveOrder));
+
+        return qIter;
+    }
+
     CorpusReader::EntryIterator CorpusReader::queryWithStylesheet(
         QueryDialect d, std::string const &query,
       Stylesheet const &stylesheet,
       std::list<MarkerQuery> const &markerQueries,
-      SortOrder sortOrder) const
+      SortOrder sortOrder, size_t nThreads) const
     {
       return runQueryWithStylesheet(d, query, stylesheet, markerQueries,
-          sortOrder);
+          sortOrder, nThreads);
     }
 
     CorpusReader::EntryIterator CorpusReader::runQueryWithStylesheet(
         QueryDialect d, std::string const &q,
       Stylesheet const &stylesheet,
       std::list<MarkerQuery> const &markerQueries,
-      SortOrder sortOrder) const
+      SortOrder sortOrder, size_t nThreads) const
     {
         if (d == XQUERY)
             throw NotImplemented(typeid(*this).name(),
                 "XQuery functionality");
+
+        if (nThreads != 1)
+            return EntryIterator(new ParallelStylesheetIter(*this,
+                query(XPATH, q, sortOrder), stylesheet, markerQueries,
+                nThreads));
         
         return EntryIterator(new StylesheetIter(query(XPATH, q, sortOrder),
               stylesheet, markerQueries));
@@ -586,7 +909,18 @@ namespace alpinocorpus {
         SortOrder sortOrder) const
     {        
         //throw NotImplemented(typeid(*this).name(), "XQuery functionality");
-        return EntryIterator(new FilterIter(*this, getEntries(sortOrder), query));
+        return EntryIterator(new FilterIter(*this,
+            PrefetchIter::wrap(*this, getCandidateEntries(query, sortOrder)),
+            query));
+    }
+
+    CorpusReader::EntryIterator CorpusReader::runParallelXPath(
+        std::string const &query, size_t nThreads, bool preserveOrder,
+        SortOrder sortOrder) const
+    {
+        return EntryIterator(new ParallelFilterIter(*this,
+            getCandidateEntries(query, sortOrder), query, nThreads,
+            preserveOrder));
     }
 
     CorpusReader::EntryIterator CorpusReader::runXQuery(std::string const &,
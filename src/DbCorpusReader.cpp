@@ -53,11 +53,24 @@ std::string DbCorpusReader::readEntry(std::string const &entry) const
     return d_private->readEntry(entry);
 }
 
+std::vector<std::string> DbCorpusReader::readEntries(
+    std::vector<std::string> const &entries) const
+{
+    return d_private->readEntries(entries);
+}
+
 CorpusReader::EntryIterator DbCorpusReader::runXPath(std::string const &query, SortOrder sortOrder) const
 {
     return d_private->runXPath(query, sortOrder);
 }
 
+CorpusReader::EntryIterator DbCorpusReader::runParallelXPath(
+    std::string const &query, size_t, bool, SortOrder sortOrder) const
+{
+    // DB XML evaluates queries itself, using its indexes.
+    return d_private->runXPath(query, sortOrder);
+}
+
 CorpusReader::EntryIterator DbCorpusReader::runXQuery(std::string const &query, SortOrder sortOrder) const
 {
     return d_private->runXQuery(query, sortOrder);
@@ -1,8 +1,15 @@
+#include <algorithm>
+#include <cstdint>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
+#include <vector>
+
+#include <boost/filesystem.hpp>
 
 #include <dbxml/DbXml.hpp>
 
@@ -12,15 +19,26 @@
 #include <AlpinoCorpus/util/Either.hh>
 
 #include "DbCorpusReaderPrivate.hh"
+#include "EntryOrder.hh"
+#include "util/NameCompare.hh"
 #include "util/url.hh"
 
+namespace bf = boost::filesystem;
 namespace db = DbXml;
 
+namespace {
+    char const * const ORDER_EXT = ".order";
+}
+
 namespace alpinocorpus {
 
 /* begin() */
-DbCorpusReaderPrivate::DbIter::DbIter(db::XmlContainer &container)
+DbCorpusReaderPrivate::DbIter::DbIter(db::XmlContainer &container,
+    std::mutex &mutex_)
+ : mutex(&mutex_)
 {
+    std::lock_guard<std::mutex> lock(*mutex);
+
     try {
         r = container.getAllDocuments( db::DBXML_LAZY_DOCS
                                      | db::DBXML_WELL_FORMED_ONLY
@@ -31,15 +49,32 @@ DbCorpusReaderPrivate::DbIter::DbIter(db::XmlContainer &container)
 }
 
 /* query */
-DbCorpusReaderPrivate::DbIter::DbIter(db::XmlResults const &r_)
- : r(r_)
+DbCorpusReaderPrivate::DbIter::DbIter(db::XmlResults const &r_,
+    std::mutex &mutex_)
+ : r(r_), mutex(&mutex_)
 {
 }
 
 /* end() */
-DbCorpusReaderPrivate::DbIter::DbIter(db::XmlManager &mgr)
- : r(mgr.createResults())   // builds empty XmlResults
+DbCorpusReaderPrivate::DbIter::DbIter(db::XmlManager &mgr, std::mutex &mutex_)
+ : mutex(&mutex_)
+{
+    std::lock_guard<std::mutex> lock(*mutex);
+    r = mgr.createResults();   // builds empty XmlResults
+}
+
+DbCorpusReaderPrivate::DbIter::DbIter(DbIter const &other)
+ : IterImpl(other), mutex(other.mutex)
+{
+    std::lock_guard<std::mutex> lock(*mutex);
+    r = other.r;
+}
+
+DbCorpusReaderPrivate::DbIter::~DbIter()
 {
+    // Releasing the results can close database cursors.
+    std::lock_guard<std::mutex> lock(*mutex);
+    r = db::XmlResults();
 }
 
 IterImpl *DbCorpusReaderPrivate::DbIter::copy() const
@@ -55,6 +90,8 @@ IterImpl *DbCorpusReaderPrivate::DbIter::copy() const
 
 bool DbCorpusReaderPrivate::DbIter::hasNext()
 {
+  std::lock_guard<std::mutex> lock(*mutex);
+
   try {
       return r.hasNext();
     } catch (db::XmlException const &e) {
@@ -68,6 +105,8 @@ bool DbCorpusReaderPrivate::DbIter::hasNext()
 /* operator++ */
 Entry DbCorpusReaderPrivate::DbIter::next(CorpusReader const &)
 {
+    std::lock_guard<std::mutex> lock(*mutex);
+
     db::XmlValue v;
 
     try {
@@ -99,13 +138,15 @@ Entry DbCorpusReaderPrivate::DbIter::next(CorpusReader const &)
     return e;
 }
 
-DbCorpusReaderPrivate::QueryIter::QueryIter(db::XmlResults const &r, db::XmlQueryContext const &ctx)
- : DbIter(r), context(ctx)
+DbCorpusReaderPrivate::QueryIter::QueryIter(db::XmlResults const &r,
+    db::XmlQueryContext const &ctx, std::mutex &mutex)
+ : DbIter(r, mutex), context(ctx)
 {
 }
 
 void DbCorpusReaderPrivate::QueryIter::interrupt()
 {
+    // Does not take the mutex, the query that is interrupted holds it.
     context.interruptQuery();
 }
 
@@ -115,8 +156,32 @@ IterImpl *DbCorpusReaderPrivate::QueryIter::copy() const
 
     return new QueryIter(*this);
 }
+DbCorpusReaderPrivate::NameIter::NameIter(
+    std::shared_ptr<std::vector<std::string> const> names_)
+ : names(names_), pos(0)
+{
+}
+
+IterImpl *DbCorpusReaderPrivate::NameIter::copy() const
+{
+    // The list of names is immutable, so it can be shared.
+    return new NameIter(*this);
+}
+
+bool DbCorpusReaderPrivate::NameIter::hasNext()
+{
+    return pos != names->size();
+}
+
+Entry DbCorpusReaderPrivate::NameIter::next(CorpusReader const &)
+{
+    Entry e = {(*names)[pos], ""};
+    ++pos;
+    return e;
+}
+
 DbCorpusReaderPrivate::DbCorpusReaderPrivate(std::string const &path)
- : mgr(db::DBXML_ALLOW_EXTERNAL_ACCESS), container()
+ : mgr(db::DBXML_ALLOW_EXTERNAL_ACCESS), container(), containerPath(path)
 {
     try {
         db::XmlContainerConfig config;
@@ -136,16 +201,89 @@ DbCorpusReaderPrivate::~DbCorpusReaderPrivate()
 
 CorpusReader::EntryIterator DbCorpusReaderPrivate::getEntries(SortOrder sortOrder) const
 {
-    return EntryIterator(new DbIter(container));
+    if (sortOrder == NumericalOrder)
+        return EntryIterator(new NameIter(sortedNames()));
+
+    return EntryIterator(new DbIter(container, readMutex));
+}
+
+std::shared_ptr<std::vector<std::string> const>
+    DbCorpusReaderPrivate::sortedNames() const
+{
+    // Use the order that is stored next to the container, if it is up
+    // to date. Document names cannot be found by their position, so the
+    // names are stored as well.
+    std::string orderPath = containerPath + ORDER_EXT;
+    bf::path orderP(orderPath);
+    boost::system::error_code err;
+    if (bf::is_regular_file(orderP, err) &&
+        bf::last_write_time(orderP, err) >= bf::last_write_time(containerPath, err) &&
+        !err)
+    {
+        try {
+            EntryOrder order(orderPath);
+            std::shared_ptr<std::vector<std::string> > names(
+                new std::vector<std::string>(order.names()));
+            if (order.size() == getSize() && names->size() == order.size())
+                return names;
+        } catch (std::runtime_error const &) {
+        }
+    }
+
+    std::vector<std::string> names;
+    NameKeys keys;
+
+    std::lock_guard<std::mutex> lock(readMutex);
+
+    try {
+        db::XmlResults r = container.getAllDocuments(db::DBXML_LAZY_DOCS
+                                                   | db::DBXML_WELL_FORMED_ONLY
+                                                   );
+        db::XmlDocument doc;
+        while (r.next(doc))
+        {
+            names.push_back(doc.getName());
+            keys.push_back(names.back());
+        }
+    } catch (db::XmlException const &e) {
+        throw Error(e.what());
+    }
+
+    std::vector<uint32_t> order = keys.order();
+
+    std::shared_ptr<std::vector<std::string> > sorted(
+        new std::vector<std::string>);
+    sorted->reserve(names.size());
+    for (std::vector<uint32_t>::const_iterator iter = order.begin();
+            iter != order.end(); ++iter)
+        sorted->push_back(names[*iter]);
+
+    // Store the order for later readers, if the container directory
+    // is writable.
+    try {
+        writeEntryOrder(orderPath, order, *sorted);
+    } catch (std::runtime_error const &) {
+    }
+
+    return sorted;
 }
 
 std::string DbCorpusReaderPrivate::getName() const
 {
+    std::lock_guard<std::mutex> lock(readMutex);
     return container.getName();
 }
 
+size_t DbCorpusReaderPrivate::getSize() const
+{
+    std::lock_guard<std::mutex> lock(readMutex);
+    return container.getNumDocuments();
+}
+
 Either<std::string, Empty> DbCorpusReaderPrivate::validQuery(QueryDialect d, bool variables, std::string const &query) const
 {
+    std::lock_guard<std::mutex> lock(readMutex);
+
     try {
         db::XmlQueryContext ctx = mgr.createQueryContext();
         mgr.prepare(query, ctx);
@@ -159,6 +297,8 @@ Either<std::string, Empty> DbCorpusReaderPrivate::validQuery(QueryDialect d, boo
 
 std::string DbCorpusReaderPrivate::readEntry(std::string const &filename) const
 {
+    std::lock_guard<std::mutex> lock(readMutex);
+
     try {
         db::XmlDocument doc(container.getDocument(filename, db::DBXML_LAZY_DOCS));
         std::string content;
@@ -174,6 +314,25 @@ std::string DbCorpusReaderPrivate::readEntry(std::string const &filename) const
     }
 }
 
+std::vector<std::string> DbCorpusReaderPrivate::readEntries(
+    std::vector<std::string> const &entries) const
+{
+    // Documents are stored in a B-tree that is ordered by name, fetching
+    // them in name order gives better page locality.
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(),
+        [&entries](size_t a, size_t b) { return entries[a] < entries[b]; });
+
+    std::vector<std::string> contents(entries.size());
+    for (std::vector<size_t>::const_iterator iter = order.begin();
+            iter != order.end(); ++iter)
+        contents[*iter] = readEntry(entries[*iter]);
+
+    return contents;
+}
+
 CorpusReader::EntryIterator DbCorpusReaderPrivate::runXPath(std::string const &query, SortOrder sortOrder) const
 {
     return runXQuery(std::string("collection('corpus')" + query), sortOrder);
@@ -184,19 +343,27 @@ CorpusReader::EntryIterator DbCorpusReaderPrivate::runXQuery(std::string const &
 {
     // XXX use DBXML_DOCUMENT_PROJECTION and return to whole-doc containers?
 
-    try {
-        db::XmlQueryContext ctx
-            = mgr.createQueryContext(db::XmlQueryContext::LiveValues,
-                                     db::XmlQueryContext::Lazy);
-        ctx.setDefaultCollection(collection);
-        db::XmlResults r(mgr.query(query, ctx,
-                                     db::DBXML_LAZY_DOCS
-                                   | db::DBXML_WELL_FORMED_ONLY
-                                  ));
-        return EntryIterator(new QueryIter(r, ctx));
-    } catch (db::XmlException const &e) {
-        throw Error(e.what());
+    // The iterator is wrapped after unlocking, copying it takes the lock.
+    IterImpl *iter;
+    {
+        std::lock_guard<std::mutex> lock(readMutex);
+
+        try {
+            db::XmlQueryContext ctx
+                = mgr.createQueryContext(db::XmlQueryContext::LiveValues,
+                                         db::XmlQueryContext::Lazy);
+            ctx.setDefaultCollection(collection);
+            db::XmlResults r(mgr.query(query, ctx,
+                                         db::DBXML_LAZY_DOCS
+                                       | db::DBXML_WELL_FORMED_ONLY
+                                      ));
+            iter = new QueryIter(r, ctx, readMutex);
+        } catch (db::XmlException const &e) {
+            throw Error(e.what());
+        }
     }
+
+    return EntryIterator(iter);
 }
 
 /*
@@ -1,5 +1,8 @@
 #include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <dbxml/DbXml.hpp>
 
@@ -18,11 +21,18 @@ class DbCorpusReaderPrivate : public CorpusReader
     DbXml::XmlContainer mutable container;
     std::string collection;
 
+    // Serializes all use of the manager and container, including the
+    // advancement of iterators on other threads: the container is not
+    // opened in a free-threaded environment.
+    std::mutex mutable readMutex;
+    std::string containerPath;
+
     class DbIter : public IterImpl
     {
     public:
-        DbIter(DbXml::XmlContainer &);
-        DbIter(DbXml::XmlManager &);
+        DbIter(DbXml::XmlContainer &, std::mutex &);
+        DbIter(DbXml::XmlManager &, std::mutex &);
+        ~DbIter();
 
         virtual IterImpl *copy() const;
         bool hasNext();
@@ -30,14 +40,17 @@ class DbCorpusReaderPrivate : public CorpusReader
 
     protected:
         mutable DbXml::XmlResults r;
+        std::mutex *mutex;
 
-        DbIter(DbXml::XmlResults const &);
+        DbIter(DbXml::XmlResults const &, std::mutex &);
+        DbIter(DbIter const &);
     };
 
     class QueryIter : public DbIter
     {
     public:
-        QueryIter(DbXml::XmlResults const &, DbXml::XmlQueryContext const &);
+        QueryIter(DbXml::XmlResults const &, DbXml::XmlQueryContext const &,
+            std::mutex &);
         IterImpl *copy() const;
         void interrupt();
 
@@ -45,22 +58,35 @@ class DbCorpusReaderPrivate : public CorpusReader
         DbXml::XmlQueryContext context;
     };
 
+    /** Iterate over a list of entry names. */
+    class NameIter : public IterImpl
+    {
+    public:
+        NameIter(std::shared_ptr<std::vector<std::string> const> names);
+        IterImpl *copy() const;
+        bool hasNext();
+        Entry next(CorpusReader const &);
+
+    private:
+        std::shared_ptr<std::vector<std::string> const> names;
+        size_t pos;
+    };
+
 public:
     DbCorpusReaderPrivate(std::string const &);
     virtual ~DbCorpusReaderPrivate();
     EntryIterator getEntries(SortOrder sortOrder) const;
     std::string getName() const;
-    size_t getSize() const
-    {
-        return const_cast<DbXml::XmlContainer &>(container).getNumDocuments();
-    }
+    size_t getSize() const;
     Either<std::string, Empty> validQuery(QueryDialect d, bool variables, std::string const &query) const;
     std::string readEntry(std::string const &) const;
+    std::vector<std::string> readEntries(std::vector<std::string> const &) const;
     EntryIterator runXPath(std::string const &, SortOrder) const;
     EntryIterator runXQuery(std::string const &, SortOrder) const;
 
 private:
     void setNameAndCollection(std::string const &);
+    std::shared_ptr<std::vector<std::string> const> sortedNames() const;
 
 };
 
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -16,6 +17,11 @@
 namespace bf = boost::filesystem;
 namespace db = DbXml;
 
+namespace {
+    // Number of entries that is read at once when copying a corpus.
+    size_t const READ_BATCH_SIZE = 256;
+}
+
 namespace alpinocorpus {
     class DbCorpusWriterPrivate : public util::NonCopyable
     {
@@ -113,11 +119,20 @@ namespace alpinocorpus {
     void DbCorpusWriterPrivate::writeFailFirst(CorpusReader const &corpus,
         db::XmlUpdateContext &ctx)
     {
+        // Read entries in batches, so that the reader can read them in the
+        // order that is most efficient for the reader.
+        std::vector<std::string> names;
+
         CorpusReader::EntryIterator i = corpus.entries();
         while (i.hasNext())
         {
-            Entry entry = i.next(corpus);
-            write(entry.name, corpus.read(entry.name), ctx);
+            names.clear();
+            while (names.size() < READ_BATCH_SIZE && i.hasNext())
+                names.push_back(i.next(corpus).name);
+
+            std::vector<std::string> contents(corpus.readMany(names));
+            for (size_t j = 0; j < names.size(); ++j)
+                write(names[j], contents[j], ctx);
         }
     }
 
@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/DirectoryCorpusReader.hh>
@@ -37,4 +38,10 @@ std::string DirectoryCorpusReader::readEntry(std::string const &entry) const
   return d_private->readEntry(entry);
 }
 
+std::vector<std::string> DirectoryCorpusReader::readEntries(
+    std::vector<std::string> const &entries) const
+{
+  return d_private->readEntries(entries);
+}
+
 }   // namespace alpinocorpus
@@ -1,10 +1,13 @@
 #include <algorithm>
 #include <fstream>
+#include <future>
 #include <iterator>
 #include <limits>
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
+#include <utility>
+#include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
@@ -16,10 +19,14 @@
 #include "DirectoryCorpusReaderPrivate.hh"
 #include "util/NameCompare.hh"
 #include "util/textfile.hh"
+#include "util/ThreadPool.hh"
 
 namespace bf = boost::filesystem;
 
 namespace {
+    // Maximum number of threads used to read files concurrently.
+    size_t const MAX_READ_THREADS = 8;
+
     class DirIter : public alpinocorpus::IterImpl
     {
         boost::filesystem::path d_directory;
@@ -107,6 +114,9 @@ namespace {
     SortedDirIter::SortedDirIter(
         bf::path const &path, bf::recursive_directory_iterator i)
     {
+        std::vector<std::string> entries;
+        alpinocorpus::NameKeys keys;
+
         for (; i != bf::recursive_directory_iterator(); i++)
         {
             std::string entryPathStr = i->path().string();
@@ -115,11 +125,16 @@ namespace {
             if (entryPathStr[0] == '/')
                 entryPathStr.erase(0, 1);
 
-            d_entries.push_back(entryPathStr);
+            keys.push_back(entryPathStr);
+            entries.push_back(entryPathStr);
         }
 
-        std::sort(d_entries.begin(), d_entries.end(),
-            alpinocorpus::NameCompare());
+        // Sort on keys that are computed once per entry.
+        std::vector<uint32_t> order = keys.order();
+        d_entries.reserve(entries.size());
+        for (std::vector<uint32_t>::const_iterator iter = order.begin();
+                iter != order.end(); ++iter)
+            d_entries.push_back(std::move(entries[*iter]));
 
         d_iter = d_entries.begin();
     }
@@ -236,6 +251,42 @@ std::string DirectoryCorpusReaderPrivate::readEntry(std::string const &entry) co
     return util::readFile(p.string());
 }
 
+std::vector<std::string> DirectoryCorpusReaderPrivate::readEntries(
+    std::vector<std::string> const &entries) const
+{
+    std::vector<std::string> contents(entries.size());
+
+    if (entries.size() < 2)
+    {
+        if (!entries.empty())
+            contents[0] = readEntry(entries[0]);
+        return contents;
+    }
+
+    // Every entry is a separate file, overlap the reads.
+    std::vector<std::future<std::string> > pending;
+    pending.reserve(entries.size());
+
+    {
+        util::ThreadPool pool(std::min(entries.size(),
+            std::min(util::ThreadPool::defaultSize(), MAX_READ_THREADS)));
+
+        for (std::vector<std::string>::const_iterator iter = entries.begin();
+                iter != entries.end(); ++iter)
+        {
+            std::string entry = *iter;
+            pending.push_back(pool.submit([this, entry]() {
+                return readEntry(entry);
+            }));
+        }
+
+        for (size_t i = 0; i < pending.size(); ++i)
+            contents[i] = pending[i].get();
+    }
+
+    return contents;
+}
+
 bf::path DirectoryCorpusReaderPrivate::cachePath() const
 {
     return d_directory.parent_path() / d_directory.filename().replace_extension(".dir_index");
@@ -29,6 +29,8 @@ public:
     virtual EntryIterator getEntries(SortOrder sortOrder) const;
     virtual std::string getName() const;
     virtual std::string readEntry(std::string const &entry) const;
+    virtual std::vector<std::string> readEntries(
+        std::vector<std::string> const &entries) const;
     virtual size_t getSize() const;
 
 private:
@@ -0,0 +1,221 @@
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+#include <sys/stat.h>
+
+#include "DzChunkCache.hh"
+
+#ifdef __APPLE__
+#define MTIME_SEC(st) ((st).st_mtimespec.tv_sec)
+#define MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#else
+#define MTIME_SEC(st) ((st).st_mtim.tv_sec)
+#define MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+namespace {
+	// Room for roughly 140 chunks with the default dictzip chunk size.
+	size_t const DEFAULT_CAPACITY = 8 * 1024 * 1024;
+}
+
+namespace alpinocorpus {
+
+DzChunkCache::DzChunkCache() :
+	d_nextId(0), d_clock(0), d_capacity(DEFAULT_CAPACITY), d_size(0),
+	d_hits(0), d_misses(0)
+{
+}
+
+DzChunkCache &DzChunkCache::instance()
+{
+	static DzChunkCache cache;
+	return cache;
+}
+
+DzChunkCache::Shard &DzChunkCache::shard(Key const &key)
+{
+	return d_shards[KeyHash()(key) % N_SHARDS];
+}
+
+size_t DzChunkCache::fileId(std::string const &filename)
+{
+	FileIdentity identity(0, 0, 0, 0, 0);
+
+	// If the file cannot be stat'ed, it gets its own identifier.
+	struct stat st;
+	bool known = stat(filename.c_str(), &st) == 0;
+	if (known)
+		identity = FileIdentity(st.st_dev, st.st_ino, MTIME_SEC(st),
+			MTIME_NSEC(st), st.st_size);
+
+	std::lock_guard<std::mutex> lock(d_fileMutex);
+
+	if (known)
+	{
+		FileIdMap::const_iterator iter = d_fileIds.find(identity);
+		if (iter != d_fileIds.end())
+			return iter->second;
+	}
+
+	size_t id = d_nextId++;
+
+	if (known)
+		d_identities[id] = d_fileIds.insert(
+			FileIdMap::value_type(identity, id)).first;
+
+	return id;
+}
+
+// Should be called with d_fileMutex held, when a chunk of the file is
+// removed from the cache.
+void DzChunkCache::release(size_t fileId)
+{
+	std::unordered_map<size_t, size_t>::iterator count =
+		d_chunkCounts.find(fileId);
+	if (--count->second != 0)
+		return;
+
+	d_chunkCounts.erase(count);
+
+	std::unordered_map<size_t, FileIdMap::iterator>::iterator identity =
+		d_identities.find(fileId);
+	if (identity != d_identities.end())
+	{
+		d_fileIds.erase(identity->second);
+		d_identities.erase(identity);
+	}
+}
+
+DzChunkCache::ChunkPtr DzChunkCache::get(size_t fileId, size_t chunk)
+{
+	if (d_capacity == 0)
+		return ChunkPtr();
+
+	Key key(fileId, chunk);
+	Shard &s = shard(key);
+
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	LruMap::iterator iter = s.index.find(key);
+	if (iter == s.index.end())
+	{
+		++d_misses;
+		return ChunkPtr();
+	}
+
+	++d_hits;
+
+	// Move to the front, this is now the most recently used chunk.
+	s.lru.splice(s.lru.begin(), s.lru, iter->second);
+	iter->second->lastUse = ++d_clock;
+
+	return iter->second->data;
+}
+
+void DzChunkCache::insert(size_t fileId, size_t chunk, ChunkPtr data)
+{
+	if (data->size() > d_capacity)
+		return;
+
+	Key key(fileId, chunk);
+	Shard &s = shard(key);
+
+	{
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		// Another thread could have inflated the same chunk.
+		if (s.index.find(key) != s.index.end())
+			return;
+
+		CacheEntry entry = {key, data, ++d_clock};
+		s.lru.push_front(entry);
+		s.index[key] = s.lru.begin();
+		d_size += data->size();
+
+		std::lock_guard<std::mutex> fileLock(d_fileMutex);
+		++d_chunkCounts[fileId];
+	}
+
+	evict();
+}
+
+// Should be called with the shard's mutex held.
+void DzChunkCache::removeLast(Shard *s)
+{
+	CacheEntry const &last = s->lru.back();
+	d_size -= last.data->size();
+	s->index.erase(last.key);
+
+	{
+		std::lock_guard<std::mutex> fileLock(d_fileMutex);
+		release(last.key.first);
+	}
+
+	s->lru.pop_back();
+}
+
+void DzChunkCache::evict()
+{
+	while (d_size > d_capacity)
+	{
+		// Find the shard with the least recently used chunk. Only one
+		// shard is locked at a time, so the chunk could have been used
+		// or removed when we get to it, but then we only evict a chunk
+		// that was used a bit more recently.
+		Shard *oldest = 0;
+		size_t oldestUse = 0;
+		for (size_t i = 0; i < N_SHARDS; ++i)
+		{
+			std::lock_guard<std::mutex> lock(d_shards[i].mutex);
+			if (!d_shards[i].lru.empty() &&
+					(oldest == 0 || d_shards[i].lru.back().lastUse < oldestUse))
+			{
+				oldest = &d_shards[i];
+				oldestUse = d_shards[i].lru.back().lastUse;
+			}
+		}
+
+		if (oldest == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(oldest->mutex);
+		if (!oldest->lru.empty())
+			removeLast(oldest);
+	}
+}
+
+void DzChunkCache::setCapacity(size_t capacity)
+{
+	d_capacity = capacity;
+	evict();
+}
+
+size_t DzChunkCache::capacity() const
+{
+	return d_capacity;
+}
+
+DzChunkCache::Stats DzChunkCache::stats() const
+{
+	Stats stats = {d_hits, d_misses, d_size, d_capacity};
+	return stats;
+}
+
+void DzChunkCache::clear()
+{
+	// Forget the files of the removed chunks, as eviction does. Readers
+	// keep using their identifier, which is never handed out again.
+	for (size_t i = 0; i < N_SHARDS; ++i)
+	{
+		std::lock_guard<std::mutex> lock(d_shards[i].mutex);
+		while (!d_shards[i].lru.empty())
+			removeLast(&d_shards[i]);
+	}
+
+	d_hits = 0;
+	d_misses = 0;
+}
+
+}
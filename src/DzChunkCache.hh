@@ -0,0 +1,131 @@
+#ifndef DZ_CHUNK_CACHE_HH
+#define DZ_CHUNK_CACHE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace alpinocorpus {
+
+/**
+ * Process-wide LRU cache of decompressed dictzip chunks, shared by all
+ * dictzip readers. The cache is bounded by the total number of
+ * uncompressed bytes that it holds.
+ *
+ * Chunks are divided over shards by their key, each with its own lock
+ * and LRU list, so that concurrent readers rarely wait for each other.
+ */
+class DzChunkCache
+{
+public:
+	typedef std::vector<unsigned char> Chunk;
+	typedef std::shared_ptr<Chunk const> ChunkPtr;
+
+	struct Stats
+	{
+		size_t hits;
+		size_t misses;
+		size_t size;
+		size_t capacity;
+	};
+
+	static DzChunkCache &instance();
+
+	/**
+	 * Get the identifier of a file. Files that are the same (same device,
+	 * inode, modification time in nanoseconds, and size) get the same
+	 * identifier, so that readers of the same file share cached chunks.
+	 * Identifiers are never reused. A file gets a new identifier once
+	 * all chunks for its old identifier have been evicted.
+	 */
+	size_t fileId(std::string const &filename);
+
+	/** Get a chunk, returns a null pointer if it is not in the cache. */
+	ChunkPtr get(size_t fileId, size_t chunk);
+
+	void insert(size_t fileId, size_t chunk, ChunkPtr data);
+
+	/** Set the capacity in bytes, a capacity of 0 disables the cache. */
+	void setCapacity(size_t capacity);
+	size_t capacity() const;
+
+	Stats stats() const;
+	void clear();
+
+private:
+	typedef std::pair<size_t, size_t> Key;
+
+	struct KeyHash
+	{
+		size_t operator()(Key const &key) const
+		{
+			return key.first * 1000003 ^ key.second;
+		}
+	};
+
+	struct CacheEntry
+	{
+		Key key;
+		ChunkPtr data;
+
+		// Time of last use, to find the least recently used chunk
+		// over all shards.
+		size_t lastUse;
+	};
+
+	typedef std::list<CacheEntry> LruList;
+	typedef std::unordered_map<Key, LruList::iterator, KeyHash> LruMap;
+	typedef std::tuple<unsigned long long, unsigned long long,
+		long long, long long, long long> FileIdentity;
+	typedef std::map<FileIdentity, size_t> FileIdMap;
+
+	struct Shard
+	{
+		std::mutex mutex;
+		LruList lru;
+		LruMap index;
+	};
+
+	static size_t const N_SHARDS = 16;
+
+	DzChunkCache();
+	DzChunkCache(DzChunkCache const &) = delete;
+	DzChunkCache &operator=(DzChunkCache const &) = delete;
+
+	Shard &shard(Key const &key);
+	void evict();
+	void removeLast(Shard *shard);
+	void release(size_t fileId);
+
+	Shard d_shards[N_SHARDS];
+
+	// Protects the file identifiers and chunk counts. Can be locked
+	// while a shard is locked, but not the other way around.
+	mutable std::mutex d_fileMutex;
+	FileIdMap d_fileIds;
+
+	// For each file identifier: the number of cached chunks and the
+	// identity of the file, so that the identity can be forgotten
+	// when the last chunk is evicted.
+	std::unordered_map<size_t, size_t> d_chunkCounts;
+	std::unordered_map<size_t, FileIdMap::iterator> d_identities;
+	size_t d_nextId;
+
+	std::atomic<size_t> d_clock;
+	std::atomic<size_t> d_capacity;
+	std::atomic<size_t> d_size;
+	std::atomic<size_t> d_hits;
+	std::atomic<size_t> d_misses;
+};
+
+}
+
+#endif // DZ_CHUNK_CACHE_HH
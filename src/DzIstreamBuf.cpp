@@ -32,6 +32,7 @@ DzIstreamBuf::DzIstreamBuf(char const *filename)
 		skipOptional();
 		d_dataOffset = ftell(d_stream);
 		d_curChunk = -1;
+		d_fileId = DzChunkCache::instance().fileId(filename);
 	}
 }
 
@@ -51,18 +52,58 @@ void DzIstreamBuf::readChunk(long n)
 	if (n == d_curChunk)
 		return;
 
+	DzChunkCache &cache = DzChunkCache::instance();
+
+	// Chunks that the cache would not hold are inflated into our own
+	// buffer, so that we do not allocate a chunk on every switch.
+	if (cache.capacity() < d_chunkLen)
+	{
+		size_t size = inflateChunk(n, &d_buffer[0]);
+		d_chunk.reset();
+		char *buffer = reinterpret_cast<char *>(&d_buffer[0]);
+		setg(buffer, buffer, buffer + size);
+
+		d_curChunk = n;
+		return;
+	}
+
+	DzChunkCache::ChunkPtr chunk = cache.get(d_fileId, n);
+	if (!chunk)
+	{
+		std::shared_ptr<DzChunkCache::Chunk> newChunk(
+			new DzChunkCache::Chunk(d_chunkLen));
+		newChunk->resize(inflateChunk(n, &(*newChunk)[0]));
+		cache.insert(d_fileId, n, newChunk);
+		chunk = newChunk;
+	}
+
+	// The get area is never written to, so we can point it to the
+	// (shared) cached chunk.
+	d_chunk = chunk;
+	char *buffer = reinterpret_cast<char *>(
+		const_cast<unsigned char *>(d_chunk->data()));
+	setg(buffer, buffer, buffer + d_chunk->size());
+	
+	d_curChunk = n;
+}
+
+size_t DzIstreamBuf::inflateChunk(long n, unsigned char *buf)
+{
 	DzChunk chunkN = d_chunks[n];
 
 	unsigned char *zBuf = new unsigned char[chunkN.size];
 	
 	fseek(d_stream, d_dataOffset + chunkN.offset, SEEK_SET);
 	if (fread(zBuf, 1, chunkN.size, d_stream) != chunkN.size)
-		throw std::runtime_error("DzIstreamBuf::readChunk: could not read chunk!");
+	{
+		delete[] zBuf;
+		throw std::runtime_error("DzIstreamBuf::inflateChunk: could not read chunk!");
+	}
 
 	z_stream zStream;
 	zStream.next_in = zBuf;
 	zStream.avail_in = chunkN.size;
-	zStream.next_out = &d_buffer[0];
+	zStream.next_out = buf;
 	zStream.avail_out = d_chunkLen;
 	zStream.zalloc = NULL;
 	zStream.zfree = NULL;
@@ -85,12 +126,7 @@ void DzIstreamBuf::readChunk(long n)
 	if (inflateEnd(&zStream) != Z_OK)
 		throw std::runtime_error(zStream.msg);
 
-	unsigned char *buffer = &d_buffer[0];
-	setg(reinterpret_cast<char *>(buffer),
-		reinterpret_cast<char *>(buffer),
-		reinterpret_cast<char *>(buffer) + zStream.total_out);
-	
-	d_curChunk = n;
+	return zStream.total_out;
 }
 
 void DzIstreamBuf::readExtra()
@@ -117,6 +153,9 @@ void DzIstreamBuf::readExtra()
 				throw("DzIstreamBuf::readExtra: unknown dictzip version!");
 			
 			d_chunkLen = fgetc(d_stream) + (fgetc(d_stream) * 256);
+			if (d_chunkLen == 0)
+				throw std::runtime_error("DzIstreamBuf::readExtra: invalid chunk length!");
+
 			size_t chunkCount = fgetc(d_stream) + (fgetc(d_stream) * 256);
 			
 			// We can set up a read buffer now...
@@ -172,15 +211,16 @@ void DzIstreamBuf::skipOptional()
 
 int DzIstreamBuf::underflow()
 {
-	if (gptr() < egptr())
-		return *gptr();
-
-	if (d_curChunk + 1>= static_cast<int>(d_chunks.size()))
-		return EOF;
+	// Skip over empty chunks, these can occur at the end of the data.
+	while (gptr() == egptr())
+	{
+		if (d_curChunk + 1>= static_cast<int>(d_chunks.size()))
+			return EOF;
 
-	readChunk(d_curChunk + 1);
+		readChunk(d_curChunk + 1);
+	}
 	
-	return *gptr();
+	return traits_type::to_int_type(*gptr());
 }
 
 DzIstreamBuf::pos_type DzIstreamBuf::seekoff(off_type off, seekdir dir, openmode)
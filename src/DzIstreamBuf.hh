@@ -6,14 +6,10 @@
 #include <streambuf>
 #include <vector>
 
+#include "DzChunkCache.hh"
+#include "gzip.hh"
+
 namespace alpinocorpus {
-    
-struct DzChunk
-{
-    DzChunk(size_t newOffset, size_t newSize) : offset(newOffset), size(newSize) {}
-    size_t offset;
-    size_t size;
-};
 
 // Warning: streambufs are really too stateful for multithreading (think
 // seeking, telling). Users of this classes should do locking, since they
@@ -34,6 +30,7 @@ protected:
 	int underflow();
 	std::streamsize xsgetn(char *dest, std::streamsize n);
 private:
+	size_t inflateChunk(long n, unsigned char *buf);
 	void readChunk(long n);
 	void readHeader();
 	void readExtra();
@@ -46,6 +43,8 @@ private:
 	long d_dataOffset;
 	long d_curChunk;
 	std::vector<DzChunk> d_chunks;
+	size_t d_fileId;
+	DzChunkCache::ChunkPtr d_chunk;
 };
 
 }
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "DzMappedReader.hh"
+#include "gzip.hh"
+
+namespace {
+
+// Per-thread inflate state, so that concurrent reads do not need to
+// synchronize.
+class Inflater
+{
+public:
+	Inflater() : d_initialized(false) {}
+
+	~Inflater()
+	{
+		if (d_initialized)
+			inflateEnd(&d_zStream);
+	}
+
+	z_stream *stream()
+	{
+		if (!d_initialized)
+		{
+			std::memset(&d_zStream, 0, sizeof(d_zStream));
+			if (inflateInit2(&d_zStream, -15) != Z_OK)
+				throw std::runtime_error("DzMappedReader: could not initialize inflate stream!");
+			d_initialized = true;
+		}
+		else if (inflateReset(&d_zStream) != Z_OK)
+			throw std::runtime_error("DzMappedReader: could not reset inflate stream!");
+
+		return &d_zStream;
+	}
+
+private:
+	bool d_initialized;
+	z_stream d_zStream;
+};
+
+thread_local Inflater t_inflater;
+
+// After the last chunk, only the end of the deflate stream (an empty
+// final block) and the trailer may follow.
+size_t const DZ_MAX_TAIL_SIZE = 16;
+
+size_t readUint16(unsigned char const *buf)
+{
+	return buf[0] + (buf[1] * 256);
+}
+
+}
+
+namespace alpinocorpus {
+
+DzMappedReader::DzMappedReader(std::string const &filename) :
+	d_file(filename), d_chunkLen(0), d_dataOffset(0),
+	d_fileId(DzChunkCache::instance().fileId(filename))
+{
+	readHeader();
+}
+
+void DzMappedReader::readHeader()
+{
+	unsigned char const *data = d_file.data();
+	size_t size = d_file.size();
+
+	if (size < GZ_HEADER_SIZE + 2)
+		throw std::runtime_error("DzMappedReader::readHeader: could not read header!");
+
+	if (data[GZ_HEADER_ID1] != gzipId1 || data[GZ_HEADER_ID2] != gzipId2)
+		throw std::runtime_error("DzMappedReader::readHeader: not a gzip file!");
+
+	if (data[GZ_HEADER_CM] != GZ_CM_DEFLATE)
+		throw std::runtime_error("DzMappedReader::readHeader: unknown compression method!");
+
+	unsigned char flags = data[GZ_HEADER_FLG];
+	if (!(flags & GZ_FLG_EXTRA))
+		throw std::runtime_error("DzMappedReader::readHeader: no extra fields, cannot be a dictzip file!");
+
+	size_t pos = GZ_HEADER_SIZE;
+	size_t extraEnd = pos + 2 + readUint16(data + pos);
+	if (extraEnd > size)
+		throw std::runtime_error("DzMappedReader::readHeader: truncated extra field!");
+
+	pos += 2;
+
+	bool haveChunks = false;
+	while (pos + 4 <= extraEnd)
+	{
+		size_t len = readUint16(data + pos + 2);
+		size_t fieldEnd = pos + 4 + len;
+		if (fieldEnd > extraEnd)
+			throw std::runtime_error("DzMappedReader::readHeader: truncated extra field!");
+
+		// Does this field part provide chunk information?
+		if (data[pos] == 'R' && data[pos + 1] == 'A' && len >= 6)
+		{
+			if (readUint16(data + pos + 4) != 1)
+				throw std::runtime_error("DzMappedReader::readHeader: unknown dictzip version!");
+
+			d_chunkLen = readUint16(data + pos + 6);
+			if (d_chunkLen == 0)
+				throw std::runtime_error("DzMappedReader::readHeader: invalid chunk length!");
+
+			size_t chunkCount = readUint16(data + pos + 8);
+			if (len < 6 + 2 * chunkCount)
+				throw std::runtime_error("DzMappedReader::readHeader: truncated chunk table!");
+
+			size_t chunkPos = 0;
+			for (size_t i = 0; i < chunkCount; ++i)
+			{
+				size_t chunkSize = readUint16(data + pos + 10 + 2 * i);
+				d_chunks.push_back(DzChunk(chunkPos, chunkSize));
+				chunkPos += chunkSize;
+			}
+
+			haveChunks = true;
+		}
+
+		pos = fieldEnd;
+	}
+
+	if (!haveChunks)
+		throw std::runtime_error("DzMappedReader::readHeader: no chunk information, cannot be a dictzip file!");
+
+	pos = extraEnd;
+
+	if (flags & GZ_FLG_NAME)
+		while (pos < size && data[pos++] != 0) {}
+
+	if (flags & GZ_FLG_COMMENT)
+		while (pos < size && data[pos++] != 0) {}
+
+	if (flags & GZ_FLG_HCRC)
+		pos += 2;
+
+	d_dataOffset = pos;
+
+	if (d_dataOffset + GZ_TRAILER_SIZE > size)
+		throw std::runtime_error("DzMappedReader::readHeader: truncated data!");
+
+	size_t dataSize = size - GZ_TRAILER_SIZE - d_dataOffset;
+	size_t chunksSize = d_chunks.empty() ? 0 :
+		d_chunks.back().offset + d_chunks.back().size;
+	if (chunksSize > dataSize)
+		throw std::runtime_error("DzMappedReader::readHeader: truncated data!");
+
+	if (dataSize - chunksSize > DZ_MAX_TAIL_SIZE)
+		throw std::runtime_error("DzMappedReader::readHeader: chunk table does not match the data!");
+}
+
+size_t DzMappedReader::inflateChunk(size_t n, unsigned char *buf) const
+{
+	if (n >= d_chunks.size())
+		throw std::runtime_error("DzMappedReader::inflateChunk: chunk out of range!");
+
+	DzChunk const &chunk = d_chunks[n];
+
+	z_stream *zStream = t_inflater.stream();
+	zStream->next_in = const_cast<unsigned char *>(d_file.data() +
+		d_dataOffset + chunk.offset);
+	zStream->avail_in = chunk.size;
+	zStream->next_out = buf;
+	zStream->avail_out = d_chunkLen;
+
+	int r = inflate(zStream, Z_PARTIAL_FLUSH);
+	if (r != Z_OK && r != Z_STREAM_END)
+		throw std::runtime_error(zStream->msg == 0 ?
+			"DzMappedReader::inflateChunk: could not inflate chunk!" : zStream->msg);
+
+	return d_chunkLen - zStream->avail_out;
+}
+
+DzChunkCache::ChunkPtr DzMappedReader::chunk(size_t n) const
+{
+	DzChunkCache &cache = DzChunkCache::instance();
+
+	DzChunkCache::ChunkPtr cached = cache.get(d_fileId, n);
+	if (cached)
+		return cached;
+
+	std::shared_ptr<DzChunkCache::Chunk> newChunk(
+		new DzChunkCache::Chunk(d_chunkLen));
+	newChunk->resize(inflateChunk(n, &(*newChunk)[0]));
+	cache.insert(d_fileId, n, newChunk);
+
+	return newChunk;
+}
+
+std::string DzMappedReader::read(size_t offset, size_t size) const
+{
+	std::string data(size, '\0');
+	if (size == 0)
+		return data;
+
+	DzChunkCache::ChunkPtr current;
+	size_t currentN = 0;
+	copyData(offset, size, &data[0], &current, &currentN);
+
+	return data;
+}
+
+std::vector<std::string> DzMappedReader::readMany(
+	std::vector<std::pair<size_t, size_t> > const &extents) const
+{
+	// Read in the order of the data, so that every chunk is only
+	// retrieved once, even if the chunk cache is disabled.
+	std::vector<size_t> order(extents.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+		[&extents](size_t a, size_t b) {
+			return extents[a].first < extents[b].first;
+		});
+
+	std::vector<std::string> data(extents.size());
+
+	DzChunkCache::ChunkPtr current;
+	size_t currentN = 0;
+	for (std::vector<size_t>::const_iterator iter = order.begin();
+		iter != order.end(); ++iter)
+	{
+		std::pair<size_t, size_t> const &extent = extents[*iter];
+		if (extent.second == 0)
+			continue;
+
+		data[*iter].resize(extent.second);
+		copyData(extent.first, extent.second, &data[*iter][0], &current,
+			&currentN);
+	}
+
+	return data;
+}
+
+void DzMappedReader::copyData(size_t offset, size_t size, char *dest,
+	DzChunkCache::ChunkPtr *current, size_t *currentN) const
+{
+	size_t chunkN = offset / d_chunkLen;
+	size_t chunkPos = offset % d_chunkLen;
+	size_t nRead = 0;
+
+	while (nRead != size)
+	{
+		if (!*current || *currentN != chunkN)
+		{
+			*current = chunk(chunkN);
+			*currentN = chunkN;
+		}
+
+		DzChunkCache::Chunk const &chunkData = **current;
+		if (chunkPos >= chunkData.size())
+			throw std::runtime_error("DzMappedReader::read: read beyond end of data!");
+
+		size_t avail = std::min(chunkData.size() - chunkPos, size - nRead);
+		std::memcpy(dest + nRead, &chunkData[chunkPos], avail);
+
+		nRead += avail;
+		++chunkN;
+		chunkPos = 0;
+	}
+}
+
+DataView DzMappedReader::readView(size_t offset, size_t size) const
+{
+	size_t chunkN = offset / d_chunkLen;
+	size_t chunkPos = offset % d_chunkLen;
+
+	if (size == 0 || chunkPos + size > d_chunkLen)
+		return DataView(read(offset, size));
+
+	DzChunkCache::ChunkPtr chunkData = chunk(chunkN);
+	if (chunkPos + size > chunkData->size())
+		throw std::runtime_error("DzMappedReader::read: read beyond end of data!");
+
+	return DataView(chunkData,
+		reinterpret_cast<char const *>(&(*chunkData)[chunkPos]), size);
+}
+
+DzMappedScanner::DzMappedScanner(std::shared_ptr<DzMappedReader const> reader) :
+	d_reader(reader), d_finished(false), d_buffer(reader->chunkLen()),
+	d_bufferStart(0), d_bufferPos(0), d_bufferSize(0)
+{
+	std::memset(&d_zStream, 0, sizeof(d_zStream));
+	if (inflateInit2(&d_zStream, -15) != Z_OK)
+		throw std::runtime_error("DzMappedScanner: could not initialize inflate stream!");
+
+	d_inputPos = d_reader->d_dataOffset;
+	d_inputEnd = d_reader->d_chunks.empty() ? d_inputPos :
+		d_inputPos + d_reader->d_chunks.back().offset +
+		d_reader->d_chunks.back().size;
+}
+
+DzMappedScanner::~DzMappedScanner()
+{
+	inflateEnd(&d_zStream);
+}
+
+void DzMappedScanner::inflateMore()
+{
+	d_bufferStart += d_bufferSize;
+	d_bufferPos = 0;
+	d_bufferSize = 0;
+
+	d_zStream.next_out = &d_buffer[0];
+	d_zStream.avail_out = d_buffer.size();
+
+	while (d_zStream.avail_out == d_buffer.size() && !d_finished)
+	{
+		// avail_in is 32 bits wide, so large files are fed in parts.
+		if (d_zStream.avail_in == 0)
+		{
+			if (d_inputPos == d_inputEnd)
+				break;
+
+			size_t avail = std::min<size_t>(d_inputEnd - d_inputPos,
+				std::numeric_limits<uInt>::max());
+			d_zStream.next_in = const_cast<unsigned char *>(
+				d_reader->d_file.data() + d_inputPos);
+			d_zStream.avail_in = avail;
+			d_inputPos += avail;
+		}
+
+		int r = inflate(&d_zStream, Z_NO_FLUSH);
+		if (r == Z_STREAM_END)
+			d_finished = true;
+		else if (r != Z_OK && r != Z_BUF_ERROR)
+			throw std::runtime_error(d_zStream.msg == 0 ?
+				"DzMappedScanner::read: could not inflate data!" : d_zStream.msg);
+	}
+
+	d_bufferSize = d_buffer.size() - d_zStream.avail_out;
+	if (d_bufferSize == 0)
+		throw std::runtime_error("DzMappedScanner::read: read beyond end of data!");
+}
+
+std::string DzMappedScanner::read(size_t offset, size_t size)
+{
+	if (size == 0)
+		return std::string();
+
+	if (offset < d_bufferStart + d_bufferPos)
+		return d_reader->read(offset, size);
+
+	// Skip to the requested data.
+	while (d_bufferStart + d_bufferSize <= offset)
+		inflateMore();
+	d_bufferPos = offset - d_bufferStart;
+
+	std::string data(size, '\0');
+	size_t nRead = 0;
+	while (nRead != size)
+	{
+		if (d_bufferPos == d_bufferSize)
+			inflateMore();
+
+		size_t avail = std::min(d_bufferSize - d_bufferPos, size - nRead);
+		std::memcpy(&data[nRead], &d_buffer[d_bufferPos], avail);
+
+		nRead += avail;
+		d_bufferPos += avail;
+	}
+
+	return data;
+}
+
+}
@@ -0,0 +1,143 @@
+#ifndef DZ_MAPPED_READER_HH
+#define DZ_MAPPED_READER_HH
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include <AlpinoCorpus/DataView.hh>
+
+#include "DzChunkCache.hh"
+#include "DzIstreamBuf.hh"
+#include "util/MappedFile.hh"
+
+namespace alpinocorpus {
+
+/**
+ * Random access to a dictzip file through a memory map.
+ *
+ * Unlike DzIstream, this reader does not have a file position or other
+ * shared mutable state. Chunks are inflated with an inflate stream that is
+ * local to the calling thread and stored in the (thread-safe) chunk cache,
+ * so the reader can be used from multiple threads without locking.
+ */
+class DzMappedReader
+{
+public:
+	DzMappedReader(std::string const &filename);
+
+	/**
+	 * Read <i>size</i> bytes of uncompressed data, starting at
+	 * <i>offset</i>.
+	 */
+	std::string read(size_t offset, size_t size) const;
+
+	/**
+	 * Read <i>size</i> bytes of uncompressed data, starting at
+	 * <i>offset</i>. If the data is within a single chunk, the view
+	 * refers to the decompressed chunk and no data is copied.
+	 */
+	DataView readView(size_t offset, size_t size) const;
+
+	/**
+	 * Read multiple (offset, size) extents of uncompressed data. The data
+	 * is returned in the order of <i>extents</i>.
+	 */
+	std::vector<std::string> readMany(
+		std::vector<std::pair<size_t, size_t> > const &extents) const;
+
+	/** Uncompressed size of a chunk (except for the last chunk). */
+	size_t chunkLen() const;
+
+	size_t nChunks() const;
+
+	/**
+	 * Inflate chunk <i>n</i> into <i>buf</i>, which should have room
+	 * for chunkLen() bytes. Returns the uncompressed size of the chunk.
+	 */
+	size_t inflateChunk(size_t n, unsigned char *buf) const;
+
+private:
+	friend class DzMappedScanner;
+
+	DzMappedReader(DzMappedReader const &) = delete;
+	DzMappedReader &operator=(DzMappedReader const &) = delete;
+
+	/** Get chunk <i>n</i> from the chunk cache, or inflate it. */
+	DzChunkCache::ChunkPtr chunk(size_t n) const;
+
+	/**
+	 * Copy data to <i>dest</i>. <i>current</i> is the most recently
+	 * used chunk and <i>currentN</i> its number, they are updated.
+	 */
+	void copyData(size_t offset, size_t size, char *dest,
+		DzChunkCache::ChunkPtr *current, size_t *currentN) const;
+	void readHeader();
+
+	util::MappedFile d_file;
+	size_t d_chunkLen;
+	size_t d_dataOffset;
+	std::vector<DzChunk> d_chunks;
+	size_t d_fileId;
+};
+
+/**
+ * Sequential reader for a dictzip file. The data is inflated front to back
+ * with a single inflate stream, without going through the chunk cache.
+ * This is faster than random access when (nearly) all data is read in
+ * order, e.g. when scanning a complete corpus.
+ *
+ * A scanner has a position, so it should only be used by one thread.
+ */
+class DzMappedScanner
+{
+public:
+	DzMappedScanner(std::shared_ptr<DzMappedReader const> reader);
+	~DzMappedScanner();
+
+	/**
+	 * Read <i>size</i> bytes of uncompressed data, starting at
+	 * <i>offset</i>. Data between the end of the previous read and
+	 * <i>offset</i> is skipped. Data before the end of the previous read
+	 * is read through the random access reader.
+	 */
+	std::string read(size_t offset, size_t size);
+
+private:
+	DzMappedScanner(DzMappedScanner const &) = delete;
+	DzMappedScanner &operator=(DzMappedScanner const &) = delete;
+
+	/** Inflate the next part of the data into the buffer. */
+	void inflateMore();
+
+	std::shared_ptr<DzMappedReader const> d_reader;
+	z_stream d_zStream;
+	size_t d_inputPos;
+	size_t d_inputEnd;
+	bool d_finished;
+
+	// d_buffer[d_bufferPos..d_bufferSize) is the inflated data that has
+	// not been read yet, d_bufferStart is the offset of d_buffer[0].
+	std::vector<unsigned char> d_buffer;
+	size_t d_bufferStart;
+	size_t d_bufferPos;
+	size_t d_bufferSize;
+};
+
+inline size_t DzMappedReader::chunkLen() const
+{
+	return d_chunkLen;
+}
+
+inline size_t DzMappedReader::nChunks() const
+{
+	return d_chunks.size();
+}
+
+}
+
+#endif // DZ_MAPPED_READER_HH
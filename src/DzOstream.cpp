@@ -6,9 +6,10 @@ using namespace std;
 
 namespace alpinocorpus {
 
-DzOstream::DzOstream(char const *filename) : std::ostream(0)
+DzOstream::DzOstream(char const *filename, int level, size_t nThreads,
+	bool singlePass) : std::ostream(0)
 {
-	d_streamBuf.reset(new DzOstreamBuf(filename));
+	d_streamBuf.reset(new DzOstreamBuf(filename, level, nThreads, singlePass));
 	rdbuf(d_streamBuf.get());
 }
 
@@ -12,7 +12,8 @@ namespace alpinocorpus {
 class DzOstream : public std::ostream
 {
 public:
-	DzOstream(char const *filename); // Let's stick to the standards... :/
+	DzOstream(char const *filename, int level = Z_BEST_COMPRESSION,
+		size_t nThreads = 1, bool singlePass = false); // Let's stick to the standards... :/
 	virtual ~DzOstream() {}
 private:
 	std::shared_ptr<DzOstreamBuf> d_streamBuf;
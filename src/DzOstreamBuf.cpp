@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -15,6 +16,7 @@
 
 #include "DzOstreamBuf.hh"
 #include "gzip.hh"
+#include "util/ThreadPool.hh"
 #include "util/bufutil.hh"
 
 
@@ -29,12 +31,66 @@ size_t const DZ_MAX_UNCOMPRESSED_SIZE = static_cast<size_t>(DZ_MAX_COMPRESSED_SI
 // a fixed buffer size, prefer it by default.
 size_t const DZ_PREF_UNCOMPRESSED_SIZE = static_cast<size_t>((DZ_MAX_COMPRESSED_SIZE - 12) * 0.89);
 
+// The extra field length and chunk count are 16-bit. The chunk table
+// (RA subfield) takes 10 bytes, plus two bytes per chunk.
+size_t const DZ_MAX_XLEN = 0xfffe;
+size_t const DZ_MAX_CHUNKS = (DZ_MAX_XLEN - 10) / 2;
+
+// Size of a subfield header.
+size_t const DZ_SUBFIELD_HEADER_SIZE = 4;
+
+// Compress a chunk. Every chunk is compressed with a fresh deflate stream,
+// so that chunks can be compressed independently. Since chunks end with a
+// full flush, the concatenation of compressed chunks is equal to a single
+// deflate stream where every chunk is flushed.
+std::vector<unsigned char> compressChunk(unsigned char const *data,
+	size_t size, int level, int flush)
+{
+	z_stream zStream;
+	zStream.zalloc = Z_NULL;
+	zStream.zfree = Z_NULL;
+	zStream.opaque = Z_NULL;
+
+	if (deflateInit2(&zStream, level, Z_DEFLATED, -15, MAX_MEM_LEVEL,
+			Z_DEFAULT_STRATEGY) != Z_OK)
+		throw std::runtime_error("DzOstreamBuf: could not initialize deflate stream!");
+
+	// Room for the (worst-case) deflated data, plus the flush marker.
+	std::vector<unsigned char> zBuf(deflateBound(&zStream, size) + 16);
+
+	zStream.next_in = const_cast<unsigned char *>(data);
+	zStream.avail_in = size;
+	zStream.next_out = &zBuf[0];
+	zStream.avail_out = zBuf.size();
+
+	int r = deflate(&zStream, flush);
+	if ((r != Z_OK && r != Z_STREAM_END) || zStream.avail_in != 0 ||
+			zStream.avail_out == 0)
+	{
+		deflateEnd(&zStream);
+		throw std::runtime_error("DzOstreamBuf: could not compress chunk!");
+	}
+
+	zBuf.resize(zBuf.size() - zStream.avail_out);
+
+	deflateEnd(&zStream);
+
+	return zBuf;
+}
+
 }
 
 namespace alpinocorpus {
 
-DzOstreamBuf::DzOstreamBuf(char const *filename) : d_size(0), d_crc32(crc32(0L, Z_NULL, 0))
+DzOstreamBuf::DzOstreamBuf(char const *filename, int level, size_t nThreads,
+		bool singlePass) :
+	d_level(level), d_singlePass(singlePass), d_size(0),
+	d_crc32(crc32(0L, Z_NULL, 0))
 {
+	if (level != Z_DEFAULT_COMPRESSION &&
+			(level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION))
+		throw std::runtime_error("DzOstreamBuf::DzOstreamBuf: invalid compression level!");
+
 	d_dzStream = fopen(filename, "w");
 	
 	if (d_dzStream == NULL) {
@@ -44,6 +100,18 @@ DzOstreamBuf::DzOstreamBuf(char const *filename) : d_size(0), d_crc32(crc32(0L,
 		return;
 	}
 
+	if (d_singlePass)
+	{
+		// Write the header with room for the largest possible chunk table,
+		// the table is filled in when all data is written.
+		d_zDataStream = d_dzStream;
+		writeHeader();
+		std::vector<unsigned char> extra(DZ_MAX_XLEN + 2);
+		if (fwrite(&extra[0], 1, extra.size(), d_dzStream) != extra.size())
+			throw std::runtime_error("DzOstreamBuf::DzOstreamBuf: could not write header!");
+	}
+	else
+	{
   // XXX - There is a race condition here, but Boost does not seem to
   // provide a variant that returns a file descriptor. We used mkstemp
   // previously, but it is not portable.
@@ -55,17 +123,10 @@ DzOstreamBuf::DzOstreamBuf(char const *filename) : d_size(0), d_crc32(crc32(0L,
 	if (d_zDataStream == NULL)
 		throw std::runtime_error(std::string("DzOstreamBuf::DzOstreamBuf: Could not open ") +
 			d_tmpFilename + " for writing!");
+	}
 
-	d_zStream.next_in = Z_NULL;
-	d_zStream.avail_in = 0;
-	d_zStream.next_out = Z_NULL;
-	d_zStream.avail_out = 0;
-	d_zStream.zalloc = Z_NULL;
-	d_zStream.zfree = Z_NULL;
-	
-	if (deflateInit2(&d_zStream, Z_BEST_COMPRESSION, Z_DEFLATED, -15,
-			Z_BEST_COMPRESSION, Z_DEFAULT_STRATEGY) != Z_OK)
-		throw std::runtime_error(d_zStream.msg);
+	if (nThreads != 1)
+		d_pool.reset(new util::ThreadPool(nThreads));
 
 	d_buffer.resize(DZ_PREF_UNCOMPRESSED_SIZE);
 	
@@ -80,29 +141,36 @@ DzOstreamBuf::~DzOstreamBuf()
 	if (d_zDataStream == NULL || d_dzStream == NULL)
 		return;
 
-	// Flush leftovers.
+	// Flush leftovers and finish the deflate stream.
 	try {
 		flushBuffer();
+
+		while (!d_pending.empty())
+			writePending();
+
+		// A padding subfield needs at least a subfield header. If there
+		// is not enough room for it, add an empty chunk to the table.
+		if (d_singlePass && d_chunks.size() < DZ_MAX_CHUNKS &&
+				DZ_MAX_XLEN - 10 - 2 * d_chunks.size() < DZ_SUBFIELD_HEADER_SIZE)
+			writeChunk(compressChunk(0, 0, d_level, Z_FULL_FLUSH));
+
+		ZChunk zBuf = compressChunk(0, 0, d_level, Z_FINISH);
+		fwrite(&zBuf[0], 1, zBuf.size(), d_zDataStream);
 	} catch (std::exception &e) {
 
 		std::cerr << e.what() << std::endl;
 	}
 
-	std::vector<unsigned char> zBuf(DZ_PREF_UNCOMPRESSED_SIZE);
-	d_zStream.next_in = &d_buffer[0];
-	d_zStream.avail_in = 0;
-	d_zStream.next_out = &zBuf[0];
-	d_zStream.avail_out = DZ_PREF_UNCOMPRESSED_SIZE;
-	if (deflate(&d_zStream, Z_FINISH) != Z_STREAM_END)
-		std::cerr << d_zStream.msg << std::endl;
-	size_t zSize = DZ_PREF_UNCOMPRESSED_SIZE - d_zStream.avail_out;
-	fwrite(&zBuf[0], 1, zSize, d_zDataStream);
-	
-	switch (deflateEnd(&d_zStream)) {
-	case Z_STREAM_ERROR:
-		std::cerr << "DzOstreamBuf::flushBuffer: stream state inconsistent!" << std::endl;
-	case Z_DATA_ERROR:
-		std::cerr << "DzOstreamBuf::flushBuffer: stream freed prematurely!" << std::endl;
+	if (d_singlePass)
+	{
+		writeTrailer();
+
+		fseek(d_dzStream, GZ_HEADER_SIZE, SEEK_SET);
+		writeChunkInfo();
+
+		fclose(d_dzStream);
+
+		return;
 	}
 
 	fclose(d_zDataStream);
@@ -120,28 +188,52 @@ DzOstreamBuf::~DzOstreamBuf()
 void DzOstreamBuf::flushBuffer()
 {
 	size_t size = pptr() - pbase();
-	
-	std::vector<unsigned char> zBuf(DZ_PREF_UNCOMPRESSED_SIZE);
-	
-	d_zStream.next_in = reinterpret_cast<unsigned char *>(pbase());
-	d_zStream.avail_in = size;
-	d_zStream.next_out = &zBuf[0];
-	d_zStream.avail_out = DZ_PREF_UNCOMPRESSED_SIZE;
-	
-	if (deflate(&d_zStream, Z_FULL_FLUSH) != Z_OK)
-		throw std::runtime_error(d_zStream.msg);		
-	
-	size_t zSize = DZ_PREF_UNCOMPRESSED_SIZE - d_zStream.avail_out;
-	
-	fwrite(&zBuf[0], 1, zSize, d_zDataStream);
+	unsigned char *data = reinterpret_cast<unsigned char *>(pbase());
 
 	d_size += size;
-	d_crc32 = crc32(d_crc32, reinterpret_cast<unsigned char *>(pbase()), size);
-	d_chunks.push_back(DzChunk(0, zSize));
+	d_crc32 = crc32(d_crc32, data, size);
+
+	if (d_pool)
+	{
+		// Compress a copy of the buffer on the thread pool. Limit the
+		// number of pending chunks, so that memory use stays bounded.
+		std::shared_ptr<ZChunk const> chunk(new ZChunk(data, data + size));
+		int level = d_level;
+		d_pending.push_back(d_pool->submit([chunk, level]() {
+			return compressChunk(chunk->data(), chunk->size(), level, Z_FULL_FLUSH);
+		}));
+
+		while (d_pending.size() > 2 * d_pool->size())
+			writePending();
+	}
+	else
+		writeChunk(compressChunk(data, size, d_level, Z_FULL_FLUSH));
 
 	pbump(-size);
 }
 
+void DzOstreamBuf::writeChunk(ZChunk const &zChunk)
+{
+	if (zChunk.size() > DZ_MAX_COMPRESSED_SIZE)
+		throw std::runtime_error("DzOstreamBuf::writeChunk: compressed chunk is too large!");
+
+	if (d_chunks.size() == DZ_MAX_CHUNKS)
+		throw std::runtime_error("DzOstreamBuf::writeChunk: too many chunks for a dictzip file!");
+
+	if (fwrite(&zChunk[0], 1, zChunk.size(), d_zDataStream) != zChunk.size())
+		throw std::runtime_error("DzOstreamBuf::writeChunk: could not write chunk!");
+
+	d_chunks.push_back(DzChunk(0, zChunk.size()));
+}
+
+void DzOstreamBuf::writePending()
+{
+	// Chunks are written in the order in which they were submitted.
+	std::future<ZChunk> zChunk(std::move(d_pending.front()));
+	d_pending.pop_front();
+	writeChunk(zChunk.get());
+}
+
 int DzOstreamBuf::overflow(int c)
 {
 	flushBuffer();
@@ -158,6 +250,9 @@ int DzOstreamBuf::overflow(int c)
 void DzOstreamBuf::writeChunkInfo()
 {
 	size_t xlen = 10 + (2 * d_chunks.size());
+	if (d_singlePass)
+		xlen = DZ_MAX_XLEN;
+
 	fputc(xlen % 256, d_dzStream);
 	fputc(xlen / 256, d_dzStream);
 	
@@ -188,6 +283,21 @@ void DzOstreamBuf::writeChunkInfo()
 		fputc(iter->size % 256, d_dzStream);
 		fputc(iter->size / 256, d_dzStream);
 	}
+
+	// Fill up the reserved space with a padding subfield.
+	size_t padLen = xlen - DZ_SUBFIELD_HEADER_SIZE - len;
+	if (padLen >= DZ_SUBFIELD_HEADER_SIZE)
+	{
+		padLen -= DZ_SUBFIELD_HEADER_SIZE;
+
+		fputc('P', d_dzStream);
+		fputc('D', d_dzStream);
+		fputc(padLen % 256, d_dzStream);
+		fputc(padLen / 256, d_dzStream);
+
+		std::vector<unsigned char> padding(padLen);
+		fwrite(padding.data(), 1, padLen, d_dzStream);
+	}
 }
 
 void DzOstreamBuf::writeHeader()
@@ -210,7 +320,12 @@ void DzOstreamBuf::writeHeader()
 	header[GZ_HEADER_CM] = GZ_CM_DEFLATE;
 	header[GZ_HEADER_FLG] = GZ_FLG_EXTRA;
 	util::writeToBuf<boost::uint32_t>(&header[0] + GZ_HEADER_MTIME, secsSinceEpoch);
-	header[GZ_HEADER_XFL] = GZ_XFL_MAX;
+	if (d_level == Z_BEST_COMPRESSION)
+		header[GZ_HEADER_XFL] = GZ_XFL_MAX;
+	else if (d_level == Z_BEST_SPEED)
+		header[GZ_HEADER_XFL] = GZ_XFL_FAST;
+	else
+		header[GZ_HEADER_XFL] = 0;
 	header[GZ_HEADER_OS] = GZ_OS_UNIX;
 	
 	fwrite(&header[0], 1, GZ_HEADER_SIZE, d_dzStream);
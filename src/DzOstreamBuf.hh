@@ -2,6 +2,8 @@
 #define DZ_OSTREAMBUF_HH
 
 #include <cstdio>
+#include <deque>
+#include <future>
 #include <memory>
 #include <streambuf>
 #include <string>
@@ -10,20 +12,26 @@
 #include <zlib.h>
 
 #include "gzip.hh"
+#include "util/ThreadPool.hh"
 
 namespace alpinocorpus {
-struct DzChunk
-{
-    DzChunk(size_t newOffset, size_t newSize) : offset(newOffset), size(newSize) {}
-    size_t offset;
-    size_t size;
-};
 
 // Warning: streambufs are really too stateful for multithreading (see
 // work done during destruction). Users of this classes should do locking.
 class DzOstreamBuf : public std::streambuf {
 public:
-	DzOstreamBuf(char const *filename);
+	/**
+	 * Construct a dictzip writer. Chunks are compressed with the given
+	 * zlib compression <i>level</i>. If <i>nThreads</i> is larger than
+	 * one, chunks are compressed in parallel (0: use all cores).
+	 *
+	 * In single-pass mode, space for the chunk table is reserved in the
+	 * header and compressed data is written directly to the output file.
+	 * Otherwise, compressed data is written to a temporary file first,
+	 * and copied to the output file after the header.
+	 */
+	DzOstreamBuf(char const *filename, int level = Z_BEST_COMPRESSION,
+		size_t nThreads = 1, bool singlePass = false);
 	virtual ~DzOstreamBuf();
 protected:
 	virtual int overflow(int c);
@@ -31,7 +39,11 @@ protected:
 private:
 	DzOstreamBuf(DzOstreamBuf const &other);
 	DzOstreamBuf &operator=(DzOstreamBuf const &other);
+	typedef std::vector<unsigned char> ZChunk;
+
 	void flushBuffer();
+	void writeChunk(ZChunk const &zChunk);
+	void writePending();
 	void writeChunkInfo();
 	void writeHeader();
 	void writeTrailer();
@@ -40,11 +52,14 @@ private:
 	std::string d_tmpFilename;
 	FILE *d_dzStream;
 	FILE *d_zDataStream;
-	z_stream d_zStream;
+	int d_level;
+	bool d_singlePass;
 	std::vector<unsigned char> d_buffer;
 	size_t d_size;
 	uLong d_crc32;
 	std::vector<DzChunk> d_chunks;
+	std::unique_ptr<util::ThreadPool> d_pool;
+	std::deque<std::future<ZChunk> > d_pending;
 };
 
 }
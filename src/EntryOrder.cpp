@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "EntryOrder.hh"
+#include "util/LittleEndian.hh"
+
+// Entry order layout, all integers are little-endian:
+//
+// header (32 bytes):
+//   magic          8 bytes, "ACORDER\0"
+//   version        uint32
+//   reserved       uint32
+//   entry count    uint64
+//   names size     uint64
+// entries (entry count * 4 bytes):
+//   uint32 entry numbers, in sorted order
+// names (names size bytes):
+//   optional, the entry names in sorted order, NUL-terminated
+
+namespace bf = boost::filesystem;
+
+using alpinocorpus::util::readUint;
+using alpinocorpus::util::writeUint;
+
+namespace {
+    char const ENTRY_ORDER_MAGIC[8] = {'A', 'C', 'O', 'R', 'D', 'E', 'R', '\0'};
+    uint32_t const ENTRY_ORDER_VERSION = 1;
+
+    size_t const HEADER_SIZE = 32;
+
+    void writeEntryOrderFile(std::string const &filename,
+        std::vector<uint32_t> const &entries,
+        std::vector<std::string> const &names)
+    {
+        size_t namesSize = 0;
+        for (std::vector<std::string>::const_iterator iter = names.begin();
+                iter != names.end(); ++iter)
+            namesSize += iter->size() + 1;
+
+        std::ofstream out(filename.c_str(), std::ios::binary);
+        if (!out)
+            throw std::runtime_error("writeEntryOrder: could not open " + filename);
+
+        out.write(ENTRY_ORDER_MAGIC, sizeof(ENTRY_ORDER_MAGIC));
+        writeUint(out, ENTRY_ORDER_VERSION, 4);
+        writeUint(out, 0, 4);
+        writeUint(out, entries.size(), 8);
+        writeUint(out, namesSize, 8);
+
+        for (std::vector<uint32_t>::const_iterator iter = entries.begin();
+                iter != entries.end(); ++iter)
+            writeUint(out, *iter, 4);
+
+        for (std::vector<std::string>::const_iterator iter = names.begin();
+                iter != names.end(); ++iter)
+            out.write(iter->c_str(), iter->size() + 1);
+
+        out.close();
+        if (!out)
+            throw std::runtime_error("writeEntryOrder: could not write " + filename);
+    }
+}
+
+namespace alpinocorpus {
+
+EntryOrder::EntryOrder(std::string const &filename) :
+    d_file(filename)
+{
+    unsigned char const *data = d_file.data();
+
+    if (d_file.size() < HEADER_SIZE ||
+            std::memcmp(data, ENTRY_ORDER_MAGIC, sizeof(ENTRY_ORDER_MAGIC)) != 0)
+        throw std::runtime_error("EntryOrder: not an entry order: " + filename);
+
+    if (readUint(data + 8, 4) != ENTRY_ORDER_VERSION)
+        throw std::runtime_error("EntryOrder: unsupported order version: " + filename);
+
+    d_size = readUint(data + 16, 8);
+    d_namesSize = readUint(data + 24, 8);
+
+    // Check the section sizes one at a time, so that corrupt sizes
+    // cannot overflow.
+    size_t dataSize = d_file.size() - HEADER_SIZE;
+    if (d_size > dataSize / 4 || d_namesSize != dataSize - d_size * 4)
+        throw std::runtime_error("EntryOrder: corrupt order: " + filename);
+
+    d_entries = data + HEADER_SIZE;
+    d_names = d_entries + d_size * 4;
+
+    // Entries are used as positions, make sure that they are valid.
+    for (size_t i = 0; i < d_size; ++i)
+        if (readUint(d_entries + i * 4, 4) >= d_size)
+            throw std::runtime_error("EntryOrder: corrupt order: " + filename);
+
+    if (d_namesSize != 0 && d_names[d_namesSize - 1] != '\0')
+        throw std::runtime_error("EntryOrder: corrupt order: " + filename);
+}
+
+std::vector<uint32_t> EntryOrder::entries() const
+{
+    std::vector<uint32_t> entries(d_size);
+    for (size_t i = 0; i < d_size; ++i)
+        entries[i] = readUint(d_entries + i * 4, 4);
+
+    return entries;
+}
+
+std::vector<std::string> EntryOrder::names() const
+{
+    std::vector<std::string> names;
+    if (d_namesSize == 0)
+        return names;
+
+    names.reserve(d_size);
+
+    char const *namesPtr = reinterpret_cast<char const *>(d_names);
+    char const *namesEnd = namesPtr + d_namesSize;
+    while (namesPtr != namesEnd)
+    {
+        char const *end = std::find(namesPtr, namesEnd, '\0');
+        names.push_back(std::string(namesPtr, end));
+        namesPtr = end + 1;
+    }
+
+    return names;
+}
+
+void writeEntryOrder(std::string const &filename,
+    std::vector<uint32_t> const &entries,
+    std::vector<std::string> const &names)
+{
+    boost::system::error_code err;
+    bf::path tmpP = bf::unique_path(filename + ".%%%%-%%%%-%%%%", err);
+    if (err)
+        throw std::runtime_error("writeEntryOrder: could not create a temporary file name");
+
+    try {
+        writeEntryOrderFile(tmpP.string(), entries, names);
+    } catch (...) {
+        std::remove(tmpP.string().c_str());
+        throw;
+    }
+
+    bf::rename(tmpP, filename, err);
+    if (err)
+    {
+        std::remove(tmpP.string().c_str());
+        throw std::runtime_error("writeEntryOrder: could not write " + filename);
+    }
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef ALPINOCORPUS_ENTRYORDER_HH
+#define ALPINOCORPUS_ENTRYORDER_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "util/MappedFile.hh"
+
+namespace alpinocorpus {
+
+/**
+ * A stored sort order of the entries of a corpus, so that sorted
+ * iteration does not have to sort all entry names first. Entries are
+ * identified by their position in the natural order of the corpus.
+ * Optionally, the names of the entries are stored in sorted order as
+ * well, for corpora that cannot get the name of an entry by its
+ * position.
+ *
+ * The order is memory-mapped.
+ */
+class EntryOrder
+{
+public:
+    /**
+     * Open a stored order, throws std::runtime_error if the file cannot
+     * be mapped or is not a valid order.
+     */
+    EntryOrder(std::string const &filename);
+
+    /** The number of entries. */
+    size_t size() const;
+
+    /** The entries, in sorted order. */
+    std::vector<uint32_t> entries() const;
+
+    /** The names of the entries in sorted order, empty if not stored. */
+    std::vector<std::string> names() const;
+
+private:
+    util::MappedFile d_file;
+    size_t d_size;
+    size_t d_namesSize;
+    unsigned char const *d_entries;
+    unsigned char const *d_names;
+};
+
+inline size_t EntryOrder::size() const
+{
+    return d_size;
+}
+
+/**
+ * Write a sort order, <i>names</i> is either empty or has the names of
+ * the entries in sorted order. The order is written to a temporary file
+ * that replaces <i>filename</i> when it is complete, so that concurrent
+ * readers never see a partial order. Throws std::runtime_error if the
+ * order could not be written.
+ */
+void writeEntryOrder(std::string const &filename,
+    std::vector<uint32_t> const &entries,
+    std::vector<std::string> const &names = std::vector<std::string>());
+
+}
+
+#endif // ALPINOCORPUS_ENTRYORDER_HH
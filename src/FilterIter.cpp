@@ -1,5 +1,6 @@
 #include <string>
 #include <typeinfo>
+#include <utility>
 
 #include <memory>
 
@@ -8,6 +9,7 @@
 #include <AlpinoCorpus/Error.hh>
 
 #include "FilterIter.hh"
+#include "QueryCache.hh"
 
 #include <xercesc/dom/DOM.hpp>
 #include <xercesc/framework/MemBufInputSource.hpp>
@@ -28,7 +30,19 @@ namespace alpinocorpus {
     :
         d_corpus(corpus),
         d_itr(itr),
+        d_streamingQuery(StreamingQuery::compile(query)),
+        d_query(d_streamingQuery ? std::shared_ptr<XQQuery>() : compile(query)),
   	    d_interrupted(false)
+    {
+    }
+
+    std::shared_ptr<XQQuery> FilterIter::compile(std::string const &query)
+    {
+        return QueryCache::instance().get(CorpusReader::XPATH, query,
+            &FilterIter::compileUncached);
+    }
+
+    std::shared_ptr<XQQuery> FilterIter::compileUncached(std::string const &query)
     {
         // Create an emptry document and associate namespace resolvers with it.
         AutoDelete<xercesc::DOMDocument> document(
@@ -45,7 +59,7 @@ namespace alpinocorpus {
         ctx->setNSResolver(resolver);
 
         try {
-            d_query.reset(s_xqilla.parse(X(query.c_str()), ctx));
+            return std::shared_ptr<XQQuery>(s_xqilla.parse(X(query.c_str()), ctx));
         } catch (XQException &e) {
             throw Error("CorpusReader::FilterIter::FilterIter: could not evaluate XPath expression.");
         }
@@ -75,7 +89,12 @@ namespace alpinocorpus {
               throw IterationInterrupted();
 
             d_file = e.name;
-            parseFile(d_file);
+
+            // Use the contents if the iterator read them already.
+            if (d_itr.hasContents())
+                parseFile(DataView(std::move(e.contents)));
+            else
+                parseFile(d_corpus.readView(d_file));
         }
 
         return !d_buffer.empty();
@@ -104,13 +123,28 @@ namespace alpinocorpus {
         return e;
     }
     
-    void FilterIter::parseFile(std::string const &file)
+    void FilterIter::parseFile(DataView const &xml)
+    {
+        if (d_streamingQuery)
+            d_streamingQuery->evaluate(xml.data(), xml.size(), &d_buffer);
+        else
+            evaluate(*d_query, xml, &d_buffer);
+    }
+
+    void FilterIter::evaluate(XQQuery const &query, std::string const &xml,
+        std::queue<std::string> *matches)
     {
-        std::string xml(d_corpus.read(file));
+        // The string outlives the view, so the view does not need to own it.
+        evaluate(query, DataView(std::shared_ptr<void const>(), xml.data(),
+            xml.size()), matches);
+    }
 
-        std::shared_ptr<DynamicContext> ctx(d_query->createDynamicContext());
+    void FilterIter::evaluate(XQQuery const &query, DataView const &xml,
+        std::queue<std::string> *matches)
+    {
+        std::shared_ptr<DynamicContext> ctx(query.createDynamicContext());
         XERCES_CPP_NAMESPACE::MemBufInputSource xmlInput(
-            reinterpret_cast<XMLByte const *>(xml.c_str()),
+            reinterpret_cast<XMLByte const *>(xml.data()),
             xml.size(), "input");
 
         try {
@@ -126,14 +160,14 @@ namespace alpinocorpus {
             return;
         }
 
-        Result result = d_query->execute(ctx.get());
+        Result result = query.execute(ctx.get());
         
         Item::Ptr item;
         while ((item = result->next(ctx.get()))) {
             std::string value(UTF8(FunctionString::string(item, ctx.get())));
            
             // XXX - trim value!
-            d_buffer.push(value);
+            matches->push(value);
         }
     }
 
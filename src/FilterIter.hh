@@ -7,12 +7,22 @@
 #include <memory>
 
 #include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/DataView.hh>
 #include <AlpinoCorpus/Entry.hh>
 #include <AlpinoCorpus/IterImpl.hh>
 
+#include "StreamingQuery.hh"
+#include "util/InterruptFlag.hh"
+
 class XQQuery;
 
 namespace alpinocorpus {
+    /**
+     * Iterator that filters entries using an XPath query. Queries in the
+     * subset that is supported by StreamingQuery are evaluated while
+     * streaming through the entries, other queries are evaluated by
+     * XQilla.
+     */
     class FilterIter : public IterImpl {
       public:
         FilterIter(CorpusReader const &corpus,
@@ -24,18 +34,36 @@ namespace alpinocorpus {
         Entry next(CorpusReader const &rdr);
         double progress();
 
+        /**
+         * Compile an XPath query for use by a filter iterator. Compiled
+         * queries are cached, so the same query is only compiled once.
+         */
+        static std::shared_ptr<XQQuery> compile(std::string const &query);
+
+        /**
+         * Evaluate a compiled query on a document, adding the string
+         * values of the results to <i>matches</i>. A compiled query can
+         * be evaluated from multiple threads simultaneously.
+         */
+        static void evaluate(XQQuery const &query, std::string const &xml,
+            std::queue<std::string> *matches);
+        static void evaluate(XQQuery const &query, DataView const &xml,
+            std::queue<std::string> *matches);
+
       protected:
         void interrupt();
       
       private:
-        void parseFile(std::string const &);
+        static std::shared_ptr<XQQuery> compileUncached(std::string const &query);
+        void parseFile(DataView const &xml);
         
         CorpusReader const &d_corpus;
         CorpusReader::EntryIterator d_itr;
         std::string d_file;
+        StreamingQueryPtr d_streamingQuery;
         std::shared_ptr<XQQuery> d_query;
         std::queue<std::string> d_buffer;
-        bool d_interrupted;
+        util::InterruptFlag d_interrupted;
     };
 }
 
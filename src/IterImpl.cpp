@@ -15,6 +15,11 @@ namespace alpinocorpus {
         return false;
     }
 
+    bool IterImpl::hasContents()
+    {
+        return false;
+    }
+
     double IterImpl::progress()
     {
         return NAN;
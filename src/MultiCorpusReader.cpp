@@ -1,4 +1,6 @@
+#include <map>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/MultiCorpusReader.hh>
@@ -38,6 +40,17 @@ void MultiCorpusReader::push_back(std::string const &name, std::string const &re
   d_private->push_back(name, reader, recursive);
 }
 
+void MultiCorpusReader::setReaderPoolLimits(size_t maxReaders, size_t maxMemory)
+{
+  d_private->setReaderPoolLimits(maxReaders, maxMemory);
+}
+
+std::map<std::string, std::vector<std::string> > MultiCorpusReader::groupByCorpus(
+    std::vector<std::string> const &paths) const
+{
+  return d_private->groupByCorpus(paths);
+}
+
 Either<std::string, Empty> MultiCorpusReader::validQuery(QueryDialect d, bool variables, std::string const &query) const
 {
   return d_private->isValidQuery(d, variables, query);
@@ -48,6 +61,24 @@ std::string MultiCorpusReader::readEntry(std::string const &entry) const
   return d_private->readEntry(entry);
 }
 
+std::vector<Token> MultiCorpusReader::getTokens(std::string const &entry,
+    std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+{
+  return d_private->getTokens(entry, attributes, defaultValue, corpusInfo);
+}
+
+DataView MultiCorpusReader::readEntryView(std::string const &entry) const
+{
+  return d_private->readEntryView(entry);
+}
+
+std::vector<std::string> MultiCorpusReader::readEntries(
+    std::vector<std::string> const &entries) const
+{
+  return d_private->readEntries(entries);
+}
+
 std::string MultiCorpusReader::readEntryMarkQueries(std::string const &entry,
     std::list<MarkerQuery> const &queries) const
 {
@@ -59,6 +90,12 @@ CorpusReader::EntryIterator MultiCorpusReader::runXPath(std::string const &query
   return d_private->query(XPATH, query, sortOrder);
 }
 
+CorpusReader::EntryIterator MultiCorpusReader::runParallelXPath(std::string const &query,
+    size_t nThreads, bool preserveOrder, SortOrder sortOrder) const
+{
+  return d_private->parallelQuery(query, nThreads, preserveOrder, sortOrder);
+}
+
 CorpusReader::EntryIterator MultiCorpusReader::runXQuery(std::string const &query, SortOrder sortOrder) const
 {
   return d_private->query(XQUERY, query, sortOrder);
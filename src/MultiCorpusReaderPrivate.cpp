@@ -1,9 +1,16 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <dbxml/DbXml.hpp>
@@ -15,12 +22,188 @@
 #include <AlpinoCorpus/util/Either.hh>
 
 #include "MultiCorpusReaderPrivate.hh"
+#include "util/ThreadPool.hh"
 
 namespace bf = boost::filesystem;
 
+namespace {
+  // Number of entries that a sub-corpus scan can buffer before it blocks.
+  size_t const SCAN_BUFFER_SIZE = 256;
+
+  // Number of sub-corpora that can be scanned or buffered per thread.
+  size_t const SCAN_WINDOW_PER_THREAD = 2;
+
+  // Default limits of the pool of open sub-corpus readers.
+  size_t const DEFAULT_POOL_MAX_READERS = 16;
+  size_t const DEFAULT_POOL_MAX_MEMORY = 256 * 1024 * 1024;
+
+  // Rough memory use of readers that do not keep their index in memory
+  // (Dact corpora, directories of corpora).
+  size_t const READER_BASE_MEMORY = 1024 * 1024;
+
+  // Estimate the memory use of an open reader. Compact corpus readers
+  // keep their index in memory, which is roughly the size of the index
+  // file.
+  size_t estimateReaderMemory(std::string const &filename, bool recursive)
+  {
+    if (recursive)
+      return READER_BASE_MEMORY;
+
+    boost::system::error_code ec;
+    bf::path path(filename);
+    if (path.extension() != ".index" || !bf::is_regular_file(path, ec))
+      return READER_BASE_MEMORY;
+
+    uintmax_t size = bf::file_size(path, ec);
+    if (ec)
+      return READER_BASE_MEMORY;
+
+    return READER_BASE_MEMORY + static_cast<size_t>(size);
+  }
+
+  struct ScanSlot
+  {
+    ScanSlot() : iter(0), signalled(false), done(false) {}
+
+    std::deque<alpinocorpus::Entry> entries;
+
+    // The iterator of a running scan, so that it can be interrupted.
+    alpinocorpus::CorpusReader::EntryIterator *iter;
+
+    // The slot is in the queue of available slots.
+    bool signalled;
+    bool done;
+  };
+
+  // State that is shared between the consumer and the scans.
+  struct ScanState
+  {
+    ScanState(size_t nSlots, bool newOrdered) : slots(nSlots),
+      ordered(newOrdered), interrupted(false), cancelled(false) {}
+
+    // Should be called with the mutex held.
+    void signal(size_t slot)
+    {
+      // In ordered mode, the consumer only waits for the current slot.
+      if (!ordered && !slots[slot].signalled)
+      {
+        slots[slot].signalled = true;
+        available.push_back(slot);
+      }
+      cond.notify_all();
+    }
+
+    // Should be called with the mutex held.
+    void stop()
+    {
+      for (std::vector<ScanSlot>::iterator iter = slots.begin();
+          iter != slots.end(); ++iter)
+        if (iter->iter)
+          iter->iter->interrupt();
+      cond.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<ScanSlot> slots;
+
+    bool ordered;
+
+    // Slots with new entries or that are done, in the order in which
+    // they became available.
+    std::deque<size_t> available;
+
+    std::exception_ptr error;
+    bool interrupted;
+    bool cancelled;
+  };
+
+  void scanCorpus(std::shared_ptr<ScanState> state, size_t slot,
+      alpinocorpus::MultiCorpusReaderPrivate::ReaderIter const &corpus,
+      std::string const &query, alpinocorpus::SortOrder sortOrder)
+  {
+    using alpinocorpus::CorpusReader;
+    using alpinocorpus::CorpusReaderFactory;
+
+    std::unique_ptr<CorpusReader> reader;
+    CorpusReader::EntryIterator iter;
+
+    bool skip;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      skip = state->cancelled || state->interrupted;
+    }
+
+    // Corpora that cannot be opened or queried are skipped, as in the
+    // sequential scan.
+    if (!skip)
+    {
+      try {
+        if (corpus.recursive)
+          reader.reset(CorpusReaderFactory::openRecursive(corpus.filename));
+        else
+          reader.reset(CorpusReaderFactory::open(corpus.filename));
+
+        iter = reader->query(CorpusReader::XPATH, query, sortOrder);
+      } catch (std::runtime_error const &) {
+        skip = true;
+      } catch (...) {
+        // Other errors are reported, as during iteration, but the slot
+        // must still be marked done.
+        skip = true;
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->error)
+          state->error = std::current_exception();
+      }
+    }
+
+    if (!skip)
+    {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->slots[slot].iter = &iter;
+        skip = state->cancelled || state->interrupted;
+      }
+
+      try {
+        while (!skip && iter.hasNext())
+        {
+          alpinocorpus::Entry e = iter.next(*reader);
+          e.name = corpus.name + "/" + e.name;
+
+          std::unique_lock<std::mutex> lock(state->mutex);
+          ScanSlot &s = state->slots[slot];
+          state->cond.wait(lock, [&state, &s]() {
+            return state->cancelled || state->interrupted ||
+              s.entries.size() < SCAN_BUFFER_SIZE;
+          });
+
+          if (state->cancelled || state->interrupted)
+            break;
+
+          s.entries.push_back(std::move(e));
+          state->signal(slot);
+        }
+      } catch (alpinocorpus::IterationInterrupted const &) {
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->error)
+          state->error = std::current_exception();
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->slots[slot].iter = 0;
+    state->slots[slot].done = true;
+    state->signal(slot);
+  }
+}
+
 namespace alpinocorpus {
 
-MultiCorpusReaderPrivate::MultiCorpusReaderPrivate()
+MultiCorpusReaderPrivate::MultiCorpusReaderPrivate() :
+  d_poolMemory(0), d_poolMaxReaders(DEFAULT_POOL_MAX_READERS),
+  d_poolMaxMemory(DEFAULT_POOL_MAX_MEMORY)
 {
     DbXml::XmlContainerConfig config;
     config.setReadOnly(false);
@@ -49,26 +232,33 @@ std::string MultiCorpusReaderPrivate::getName() const
 
 size_t MultiCorpusReaderPrivate::getSize() const
 {
+  {
+    std::lock_guard<std::mutex> lock(d_poolMutex);
+    if (d_size)
+      return *d_size;
+  }
+
   size_t size = 0;
 
   for (std::list<std::pair<std::string, bool> >::const_iterator iter =
       d_corpora.begin(); iter != d_corpora.end(); ++iter)
   {
-      CorpusReader *reader;
+      PooledReader reader;
       try {
-          if (iter->second)
-            reader = CorpusReaderFactory::openRecursive(iter->first);
-          else
-            reader = CorpusReaderFactory::open(iter->first);
+        reader = acquireReader(*iter);
       } catch (OpenError const &)
       {
         // XXX - Print a warning?
         continue;
       }
-      size += reader->size();
-      delete reader;
+
+      std::lock_guard<std::mutex> lock(*reader.mutex);
+      size += reader.reader->size();
   }
 
+  std::lock_guard<std::mutex> lock(d_poolMutex);
+  d_size.reset(new size_t(size));
+
   return size;
 }
 
@@ -81,84 +271,194 @@ void MultiCorpusReaderPrivate::push_back(std::string const &name,
 
     d_corpora.push_back(std::make_pair(filename, recursive));
     d_corporaMap[name] = std::make_pair(filename, recursive); // XXX - exists check?
+
+    // Entry paths are the corpus name, followed by a slash and the entry
+    // name. Nodes of the corpus map are stable.
+    d_router.insert(name + "/", &*d_corporaMap.find(name));
+
+    std::lock_guard<std::mutex> lock(d_poolMutex);
+    d_size.reset();
 }
 
-std::pair<std::string, bool> MultiCorpusReaderPrivate::corpusFromPath(
-    std::string const &path) const
+void MultiCorpusReaderPrivate::setReaderPoolLimits(size_t maxReaders,
+    size_t maxMemory)
 {
-  bool found = false;
-  std::string match;
-  std::pair<std::string, bool> corpus;
+  std::lock_guard<std::mutex> lock(d_poolMutex);
+  d_poolMaxReaders = maxReaders;
+  d_poolMaxMemory = maxMemory;
+  evictReaders();
+}
 
-  for (Corpora::const_iterator iter =
-      d_corporaMap.begin(); iter != d_corporaMap.end(); ++iter) {
-    if (path.find(iter->first) == 0) {
-      found = true;
-      if (iter->first.size() > match.size()) {
-        match = iter->first;
-	corpus = iter->second;
-      }
+MultiCorpusReaderPrivate::PooledReader MultiCorpusReaderPrivate::acquireReader(
+    std::pair<std::string, bool> const &corpus) const
+{
+  {
+    std::lock_guard<std::mutex> lock(d_poolMutex);
+    std::unordered_map<std::string, ReaderPool::iterator>::const_iterator iter =
+      d_poolIndex.find(corpus.first);
+    if (iter != d_poolIndex.end())
+    {
+      d_pool.splice(d_pool.begin(), d_pool, iter->second);
+      return *iter->second;
     }
   }
 
-  if (found) {
-    return corpus;
+  // Open the reader without holding the lock, opening can be slow.
+  PooledReader pooled;
+  pooled.filename = corpus.first;
+  if (corpus.second)
+    pooled.reader.reset(CorpusReaderFactory::openRecursive(corpus.first));
+  else
+    pooled.reader.reset(CorpusReaderFactory::open(corpus.first));
+  pooled.mutex.reset(new std::mutex);
+  pooled.memory = estimateReaderMemory(corpus.first, corpus.second);
+
+  std::lock_guard<std::mutex> lock(d_poolMutex);
+
+  // Another thread may have opened the same corpus in the meanwhile.
+  std::unordered_map<std::string, ReaderPool::iterator>::const_iterator iter =
+    d_poolIndex.find(corpus.first);
+  if (iter != d_poolIndex.end())
+  {
+    d_pool.splice(d_pool.begin(), d_pool, iter->second);
+    return *iter->second;
   }
 
-  throw std::runtime_error(std::string("Unknown corpus: " + path));
+  if (d_poolMaxReaders == 0)
+    return pooled;
+
+  d_pool.push_front(pooled);
+  d_poolIndex[corpus.first] = d_pool.begin();
+  d_poolMemory += pooled.memory;
+  evictReaders();
+
+  return pooled;
 }
 
-std::string MultiCorpusReaderPrivate::entryFromPath(
-    std::string const &path) const
+// Should be called with d_poolMutex held. Readers that are evicted while
+// they are in use are closed when they are released.
+void MultiCorpusReaderPrivate::evictReaders() const
 {
-  bool found = false;
-  std::string match;
-
-  // Find corpus with longest shared name prefix.
-  for (Corpora::const_iterator iter =
-      d_corporaMap.begin(); iter != d_corporaMap.end(); ++iter) {
-    if (path.find(iter->first) == 0) {
-      found = true;
-      if (iter->first.size() > match.size()) {
-        match = iter->first;
-      }
-    }
+  // The most recently used reader is kept, even if it exceeds the memory
+  // limit by itself.
+  while (!d_pool.empty() && (d_pool.size() > d_poolMaxReaders ||
+      (d_pool.size() > 1 && d_poolMemory > d_poolMaxMemory)))
+  {
+    d_poolMemory -= d_pool.back().memory;
+    d_poolIndex.erase(d_pool.back().filename);
+    d_pool.pop_back();
   }
+}
+
+MultiCorpusReaderPrivate::Corpora::value_type const &
+MultiCorpusReaderPrivate::corpusFromPath(std::string const &path,
+    std::string *entry) const
+{
+  // Find corpus with longest name prefix.
+  size_t length;
+  Corpora::value_type const * const *corpus =
+    d_router.longestPrefix(path, &length);
+
+  if (!corpus)
+    throw std::runtime_error(std::string("Unknown corpus: " + path));
+
+  if (entry)
+    *entry = path.substr(length);
+
+  return **corpus;
+}
+
+std::map<std::string, std::vector<std::string> >
+MultiCorpusReaderPrivate::groupByCorpus(
+    std::vector<std::string> const &paths) const
+{
+  std::map<std::string, std::vector<std::string> > groups;
 
-  if (found) {
-    return path.substr(match.size() + 1);
+  std::string entry;
+  for (std::vector<std::string>::const_iterator iter = paths.begin();
+      iter != paths.end(); ++iter)
+  {
+    Corpora::value_type const &corpus = corpusFromPath(*iter, &entry);
+    groups[corpus.first].push_back(entry);
   }
 
-  throw std::runtime_error(std::string("Could not find entry: " + path));
+  return groups;
 }
 
 std::string MultiCorpusReaderPrivate::readEntry(std::string const &path) const
 {
-  std::pair<std::string, bool> fnRec = corpusFromPath(path);
-  CorpusReader *reader;
-  if (fnRec.second)
-    reader = CorpusReaderFactory::openRecursive(fnRec.first);
-  else
-    reader = CorpusReaderFactory::open(fnRec.first);
+  std::string entry;
+  PooledReader reader = acquireReader(corpusFromPath(path, &entry).second);
+
+  std::lock_guard<std::mutex> lock(*reader.mutex);
+  return reader.reader->read(entry);
+}
+
+std::vector<Token> MultiCorpusReaderPrivate::getTokens(
+    std::string const &path, std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+{
+  std::string entry;
+  PooledReader reader = acquireReader(corpusFromPath(path, &entry).second);
+
+  std::lock_guard<std::mutex> lock(*reader.mutex);
+  return reader.reader->tokens(entry, attributes, defaultValue, corpusInfo);
+}
+
+DataView MultiCorpusReaderPrivate::readEntryView(std::string const &path) const
+{
+  std::string entry;
+  PooledReader reader = acquireReader(corpusFromPath(path, &entry).second);
 
-  std::string data = reader->read(entryFromPath(path));
-  delete reader;
-  return data;
+  std::lock_guard<std::mutex> lock(*reader.mutex);
+  return reader.reader->readView(entry);
+}
+
+std::vector<std::string> MultiCorpusReaderPrivate::readEntries(
+    std::vector<std::string> const &entries) const
+{
+  // Group the entries by corpus, so that every sub-corpus reads its
+  // entries in a single batch. For each corpus, we store the entry names
+  // and their positions in the result.
+  typedef std::pair<std::vector<std::string>, std::vector<size_t> > Group;
+  std::map<Corpora::value_type const *, Group> groups;
+
+  std::string entry;
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    Group &group = groups[&corpusFromPath(entries[i], &entry)];
+    group.first.push_back(entry);
+    group.second.push_back(i);
+  }
+
+  std::vector<std::string> contents(entries.size());
+
+  for (std::map<Corpora::value_type const *, Group>::const_iterator iter =
+      groups.begin(); iter != groups.end(); ++iter)
+  {
+    PooledReader reader = acquireReader(iter->first->second);
+
+    std::vector<std::string> groupContents;
+    {
+      std::lock_guard<std::mutex> lock(*reader.mutex);
+      groupContents = reader.reader->readMany(iter->second.first);
+    }
+
+    for (size_t i = 0; i < groupContents.size(); ++i)
+      contents[iter->second.second[i]].swap(groupContents[i]);
+  }
+
+  return contents;
 }
 
 std::string MultiCorpusReaderPrivate::readEntryMarkQueries(
     std::string const &path, std::list<MarkerQuery> const &queries) const
 {
-  std::pair<std::string, bool> fnRec = corpusFromPath(path);
-  CorpusReader *reader;
-  if (fnRec.second)
-    reader = CorpusReaderFactory::openRecursive(fnRec.first);
-  else
-    reader = CorpusReaderFactory::open(fnRec.first);
+  std::string entry;
+  PooledReader reader = acquireReader(corpusFromPath(path, &entry).second);
 
-  std::string data = reader->read(entryFromPath(path), queries);
-  delete reader;
-  return data;
+  std::lock_guard<std::mutex> lock(*reader.mutex);
+  return reader.reader->read(entry, queries);
 }
 
 CorpusReader::EntryIterator MultiCorpusReaderPrivate::runXPath(
@@ -167,6 +467,14 @@ CorpusReader::EntryIterator MultiCorpusReaderPrivate::runXPath(
   return EntryIterator(new MultiIter(d_corporaMap, query, CorpusReader::XPATH, sortOrder));
 }
 
+CorpusReader::EntryIterator MultiCorpusReaderPrivate::runParallelXPath(
+  std::string const &query, size_t nThreads, bool preserveOrder,
+  SortOrder sortOrder) const
+{
+  return EntryIterator(new MultiIter(d_corporaMap, query, nThreads,
+    preserveOrder, sortOrder));
+}
+
 CorpusReader::EntryIterator MultiCorpusReaderPrivate::runXQuery(
   std::string const &query, SortOrder sortOrder) const
 {
@@ -175,9 +483,109 @@ CorpusReader::EntryIterator MultiCorpusReaderPrivate::runXQuery(
 
 // Iteration over MultiCorpusReaders
 
+// Concurrent scan of sub-corpora. Each sub-corpus is queried on a worker
+// thread, the matches are passed to the consumer through a bounded buffer
+// per sub-corpus. At most a window of sub-corpora is scanned or has
+// unconsumed matches at any time.
+struct MultiCorpusReaderPrivate::MultiIter::Scan
+{
+  Scan(std::list<ReaderIter> const &newCorpora, std::string const &newQuery,
+      size_t nThreads, bool newOrdered, SortOrder newSortOrder) :
+    corpora(newCorpora.begin(), newCorpora.end()), query(newQuery),
+    ordered(newOrdered), sortOrder(newSortOrder), started(0), current(0),
+    retired(0), state(new ScanState(corpora.size(), ordered)),
+    pool(new util::ThreadPool(std::min(nThreads, corpora.size())))
+  {
+    window = pool->size() * SCAN_WINDOW_PER_THREAD;
+  }
+
+  ~Scan()
+  {
+    // Queued scans are discarded when the pool is destroyed, running
+    // scans are stopped.
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->cancelled = true;
+    state->stop();
+  }
+
+  void start();
+  bool ready() const;
+  bool take(size_t slot);
+
+  std::vector<ReaderIter> corpora;
+  std::string query;
+  bool ordered;
+  SortOrder sortOrder;
+  size_t window;
+
+  // Consumer-side bookkeeping.
+  size_t started;
+  size_t current;
+  size_t retired;
+  std::deque<Entry> buffer;
+
+  std::shared_ptr<ScanState> state;
+
+  // Destroyed first, so that the workers are joined before the
+  // remainder of the scan is torn down.
+  std::unique_ptr<util::ThreadPool> pool;
+};
+
+void MultiCorpusReaderPrivate::MultiIter::Scan::start()
+{
+  while (started < corpora.size() && started - retired < window)
+  {
+    std::shared_ptr<ScanState> sharedState(state);
+    ReaderIter corpus(corpora[started]);
+    std::string sharedQuery(query);
+    SortOrder order = sortOrder;
+    size_t slot = started++;
+
+    pool->post([sharedState, slot, corpus, sharedQuery, order]() {
+      scanCorpus(sharedState, slot, corpus, sharedQuery, order);
+    });
+  }
+}
+
+// Should be called with state->mutex held.
+bool MultiCorpusReaderPrivate::MultiIter::Scan::ready() const
+{
+  if (state->interrupted || state->error)
+    return true;
+
+  if (retired == corpora.size())
+    return true;
+
+  if (ordered)
+    return !state->slots[current].entries.empty() ||
+      state->slots[current].done;
+
+  return !state->available.empty();
+}
+
+// Move the buffered entries of a slot to the consumer. Returns true if
+// the slot is done and all its entries were taken. Should be called with
+// state->mutex held.
+bool MultiCorpusReaderPrivate::MultiIter::Scan::take(size_t slot)
+{
+  ScanSlot &s = state->slots[slot];
+  s.signalled = false;
+  std::swap(buffer, s.entries);
+  state->cond.notify_all();
+
+  if (s.done && s.entries.empty())
+  {
+    ++retired;
+    return true;
+  }
+
+  return false;
+}
+
 MultiCorpusReaderPrivate::MultiIter::MultiIter(
   Corpora const &corpora, SortOrder sortOrder) : d_sortOrder(sortOrder), d_hasQuery(false),
-						 d_dialect(CorpusReader::XPATH), d_interrupted(false)
+						 d_dialect(CorpusReader::XPATH), d_parallel(false),
+						 d_nThreads(1), d_preserveOrder(true), d_interrupted(false)
 {
   d_currentIterMutex.reset(new std::mutex);
 
@@ -196,7 +604,8 @@ MultiCorpusReaderPrivate::MultiIter::MultiIter(
   std::string const &query,
   CorpusReader::QueryDialect dialect,
   SortOrder sortOrder) :
-  d_sortOrder(sortOrder), d_hasQuery(true), d_query(query), d_dialect(dialect), d_interrupted(false)
+  d_sortOrder(sortOrder), d_hasQuery(true), d_query(query), d_dialect(dialect),
+  d_parallel(false), d_nThreads(1), d_preserveOrder(true), d_interrupted(false)
 {
   d_currentIterMutex.reset(new std::mutex);
 
@@ -210,6 +619,38 @@ MultiCorpusReaderPrivate::MultiIter::MultiIter(
   d_totalIters = d_iters.size();
 }
 
+MultiCorpusReaderPrivate::MultiIter::MultiIter(
+  Corpora const &corpora,
+  std::string const &query,
+  size_t nThreads,
+  bool preserveOrder,
+  SortOrder sortOrder) :
+  d_sortOrder(sortOrder), d_hasQuery(true), d_query(query),
+  d_dialect(CorpusReader::XPATH), d_parallel(true), d_nThreads(nThreads),
+  d_preserveOrder(preserveOrder), d_interrupted(false)
+{
+  d_currentIterMutex.reset(new std::mutex);
+
+  for (Corpora::const_iterator
+      iter = corpora.begin();
+      iter != corpora.end(); ++iter)
+    d_iters.push_back(ReaderIter(iter->first, iter->second.first,
+          iter->second.second));
+
+  // Initial number of 'iterators'.
+  d_totalIters = d_iters.size();
+
+  // With multiple sub-corpora, scan several sub-corpora at once. Each
+  // sub-corpus is then queried on a single thread. A single sub-corpus
+  // is queried in parallel instead.
+  size_t threads = nThreads == 0 ? util::ThreadPool::defaultSize() : nThreads;
+  if (threads > 1 && d_iters.size() > 1)
+  {
+    d_scan.reset(new Scan(d_iters, query, threads, preserveOrder, sortOrder));
+    d_iters.clear();
+  }
+}
+
 MultiCorpusReaderPrivate::MultiIter::~MultiIter() {}
 
 IterImpl *MultiCorpusReaderPrivate::MultiIter::copy() const
@@ -223,6 +664,43 @@ bool MultiCorpusReaderPrivate::MultiIter::hasNext()
 {
     if (d_interrupted)
         throw IterationInterrupted();
+
+    if (d_scan)
+    {
+      Scan &scan = *d_scan;
+
+      while (scan.buffer.empty())
+      {
+        scan.start();
+
+        std::unique_lock<std::mutex> lock(scan.state->mutex);
+        scan.state->cond.wait(lock, [&scan]() { return scan.ready(); });
+
+        if (scan.state->interrupted)
+          throw IterationInterrupted();
+
+        if (scan.state->error)
+          std::rethrow_exception(scan.state->error);
+
+        if (scan.retired == scan.corpora.size())
+          return false;
+
+        if (scan.ordered)
+        {
+          if (scan.take(scan.current))
+            ++scan.current;
+        }
+        else
+        {
+          size_t slot = scan.state->available.front();
+          scan.state->available.pop_front();
+          scan.take(slot);
+        }
+      }
+
+      return true;
+    }
+
     nextIterator();
     return d_currentIter && d_currentIter->hasNext();
 }
@@ -236,6 +714,14 @@ void MultiCorpusReaderPrivate::MultiIter::interrupt()
 {
   d_interrupted = true;
 
+  if (d_scan)
+  {
+    std::lock_guard<std::mutex> lock(d_scan->state->mutex);
+    d_scan->state->interrupted = true;
+    d_scan->state->stop();
+    return;
+  }
+
   // d_currentIter could be resetted in the iteration thread after the
   // null-pointer check.
   std::lock_guard<std::mutex> lock(*d_currentIterMutex);
@@ -248,6 +734,16 @@ Entry MultiCorpusReaderPrivate::MultiIter::next(CorpusReader const &rdr)
     if (d_interrupted)
         throw IterationInterrupted();
 
+    if (d_scan)
+    {
+      if (d_scan->buffer.empty())
+        throw Error("Calling next() on an iterator that is exhausted.");
+
+      Entry e(std::move(d_scan->buffer.front()));
+      d_scan->buffer.pop_front();
+      return e;
+    }
+
     Entry e = d_currentIter->next(rdr);
     e.name = d_currentName + "/" + e.name;
 
@@ -282,7 +778,10 @@ void MultiCorpusReaderPrivate::MultiIter::openTip()
     }
 
     try {
-      if (d_hasQuery)
+      if (d_parallel)
+        d_currentIter.reset(new EntryIterator(reader->parallelQuery(d_query,
+          d_nThreads, d_preserveOrder, d_sortOrder)));
+      else if (d_hasQuery)
         d_currentIter.reset(new EntryIterator(reader->query(d_dialect, d_query, d_sortOrder)));
       else
         d_currentIter.reset(new EntryIterator(reader->entries(d_sortOrder)));
@@ -298,6 +797,10 @@ void MultiCorpusReaderPrivate::MultiIter::openTip()
 
 double MultiCorpusReaderPrivate::MultiIter::progress()
 {
+    if (d_scan)
+      return static_cast<double>(d_scan->retired) /
+          static_cast<double>(d_scan->corpora.size()) * 100.0;
+
     if (d_currentIter)
       return static_cast<double>(d_totalIters - d_iters.size() - 1) /
           static_cast<double>(d_totalIters) * 100.0;
@@ -3,7 +3,9 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <dbxml/DbXml.hpp>
@@ -12,7 +14,9 @@
 #include <AlpinoCorpus/Entry.hh>
 #include <AlpinoCorpus/IterImpl.hh>
 
+#include "util/InterruptFlag.hh"
 #include "util/NameCompare.hh"
+#include "util/PrefixTrie.hh"
 
 namespace alpinocorpus {
 
@@ -39,6 +43,11 @@ private:
 	      std::string const &query,
 	      CorpusReader::QueryDialect dialect,
 	      SortOrder sortOrder);
+    MultiIter(Corpora const &corpora,
+	      std::string const &query,
+	      size_t nThreads,
+	      bool preserveOrder,
+	      SortOrder sortOrder);
     ~MultiIter();
     IterImpl *copy() const;
     void nextIterator();
@@ -48,6 +57,8 @@ private:
     Entry next(CorpusReader const &rdr);
     double progress();
   private:
+    struct Scan;
+
     void openTip();
 
     SortOrder d_sortOrder;
@@ -60,7 +71,14 @@ private:
     bool d_hasQuery;
     std::string d_query;
     CorpusReader::QueryDialect d_dialect;
-    bool d_interrupted;
+    bool d_parallel;
+    size_t d_nThreads;
+    bool d_preserveOrder;
+    util::InterruptFlag d_interrupted;
+
+    // Set when sub-corpora are scanned concurrently. Copies share the
+    // scan, since the worker threads cannot be copied.
+    std::shared_ptr<Scan> d_scan;
   };
 
 public:
@@ -72,22 +90,63 @@ public:
   size_t getSize() const;
   void push_back(std::string const &name, std::string const &filename,
       bool recursive = false);
+  void setReaderPoolLimits(size_t maxReaders, size_t maxMemory);
+  std::map<std::string, std::vector<std::string> > groupByCorpus(
+      std::vector<std::string> const &paths) const;
+  std::vector<Token> getTokens(std::string const &entry,
+      std::vector<std::string> const &attributes,
+      std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
   std::string readEntry(std::string const &) const;
+  DataView readEntryView(std::string const &) const;
+  std::vector<std::string> readEntries(std::vector<std::string> const &) const;
   std::string readEntryMarkQueries(std::string const &entry, std::list<MarkerQuery> const &queries) const;
 
 protected:
 
   EntryIterator runXPath(std::string const &query, SortOrder sortOrder) const;
+  EntryIterator runParallelXPath(std::string const &query, size_t nThreads,
+      bool preserveOrder, SortOrder sortOrder) const;
   EntryIterator runXQuery(std::string const &query, SortOrder sortOrder) const;
   Either<std::string, Empty> validQuery(QueryDialect d, bool variables, std::string const &query) const;
 
 private:
-  std::pair<std::string, bool> corpusFromPath(std::string const &path) const;
-  std::string entryFromPath(std::string const &path) const;
+  // An open sub-corpus reader. Reading entries is thread-safe, but
+  // querying a reader is not, so pooled readers are only used with
+  // their mutex held.
+  struct PooledReader
+  {
+    std::string filename;
+    std::shared_ptr<CorpusReader> reader;
+    std::shared_ptr<std::mutex> mutex;
+    size_t memory;
+  };
+
+  // Most recently used readers first.
+  typedef std::list<PooledReader> ReaderPool;
+
+  PooledReader acquireReader(std::pair<std::string, bool> const &corpus) const;
+  void evictReaders() const;
+  Corpora::value_type const &corpusFromPath(std::string const &path,
+      std::string *entry) const;
 
   boost::filesystem::path d_directory;
   std::list<std::pair<std::string, bool> > d_corpora;
   Corpora d_corporaMap;
+
+  // Maps entry path prefixes (corpus names followed by a slash) to corpora.
+  util::PrefixTrie<Corpora::value_type const *> d_router;
+
+  mutable std::mutex d_poolMutex;
+  mutable ReaderPool d_pool;
+  mutable std::unordered_map<std::string, ReaderPool::iterator> d_poolIndex;
+  mutable size_t d_poolMemory;
+  size_t d_poolMaxReaders;
+  size_t d_poolMaxMemory;
+
+  // The size of the corpus, cached after the first computation. Protected
+  // by the pool mutex.
+  mutable std::shared_ptr<size_t> d_size;
+
   mutable DbXml::XmlManager d_mgr;
   DbXml::XmlContainer d_container;
 };
@@ -0,0 +1,270 @@
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <utility>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Entry.hh>
+#include <AlpinoCorpus/Error.hh>
+
+#include "FilterIter.hh"
+#include "ParallelFilterIter.hh"
+#include "StreamingQuery.hh"
+#include "util/ThreadPool.hh"
+
+namespace {
+    // Number of entries that can be in flight per worker thread.
+    size_t const WINDOW_PER_THREAD = 4;
+
+    struct Match
+    {
+        std::string name;
+        std::queue<std::string> values;
+    };
+
+    // State that is shared between the consumer and the workers.
+    struct Results
+    {
+        Results() : interrupted(false), cancelled(false) {}
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::map<size_t, Match> done;
+        std::exception_ptr error;
+        bool interrupted;
+        bool cancelled;
+    };
+
+    void evaluateEntry(std::shared_ptr<Results> results,
+        alpinocorpus::StreamingQueryPtr streamingQuery,
+        std::shared_ptr<XQQuery> query,
+        alpinocorpus::CorpusReader const *corpus,
+        size_t seq, std::string const &name,
+        std::shared_ptr<std::string const> contents)
+    {
+        {
+            std::lock_guard<std::mutex> lock(results->mutex);
+            if (results->cancelled)
+                return;
+        }
+
+        Match match;
+        match.name = name;
+
+        try {
+            // Entries are only read if the iterator did not return their
+            // contents.
+            alpinocorpus::DataView xml(contents ?
+                alpinocorpus::DataView(contents, contents->data(),
+                    contents->size()) :
+                corpus->readView(name));
+            if (streamingQuery)
+                streamingQuery->evaluate(xml.data(), xml.size(), &match.values);
+            else
+                alpinocorpus::FilterIter::evaluate(*query, xml, &match.values);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(results->mutex);
+            if (!results->error)
+                results->error = std::current_exception();
+            results->cond.notify_all();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(results->mutex);
+        results->done.insert(std::make_pair(seq, std::move(match)));
+        results->cond.notify_all();
+    }
+}
+
+namespace alpinocorpus {
+
+    struct ParallelFilterIter::Pipeline
+    {
+        Pipeline(CorpusReader const &newCorpus,
+                CorpusReader::EntryIterator newItr,
+                std::string const &newQuery,
+                size_t nThreads, bool newOrdered) :
+            corpus(newCorpus), itr(newItr),
+            streamingQuery(StreamingQuery::compile(newQuery)),
+            query(streamingQuery ? std::shared_ptr<XQQuery>() :
+                FilterIter::compile(newQuery)),
+            ordered(newOrdered),
+            submitted(0), consumed(0), exhausted(false),
+            results(new Results), pool(new util::ThreadPool(nThreads))
+        {
+            window = pool->size() * WINDOW_PER_THREAD;
+        }
+
+        ~Pipeline()
+        {
+            // Queued evaluations are discarded when the pool is destroyed,
+            // but the pool may start one in the meanwhile.
+            std::lock_guard<std::mutex> lock(results->mutex);
+            results->cancelled = true;
+        }
+
+        void fill();
+        bool ready() const;
+
+        CorpusReader const &corpus;
+        CorpusReader::EntryIterator itr;
+        StreamingQueryPtr streamingQuery;
+        std::shared_ptr<XQQuery> query;
+        bool ordered;
+        size_t window;
+
+        // Consumer-side bookkeeping.
+        std::string lastName;
+        size_t submitted;
+        size_t consumed;
+        bool exhausted;
+        std::string bufferName;
+        std::queue<std::string> buffer;
+
+        std::shared_ptr<Results> results;
+
+        // Destroyed first, so that the workers are joined before the
+        // remainder of the pipeline is torn down.
+        std::unique_ptr<util::ThreadPool> pool;
+    };
+
+    void ParallelFilterIter::Pipeline::fill()
+    {
+        while (!exhausted && submitted - consumed < window)
+        {
+            if (!itr.hasNext())
+            {
+                exhausted = true;
+                break;
+            }
+
+            Entry e = itr.next(corpus);
+
+            // See FilterIter::hasNext(), the wrapped iterator may return
+            // an entry once for every match.
+            if (e.name == lastName)
+                continue;
+
+            lastName = e.name;
+
+            std::shared_ptr<Results> sharedResults(results);
+            StreamingQueryPtr sharedStreamingQuery(streamingQuery);
+            std::shared_ptr<XQQuery> sharedQuery(query);
+            CorpusReader const *reader = &corpus;
+            size_t seq = submitted++;
+            std::string name = e.name;
+            std::shared_ptr<std::string const> contents;
+            if (itr.hasContents())
+                contents = std::make_shared<std::string const>(
+                    std::move(e.contents));
+
+            pool->post([sharedResults, sharedStreamingQuery, sharedQuery, reader,
+                    seq, name, contents]() {
+                evaluateEntry(sharedResults, sharedStreamingQuery, sharedQuery,
+                    reader, seq, name, contents);
+            });
+        }
+    }
+
+    // Should be called with results->mutex held.
+    bool ParallelFilterIter::Pipeline::ready() const
+    {
+        if (results->interrupted || results->error)
+            return true;
+
+        if (exhausted && consumed == submitted)
+            return true;
+
+        if (ordered)
+            return results->done.find(consumed) != results->done.end();
+
+        return !results->done.empty();
+    }
+
+    ParallelFilterIter::ParallelFilterIter(CorpusReader const &corpus,
+        CorpusReader::EntryIterator itr,
+        std::string const &query,
+        size_t nThreads,
+        bool ordered) :
+        d_pipeline(new Pipeline(corpus, itr, query, nThreads, ordered))
+    {
+    }
+
+    IterImpl *ParallelFilterIter::copy() const
+    {
+        return new ParallelFilterIter(*this);
+    }
+
+    bool ParallelFilterIter::hasNext()
+    {
+        Pipeline &p = *d_pipeline;
+
+        {
+            std::lock_guard<std::mutex> lock(p.results->mutex);
+            p.results->interrupted = false;
+        }
+
+        while (p.buffer.empty())
+        {
+            p.fill();
+
+            std::unique_lock<std::mutex> lock(p.results->mutex);
+            p.results->cond.wait(lock, [&p]() { return p.ready(); });
+
+            if (p.results->interrupted)
+                throw IterationInterrupted();
+
+            if (p.results->error)
+                std::rethrow_exception(p.results->error);
+
+            if (p.exhausted && p.consumed == p.submitted)
+                return false;
+
+            std::map<size_t, Match>::iterator iter = p.ordered ?
+                p.results->done.find(p.consumed) : p.results->done.begin();
+
+            p.bufferName = iter->second.name;
+            std::swap(p.buffer, iter->second.values);
+            p.results->done.erase(iter);
+            ++p.consumed;
+        }
+
+        return true;
+    }
+
+    bool ParallelFilterIter::hasProgress()
+    {
+        return d_pipeline->itr.hasProgress();
+    }
+
+    void ParallelFilterIter::interrupt()
+    {
+        std::lock_guard<std::mutex> lock(d_pipeline->results->mutex);
+        d_pipeline->results->interrupted = true;
+        d_pipeline->results->cond.notify_all();
+    }
+
+    Entry ParallelFilterIter::next(CorpusReader const &)
+    {
+        Pipeline &p = *d_pipeline;
+
+        if (p.buffer.empty())
+            throw Error("Calling next() on an iterator that is exhausted.");
+
+        Entry e = {p.bufferName, p.buffer.front()};
+
+        p.buffer.pop();
+
+        return e;
+    }
+
+    double ParallelFilterIter::progress()
+    {
+        return d_pipeline->itr.progress();
+    }
+
+}
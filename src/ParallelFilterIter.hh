@@ -0,0 +1,48 @@
+#ifndef ALPINOCORPUS_PARALLELFILTERITER_HH
+#define ALPINOCORPUS_PARALLELFILTERITER_HH
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Entry.hh>
+#include <AlpinoCorpus/IterImpl.hh>
+
+namespace alpinocorpus {
+    /**
+     * Filter iterator that reads and evaluates entries on a pool of
+     * worker threads. Entry names are taken from the wrapped iterator
+     * by the consuming thread, the results are passed back through a
+     * bounded window.
+     *
+     * In ordered mode the results are returned in the order of the
+     * wrapped iterator. Otherwise, results are returned as soon as they
+     * are available.
+     */
+    class ParallelFilterIter : public IterImpl {
+      public:
+        ParallelFilterIter(CorpusReader const &corpus,
+            CorpusReader::EntryIterator i,
+            std::string const &query,
+            size_t nThreads,
+            bool ordered);
+        IterImpl *copy() const;
+        bool hasNext();
+        bool hasProgress();
+        Entry next(CorpusReader const &rdr);
+        double progress();
+
+      protected:
+        void interrupt();
+
+      private:
+        struct Pipeline;
+
+        // The worker threads cannot be copied. Copies share the pipeline,
+        // similar to copies of DB XML iterators.
+        std::shared_ptr<Pipeline> d_pipeline;
+    };
+}
+
+#endif // ALPINOCORPUS_PARALLELFILTERITER_HH
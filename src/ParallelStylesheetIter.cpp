@@ -0,0 +1,300 @@
+#include <condition_variable>
+#include <exception>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Entry.hh>
+#include <AlpinoCorpus/Error.hh>
+#include <AlpinoCorpus/Stylesheet.hh>
+
+#include "CompiledMarkers.hh"
+#include "ParallelStylesheetIter.hh"
+#include "util/ThreadPool.hh"
+
+namespace {
+    // Number of entries that can be in flight per worker thread.
+    size_t const WINDOW_PER_THREAD = 4;
+
+    // State that is shared between the consumer and the workers.
+    struct Results
+    {
+        Results(alpinocorpus::Stylesheet const &newStylesheet,
+                alpinocorpus::CompiledMarkersPtr newMarkers) :
+            stylesheet(newStylesheet), markers(newMarkers),
+            interrupted(false), cancelled(false) {}
+
+        // Read-only after construction.
+        alpinocorpus::Stylesheet const stylesheet;
+        alpinocorpus::CompiledMarkersPtr markers;
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::map<size_t, alpinocorpus::Entry> done;
+        std::exception_ptr error;
+        bool interrupted;
+        bool cancelled;
+    };
+
+    void transformEntry(std::shared_ptr<Results> results, size_t seq,
+        std::shared_ptr<alpinocorpus::Entry> entry)
+    {
+        {
+            std::lock_guard<std::mutex> lock(results->mutex);
+            if (results->cancelled)
+                return;
+        }
+
+        try {
+            if (results->markers)
+                entry->contents = results->markers->transform(
+                    results->stylesheet, entry->contents);
+            else
+                entry->contents = results->stylesheet.transform(entry->contents);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(results->mutex);
+            if (!results->error)
+                results->error = std::current_exception();
+            results->cond.notify_all();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(results->mutex);
+        results->done.insert(std::make_pair(seq, std::move(*entry)));
+        results->cond.notify_all();
+    }
+}
+
+namespace alpinocorpus {
+
+    struct ParallelStylesheetIter::Pipeline
+    {
+        Pipeline(CorpusReader const &newCorpus,
+                CorpusReader::EntryIterator newItr,
+                Stylesheet const &stylesheet,
+                std::list<CorpusReader::MarkerQuery> const &newMarkerQueries,
+                size_t nThreads) :
+            corpus(newCorpus), itr(newItr), markerQueries(newMarkerQueries),
+            submitted(0), consumed(0), exhausted(false),
+            pool(new util::ThreadPool(nThreads))
+        {
+            window = pool->size() * WINDOW_PER_THREAD;
+
+            // Marking is done by the workers when the marker queries can
+            // be evaluated on the tree that is transformed.
+            CompiledMarkersPtr markers;
+            if (!markerQueries.empty())
+                markers = CompiledMarkers::compile(markerQueries);
+            results.reset(new Results(stylesheet, markers));
+        }
+
+        ~Pipeline()
+        {
+            std::lock_guard<std::mutex> lock(results->mutex);
+            results->cancelled = true;
+        }
+
+        void fill();
+        bool ready() const;
+
+        CorpusReader const &corpus;
+        CorpusReader::EntryIterator itr;
+        std::list<CorpusReader::MarkerQuery> markerQueries;
+        size_t window;
+
+        // Consumer-side bookkeeping.
+        size_t submitted;
+        size_t consumed;
+        bool exhausted;
+        std::unique_ptr<Entry> current;
+
+        // Entries that repeat the preceding entry (e.g. an entry with
+        // multiple matches) are not transformed again, they get the
+        // result of the last consumed entry.
+        std::string lastQueued;
+        std::set<size_t> repeated;
+        Entry last;
+
+        std::shared_ptr<Results> results;
+
+        // Destroyed first, so that the workers are joined before the
+        // remainder of the pipeline is torn down.
+        std::unique_ptr<util::ThreadPool> pool;
+    };
+
+    void ParallelStylesheetIter::Pipeline::fill()
+    {
+        std::vector<Entry> entries;
+        std::vector<size_t> seqs;
+        while (!exhausted && submitted - consumed < window)
+        {
+            if (!itr.hasNext())
+            {
+                exhausted = true;
+                break;
+            }
+
+            Entry entry(itr.next(corpus));
+            size_t seq = submitted++;
+            if (entry.name == lastQueued)
+            {
+                repeated.insert(seq);
+                continue;
+            }
+
+            lastQueued = entry.name;
+            entries.push_back(std::move(entry));
+            seqs.push_back(seq);
+        }
+
+        if (entries.empty())
+            return;
+
+        // Read the entries in this thread as a batch, so that the reader
+        // can read them in the order of its data. If the iterator returns
+        // the contents of entries, they are used unless markers have to
+        // be added by the reader.
+        bool markInPlace = markerQueries.empty() || results->markers;
+        if (markInPlace && !itr.hasContents())
+        {
+            std::vector<std::string> names;
+            for (std::vector<Entry>::const_iterator iter = entries.begin();
+                    iter != entries.end(); ++iter)
+                names.push_back(iter->name);
+
+            std::vector<std::string> contents(corpus.readMany(names));
+            for (size_t i = 0; i < entries.size(); ++i)
+                entries[i].contents.swap(contents[i]);
+        }
+        else if (!markInPlace)
+            for (std::vector<Entry>::iterator iter = entries.begin();
+                    iter != entries.end(); ++iter)
+                iter->contents = corpus.read(iter->name, markerQueries);
+
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            std::shared_ptr<Results> sharedResults(results);
+            std::shared_ptr<Entry> entry(new Entry);
+            std::swap(*entry, entries[i]);
+            size_t seq = seqs[i];
+
+            pool->post([sharedResults, seq, entry]() {
+                transformEntry(sharedResults, seq, entry);
+            });
+        }
+    }
+
+    // Should be called with results->mutex held.
+    bool ParallelStylesheetIter::Pipeline::ready() const
+    {
+        if (results->interrupted || results->error)
+            return true;
+
+        if (exhausted && consumed == submitted)
+            return true;
+
+        return repeated.find(consumed) != repeated.end() ||
+            results->done.find(consumed) != results->done.end();
+    }
+
+    ParallelStylesheetIter::ParallelStylesheetIter(CorpusReader const &corpus,
+        CorpusReader::EntryIterator iter,
+        Stylesheet const &stylesheet,
+        std::list<CorpusReader::MarkerQuery> const &markerQueries,
+        size_t nThreads) :
+        d_pipeline(new Pipeline(corpus, iter, stylesheet, markerQueries,
+            nThreads))
+    {
+    }
+
+    IterImpl *ParallelStylesheetIter::copy() const
+    {
+        return new ParallelStylesheetIter(*this);
+    }
+
+    bool ParallelStylesheetIter::hasNext()
+    {
+        Pipeline &p = *d_pipeline;
+
+        {
+            std::lock_guard<std::mutex> lock(p.results->mutex);
+            p.results->interrupted = false;
+        }
+
+        while (!p.current)
+        {
+            p.fill();
+
+            std::unique_lock<std::mutex> lock(p.results->mutex);
+            p.results->cond.wait(lock, [&p]() { return p.ready(); });
+
+            if (p.results->interrupted)
+                throw IterationInterrupted();
+
+            if (p.results->error)
+                std::rethrow_exception(p.results->error);
+
+            if (p.exhausted && p.consumed == p.submitted)
+                return false;
+
+            std::set<size_t>::iterator rep = p.repeated.find(p.consumed);
+            if (rep != p.repeated.end())
+            {
+                p.repeated.erase(rep);
+                p.current.reset(new Entry(p.last));
+            }
+            else
+            {
+                std::map<size_t, Entry>::iterator iter =
+                    p.results->done.find(p.consumed);
+                p.current.reset(new Entry);
+                std::swap(*p.current, iter->second);
+                p.results->done.erase(iter);
+                p.last = *p.current;
+            }
+            ++p.consumed;
+        }
+
+        return true;
+    }
+
+    bool ParallelStylesheetIter::hasProgress()
+    {
+        return d_pipeline->itr.hasProgress();
+    }
+
+    void ParallelStylesheetIter::interrupt()
+    {
+        d_pipeline->itr.interrupt();
+
+        std::lock_guard<std::mutex> lock(d_pipeline->results->mutex);
+        d_pipeline->results->interrupted = true;
+        d_pipeline->results->cond.notify_all();
+    }
+
+    Entry ParallelStylesheetIter::next(CorpusReader const &)
+    {
+        Pipeline &p = *d_pipeline;
+
+        if (!p.current)
+            throw Error("Calling next() on an iterator that is exhausted.");
+
+        Entry e;
+        std::swap(e, *p.current);
+        p.current.reset();
+
+        return e;
+    }
+
+    double ParallelStylesheetIter::progress()
+    {
+        return d_pipeline->itr.progress();
+    }
+
+}
@@ -0,0 +1,49 @@
+#ifndef ALPINOCORPUS_PARALLELSTYLESHEETITER_HH
+#define ALPINOCORPUS_PARALLELSTYLESHEETITER_HH
+
+#include <cstddef>
+#include <list>
+#include <memory>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Entry.hh>
+#include <AlpinoCorpus/IterImpl.hh>
+
+namespace alpinocorpus {
+    class Stylesheet;
+
+    /**
+     * Stylesheet iterator that applies the stylesheet on a pool of worker
+     * threads. The compiled stylesheet is shared by the workers, each
+     * transformation uses its own transformation context.
+     *
+     * Entries are read by the consuming thread, since not all readers
+     * can be used from multiple threads. Results are returned in the
+     * order of the wrapped iterator. Like StylesheetIter, consecutive
+     * entries with the same name are read and transformed once.
+     */
+    class ParallelStylesheetIter : public IterImpl {
+      public:
+        ParallelStylesheetIter(CorpusReader const &corpus,
+            CorpusReader::EntryIterator iter,
+            Stylesheet const &stylesheet,
+            std::list<CorpusReader::MarkerQuery> const &markerQueries,
+            size_t nThreads);
+        IterImpl *copy() const;
+        bool hasNext();
+        bool hasProgress();
+        Entry next(CorpusReader const &rdr);
+        double progress();
+
+      protected:
+        void interrupt();
+
+      private:
+        struct Pipeline;
+
+        // The worker threads cannot be copied, copies share the pipeline.
+        std::shared_ptr<Pipeline> d_pipeline;
+    };
+}
+
+#endif // ALPINOCORPUS_PARALLELSTYLESHEETITER_HH
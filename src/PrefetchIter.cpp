@@ -0,0 +1,228 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Entry.hh>
+#include <AlpinoCorpus/Error.hh>
+
+#include "PrefetchIter.hh"
+
+namespace {
+    // Limits that readers use, prefetching is disabled by default.
+    std::atomic<size_t> s_depth(0);
+    std::atomic<size_t> s_maxMemory(64 * 1024 * 1024);
+}
+
+namespace alpinocorpus {
+
+    struct PrefetchIter::Pipeline
+    {
+        Pipeline(CorpusReader const &newCorpus,
+                CorpusReader::EntryIterator newItr,
+                size_t newDepth, size_t newMaxMemory) :
+            corpus(newCorpus), itr(newItr),
+            depth(newDepth == 0 ? 1 : newDepth), maxMemory(newMaxMemory),
+            itrHasProgress(itr.hasProgress()), bufferSize(0),
+            exhausted(false), interrupted(false), stopping(false)
+        {
+            thread = std::thread(&Pipeline::run, this);
+        }
+
+        ~Pipeline()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                cond.notify_all();
+            }
+
+            // The background thread may be blocked in the wrapped iterator.
+            // Iterators can be interrupted while another thread is in
+            // hasNext() or next(), so itrMutex must not be held here.
+            itr.interrupt();
+            thread.join();
+        }
+
+        void run();
+        bool full() const;
+
+        CorpusReader const &corpus;
+        CorpusReader::EntryIterator itr;
+        size_t depth;
+        size_t maxMemory;
+        bool itrHasProgress;
+
+        // Protects itr, which is advanced by the background thread.
+        std::mutex itrMutex;
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<Entry> buffer;
+        size_t bufferSize;
+        bool exhausted;
+        bool interrupted;
+        bool stopping;
+        std::exception_ptr error;
+
+        std::thread thread;
+    };
+
+    // Should be called with mutex held. A single entry is always
+    // accepted, even if it is larger than the memory limit.
+    bool PrefetchIter::Pipeline::full() const
+    {
+        return buffer.size() >= depth ||
+            (!buffer.empty() && bufferSize >= maxMemory);
+    }
+
+    void PrefetchIter::Pipeline::run()
+    {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this]() { return stopping || !full(); });
+                if (stopping)
+                    return;
+            }
+
+            Entry e;
+            bool done = false;
+            try {
+                bool hasContents = false;
+                {
+                    std::lock_guard<std::mutex> itrLock(itrMutex);
+                    done = !itr.hasNext();
+                    if (!done)
+                    {
+                        e = itr.next(corpus);
+                        hasContents = itr.hasContents();
+                    }
+                }
+
+                if (!done && !hasContents)
+                    e.contents = corpus.read(e.name);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+                cond.notify_all();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done)
+                exhausted = true;
+            else
+            {
+                bufferSize += e.contents.size();
+                buffer.push_back(std::move(e));
+            }
+            cond.notify_all();
+
+            if (done)
+                return;
+        }
+    }
+
+    PrefetchIter::PrefetchIter(CorpusReader const &corpus,
+        CorpusReader::EntryIterator itr,
+        size_t depth, size_t maxMemory) :
+        d_pipeline(new Pipeline(corpus, itr, depth, maxMemory))
+    {
+    }
+
+    IterImpl *PrefetchIter::copy() const
+    {
+        return new PrefetchIter(*this);
+    }
+
+    bool PrefetchIter::hasContents()
+    {
+        return true;
+    }
+
+    bool PrefetchIter::hasNext()
+    {
+        Pipeline &p = *d_pipeline;
+
+        std::unique_lock<std::mutex> lock(p.mutex);
+        p.interrupted = false;
+
+        p.cond.wait(lock, [&p]() {
+            return !p.buffer.empty() || p.exhausted || p.error ||
+                p.interrupted;
+        });
+
+        if (p.interrupted)
+            throw IterationInterrupted();
+
+        if (!p.buffer.empty())
+            return true;
+
+        if (p.error)
+            std::rethrow_exception(p.error);
+
+        return false;
+    }
+
+    bool PrefetchIter::hasProgress()
+    {
+        return d_pipeline->itrHasProgress;
+    }
+
+    void PrefetchIter::interrupt()
+    {
+        std::lock_guard<std::mutex> lock(d_pipeline->mutex);
+        d_pipeline->interrupted = true;
+        d_pipeline->cond.notify_all();
+    }
+
+    Entry PrefetchIter::next(CorpusReader const &)
+    {
+        if (!hasNext())
+            throw Error("Calling next() on an iterator that is exhausted.");
+
+        Pipeline &p = *d_pipeline;
+
+        std::lock_guard<std::mutex> lock(p.mutex);
+
+        Entry e(std::move(p.buffer.front()));
+        p.buffer.pop_front();
+        p.bufferSize -= e.contents.size();
+        p.cond.notify_all();
+
+        return e;
+    }
+
+    double PrefetchIter::progress()
+    {
+        // Progress is that of the background thread, which is ahead.
+        std::lock_guard<std::mutex> lock(d_pipeline->itrMutex);
+        return d_pipeline->itr.progress();
+    }
+
+    void PrefetchIter::setDefaultLimits(size_t depth, size_t maxMemory)
+    {
+        s_depth = depth;
+        s_maxMemory = maxMemory;
+    }
+
+    CorpusReader::EntryIterator PrefetchIter::wrap(CorpusReader const &corpus,
+        CorpusReader::EntryIterator itr)
+    {
+        size_t depth = s_depth;
+        if (depth == 0)
+            return itr;
+
+        return CorpusReader::EntryIterator(new PrefetchIter(corpus, itr,
+            depth, s_maxMemory));
+    }
+
+}
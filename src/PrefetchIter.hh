@@ -0,0 +1,61 @@
+#ifndef ALPINOCORPUS_PREFETCHITER_HH
+#define ALPINOCORPUS_PREFETCHITER_HH
+
+#include <cstddef>
+#include <memory>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Entry.hh>
+#include <AlpinoCorpus/IterImpl.hh>
+
+namespace alpinocorpus {
+    /**
+     * Iterator that reads entries ahead on a background thread, so that
+     * reading and decompression overlap with the processing of the
+     * current entry. Entries are returned with their contents.
+     *
+     * At most <i>depth</i> entries are read ahead, and no further entries
+     * are read while the entries that were read ahead take
+     * <i>maxMemory</i> bytes or more.
+     *
+     * The wrapped iterator should iterate over entries, not over query
+     * matches, since the contents of entries replace the matches.
+     */
+    class PrefetchIter : public IterImpl {
+      public:
+        PrefetchIter(CorpusReader const &corpus,
+            CorpusReader::EntryIterator i,
+            size_t depth, size_t maxMemory);
+        IterImpl *copy() const;
+        bool hasContents();
+        bool hasNext();
+        bool hasProgress();
+        Entry next(CorpusReader const &rdr);
+        double progress();
+
+        /**
+         * Set the limits that readers use for the iterators that they
+         * prefetch. A depth of 0 disables prefetching.
+         */
+        static void setDefaultLimits(size_t depth, size_t maxMemory);
+
+        /**
+         * Wrap an iterator in a prefetch iterator, using the default
+         * limits. Returns the iterator itself if prefetching is disabled.
+         */
+        static CorpusReader::EntryIterator wrap(CorpusReader const &corpus,
+            CorpusReader::EntryIterator i);
+
+      protected:
+        void interrupt();
+
+      private:
+        struct Pipeline;
+
+        // The background thread cannot be copied. Copies share the
+        // pipeline, like copies of the parallel iterators.
+        std::shared_ptr<Pipeline> d_pipeline;
+    };
+}
+
+#endif // ALPINOCORPUS_PREFETCHITER_HH
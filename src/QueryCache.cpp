@@ -0,0 +1,100 @@
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+
+#include "QueryCache.hh"
+
+namespace {
+    size_t const DEFAULT_CAPACITY = 256;
+}
+
+namespace alpinocorpus {
+
+QueryCache::QueryCache() :
+    d_capacity(DEFAULT_CAPACITY), d_hits(0), d_misses(0)
+{
+}
+
+QueryCache &QueryCache::instance()
+{
+    static QueryCache cache;
+    return cache;
+}
+
+QueryCache::QueryPtr QueryCache::get(CorpusReader::QueryDialect dialect,
+    std::string const &query, Compiler const &compiler)
+{
+    Key key(dialect, query);
+
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+
+        std::map<Key, LruList::iterator>::iterator iter = d_index.find(key);
+        if (iter != d_index.end())
+        {
+            ++d_hits;
+            d_lru.splice(d_lru.begin(), d_lru, iter->second);
+            return iter->second->second;
+        }
+
+        ++d_misses;
+    }
+
+    // Compile without holding the lock, so that threads that use other
+    // queries are not blocked.
+    QueryPtr compiled(compiler(query));
+
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    // Another thread could have compiled the same query in the meanwhile.
+    std::map<Key, LruList::iterator>::iterator iter = d_index.find(key);
+    if (iter != d_index.end())
+        return iter->second->second;
+
+    if (d_capacity == 0)
+        return compiled;
+
+    d_lru.push_front(LruList::value_type(key, compiled));
+    d_index[key] = d_lru.begin();
+
+    evict();
+
+    return compiled;
+}
+
+void QueryCache::evict()
+{
+    while (d_lru.size() > d_capacity)
+    {
+        d_index.erase(d_lru.back().first);
+        d_lru.pop_back();
+    }
+}
+
+void QueryCache::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    d_capacity = capacity;
+    evict();
+}
+
+CorpusReader::QueryCacheStats QueryCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    CorpusReader::QueryCacheStats stats = {d_hits, d_misses, d_lru.size(),
+        d_capacity};
+    return stats;
+}
+
+void QueryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    d_lru.clear();
+    d_index.clear();
+    d_hits = 0;
+    d_misses = 0;
+}
+
+}
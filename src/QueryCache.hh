@@ -0,0 +1,65 @@
+#ifndef ALPINOCORPUS_QUERYCACHE_HH
+#define ALPINOCORPUS_QUERYCACHE_HH
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <AlpinoCorpus/CorpusReader.hh>
+
+class XQQuery;
+
+namespace alpinocorpus {
+
+/**
+ * Process-wide LRU cache of compiled queries, keyed by dialect and query
+ * text. Compiled queries are immutable and can be evaluated from multiple
+ * threads, so they are shared between all iterators that use them.
+ */
+class QueryCache
+{
+public:
+    typedef std::shared_ptr<XQQuery> QueryPtr;
+    typedef std::function<QueryPtr(std::string const &)> Compiler;
+
+    static QueryCache &instance();
+
+    /**
+     * Get a compiled query. If the query is not in the cache, it is
+     * compiled using <i>compiler</i>. Compilation errors are not cached.
+     */
+    QueryPtr get(CorpusReader::QueryDialect dialect, std::string const &query,
+        Compiler const &compiler);
+
+    /** Set the maximum number of queries, 0 disables the cache. */
+    void setCapacity(size_t capacity);
+
+    CorpusReader::QueryCacheStats stats() const;
+    void clear();
+
+private:
+    typedef std::pair<CorpusReader::QueryDialect, std::string> Key;
+    typedef std::list<std::pair<Key, QueryPtr> > LruList;
+
+    QueryCache();
+    QueryCache(QueryCache const &) = delete;
+    QueryCache &operator=(QueryCache const &) = delete;
+
+    void evict();
+
+    mutable std::mutex d_mutex;
+    LruList d_lru;
+    std::map<Key, LruList::iterator> d_index;
+    size_t d_capacity;
+    size_t d_hits;
+    size_t d_misses;
+};
+
+}
+
+#endif // ALPINOCORPUS_QUERYCACHE_HH
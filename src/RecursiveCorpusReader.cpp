@@ -1,5 +1,6 @@
 #include <list>
 #include <string>
+#include <vector>
 
 #include <memory>
 #include <boost/filesystem.hpp>
@@ -24,8 +25,15 @@ public:
   std::string getName() const;
   size_t getSize() const;
   std::string readEntry(std::string const &) const;
+  std::vector<Token> getTokens(std::string const &entry,
+      std::vector<std::string> const &attributes,
+      std::string const &defaultValue, CorpusInfo const &corpusInfo) const;
+  DataView readEntryView(std::string const &) const;
+  std::vector<std::string> readEntries(std::vector<std::string> const &) const;
   std::string readEntryMarkQueries(std::string const &entry, std::list<MarkerQuery> const &queries) const;
   EntryIterator runXPath(std::string const &query) const;
+  EntryIterator runParallelXPath(std::string const &query, size_t nThreads,
+      bool preserveOrder, SortOrder sortOrder) const;
   EntryIterator runXQuery(std::string const &, SortOrder sortOrder) const;
   Either<std::string, Empty> validQuery(QueryDialect d, bool variables, std::string const &query) const;
 
@@ -72,6 +80,24 @@ std::string RecursiveCorpusReader::readEntry(std::string const &entry) const
   return d_private->readEntry(entry);
 }
 
+std::vector<Token> RecursiveCorpusReader::getTokens(std::string const &entry,
+    std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+{
+  return d_private->getTokens(entry, attributes, defaultValue, corpusInfo);
+}
+
+DataView RecursiveCorpusReader::readEntryView(std::string const &entry) const
+{
+  return d_private->readEntryView(entry);
+}
+
+std::vector<std::string> RecursiveCorpusReader::readEntries(
+    std::vector<std::string> const &entries) const
+{
+  return d_private->readEntries(entries);
+}
+
 std::string RecursiveCorpusReader::readEntryMarkQueries(std::string const &entry,
     std::list<MarkerQuery> const &queries) const
 {
@@ -83,6 +109,13 @@ CorpusReader::EntryIterator RecursiveCorpusReader::runXPath(std::string const &q
   return d_private->query(XPATH, query);
 }
 
+CorpusReader::EntryIterator RecursiveCorpusReader::runParallelXPath(
+    std::string const &query, size_t nThreads, bool preserveOrder,
+    SortOrder sortOrder) const
+{
+  return d_private->parallelQuery(query, nThreads, preserveOrder, sortOrder);
+}
+
 CorpusReader::EntryIterator RecursiveCorpusReader::runXQuery(std::string const &query, SortOrder sortOrder) const
 {
   return d_private->query(XQUERY, query, sortOrder);
@@ -145,6 +178,25 @@ std::string RecursiveCorpusReaderPrivate::readEntry(std::string const &path) con
   return d_multiReader->read(path);
 }
 
+std::vector<Token> RecursiveCorpusReaderPrivate::getTokens(
+    std::string const &path, std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo) const
+{
+  return d_multiReader->tokens(path, attributes, defaultValue, corpusInfo);
+}
+
+DataView RecursiveCorpusReaderPrivate::readEntryView(
+    std::string const &path) const
+{
+  return d_multiReader->readView(path);
+}
+
+std::vector<std::string> RecursiveCorpusReaderPrivate::readEntries(
+    std::vector<std::string> const &entries) const
+{
+  return d_multiReader->readMany(entries);
+}
+
 std::string RecursiveCorpusReaderPrivate::readEntryMarkQueries(
     std::string const &path, std::list<MarkerQuery> const &queries) const
 {
@@ -157,6 +209,14 @@ CorpusReader::EntryIterator RecursiveCorpusReaderPrivate::runXPath(
   return d_multiReader->query(CorpusReader::XPATH, query);
 }
 
+CorpusReader::EntryIterator RecursiveCorpusReaderPrivate::runParallelXPath(
+    std::string const &query, size_t nThreads, bool preserveOrder,
+    SortOrder sortOrder) const
+{
+  return d_multiReader->parallelQuery(query, nThreads, preserveOrder,
+      sortOrder);
+}
+
 CorpusReader::EntryIterator RecursiveCorpusReaderPrivate::runXQuery(
     std::string const &query, SortOrder sortOrder) const
 {
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <AlpinoCorpus/LexItem.hh>
+#include <AlpinoCorpus/Sentence.hh>
+
+namespace alpinocorpus {
+
+void Sentence::push_back(char const *word, size_t wordSize, size_t begin,
+    size_t const *matches, size_t nMatches)
+{
+    Item item = {begin, d_words.size(), wordSize, d_matches.size(), nMatches};
+    d_items.push_back(item);
+
+    d_words.append(word, wordSize);
+
+    d_matches.insert(d_matches.end(), matches, matches + nMatches);
+    std::sort(d_matches.begin() + item.matchesOffset, d_matches.end());
+}
+
+void Sentence::reserve(size_t items, size_t wordBytes)
+{
+    d_items.reserve(items);
+    d_words.reserve(wordBytes);
+}
+
+void Sentence::sort()
+{
+    std::string const &words = d_words;
+    std::stable_sort(d_items.begin(), d_items.end(),
+        [&words](Item const &a, Item const &b) {
+            if (a.begin != b.begin)
+                return a.begin < b.begin;
+
+            int r = std::memcmp(words.data() + a.wordOffset,
+                words.data() + b.wordOffset, std::min(a.wordSize, b.wordSize));
+            return r < 0 || (r == 0 && a.wordSize < b.wordSize);
+        });
+}
+
+std::vector<LexItem> Sentence::lexItems() const
+{
+    std::vector<LexItem> items;
+    items.reserve(d_items.size());
+
+    for (size_t i = 0; i < d_items.size(); ++i)
+    {
+        LexItem item = {word(i), begin(i),
+            std::set<size_t>(matchesBegin(i), matchesEnd(i))};
+        items.push_back(item);
+    }
+
+    return items;
+}
+
+}
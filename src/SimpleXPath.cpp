@@ -0,0 +1,467 @@
+#include <cctype>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SimpleXPath.hh"
+
+namespace {
+
+using alpinocorpus::SimpleXPathExpr;
+using alpinocorpus::SimpleXPathExprPtr;
+using alpinocorpus::SimpleXPathStep;
+
+// Thrown when a query is not in the supported subset.
+struct Unsupported {};
+
+struct Token
+{
+    enum Kind { End, Slash, DoubleSlash, LBracket, RBracket, LParen, RParen,
+        At, Star, Dot, DotDot, Eq, NotEq, Comma, String, Number, Name };
+
+    Token(Kind newKind, std::string const &newText = std::string()) :
+        kind(newKind), text(newText) {}
+
+    Kind kind;
+    std::string text;
+};
+
+bool isNameStart(char c)
+{
+    unsigned char uc = static_cast<unsigned char>(c);
+    return std::isalpha(uc) || c == '_' || uc >= 0x80;
+}
+
+bool isNameChar(char c)
+{
+    unsigned char uc = static_cast<unsigned char>(c);
+    return isNameStart(c) || std::isdigit(uc) || c == '-' || c == '.';
+}
+
+std::vector<Token> tokenize(std::string const &query)
+{
+    std::vector<Token> tokens;
+
+    size_t i = 0;
+    while (i < query.size())
+    {
+        char c = query[i];
+
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            ++i;
+            continue;
+        }
+
+        char next = i + 1 < query.size() ? query[i + 1] : '\0';
+
+        if (c == '/' && next == '/')
+        {
+            tokens.push_back(Token(Token::DoubleSlash));
+            i += 2;
+        }
+        else if (c == '/')
+        {
+            tokens.push_back(Token(Token::Slash));
+            ++i;
+        }
+        else if (c == '[')
+        {
+            tokens.push_back(Token(Token::LBracket));
+            ++i;
+        }
+        else if (c == ']')
+        {
+            tokens.push_back(Token(Token::RBracket));
+            ++i;
+        }
+        else if (c == '(')
+        {
+            tokens.push_back(Token(Token::LParen));
+            ++i;
+        }
+        else if (c == ')')
+        {
+            tokens.push_back(Token(Token::RParen));
+            ++i;
+        }
+        else if (c == '@')
+        {
+            tokens.push_back(Token(Token::At));
+            ++i;
+        }
+        else if (c == '*')
+        {
+            tokens.push_back(Token(Token::Star));
+            ++i;
+        }
+        else if (c == ',')
+        {
+            tokens.push_back(Token(Token::Comma));
+            ++i;
+        }
+        else if (c == '=')
+        {
+            tokens.push_back(Token(Token::Eq));
+            ++i;
+        }
+        else if (c == '!' && next == '=')
+        {
+            tokens.push_back(Token(Token::NotEq));
+            i += 2;
+        }
+        else if (c == '.' && next == '.')
+        {
+            tokens.push_back(Token(Token::DotDot));
+            i += 2;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)) ||
+            (c == '.' && std::isdigit(static_cast<unsigned char>(next))))
+        {
+            size_t start = i;
+            bool dot = false;
+            while (i < query.size() &&
+                    (std::isdigit(static_cast<unsigned char>(query[i])) ||
+                     query[i] == '.'))
+            {
+                // Malformed numbers such as 1.2.3 are not supported.
+                if (query[i] == '.' && dot)
+                    throw Unsupported();
+
+                dot = dot || query[i] == '.';
+                ++i;
+            }
+
+            // Neither are exponents (1e5) or numbers that run into a name.
+            if (i < query.size() && isNameChar(query[i]))
+                throw Unsupported();
+
+            tokens.push_back(Token(Token::Number, query.substr(start, i - start)));
+        }
+        else if (c == '.')
+        {
+            tokens.push_back(Token(Token::Dot));
+            ++i;
+        }
+        else if (c == '\'' || c == '"')
+        {
+            size_t end = query.find(c, i + 1);
+            if (end == std::string::npos)
+                throw Unsupported();
+
+            tokens.push_back(Token(Token::String, query.substr(i + 1, end - i - 1)));
+            i = end + 1;
+
+            // XPath 2 escapes quotes by doubling them.
+            if (i < query.size() && query[i] == c)
+                throw Unsupported();
+        }
+        else if (isNameStart(c))
+        {
+            size_t start = i;
+            while (i < query.size() && isNameChar(query[i]))
+                ++i;
+            tokens.push_back(Token(Token::Name, query.substr(start, i - start)));
+        }
+        else
+            // Operators, axes, variables, etc. are not supported.
+            throw Unsupported();
+    }
+
+    tokens.push_back(Token(Token::End));
+
+    return tokens;
+}
+
+class Parser
+{
+public:
+    Parser(std::vector<Token> const &tokens) : d_tokens(tokens), d_pos(0) {}
+
+    SimpleXPathExprPtr parse();
+
+private:
+    // An operand of a comparison: an expression or a literal sequence.
+    struct Operand
+    {
+        Operand() : numeric(false) {}
+
+        SimpleXPathExprPtr expr;
+        std::vector<std::string> literals;
+        bool numeric;
+    };
+
+    Token const &peek(size_t n = 0) const;
+    void expect(Token::Kind kind);
+    bool isKeyword(std::string const &keyword) const;
+
+    SimpleXPathExprPtr parseOr();
+    SimpleXPathExprPtr parseAnd();
+    SimpleXPathExprPtr parseComparison();
+    Operand parsePrimary();
+    void parseLiterals(Operand *operand);
+    SimpleXPathExprPtr parsePath();
+    SimpleXPathStep parseStep(bool descendant);
+
+    std::vector<Token> const &d_tokens;
+    size_t d_pos;
+};
+
+Token const &Parser::peek(size_t n) const
+{
+    size_t pos = d_pos + n;
+    if (pos >= d_tokens.size())
+        return d_tokens.back();
+
+    return d_tokens[pos];
+}
+
+void Parser::expect(Token::Kind kind)
+{
+    if (peek().kind != kind)
+        throw Unsupported();
+
+    ++d_pos;
+}
+
+bool Parser::isKeyword(std::string const &keyword) const
+{
+    return peek().kind == Token::Name && peek().text == keyword;
+}
+
+SimpleXPathExprPtr Parser::parse()
+{
+    SimpleXPathExprPtr expr = parseOr();
+    expect(Token::End);
+    return expr;
+}
+
+SimpleXPathExprPtr Parser::parseOr()
+{
+    SimpleXPathExprPtr first = parseAnd();
+    if (!isKeyword("or"))
+        return first;
+
+    std::shared_ptr<SimpleXPathExpr> expr(new SimpleXPathExpr(SimpleXPathExpr::Or));
+    expr->operands.push_back(first);
+
+    while (isKeyword("or"))
+    {
+        ++d_pos;
+        expr->operands.push_back(parseAnd());
+    }
+
+    return expr;
+}
+
+SimpleXPathExprPtr Parser::parseAnd()
+{
+    SimpleXPathExprPtr first = parseComparison();
+    if (!isKeyword("and"))
+        return first;
+
+    std::shared_ptr<SimpleXPathExpr> expr(new SimpleXPathExpr(SimpleXPathExpr::And));
+    expr->operands.push_back(first);
+
+    while (isKeyword("and"))
+    {
+        ++d_pos;
+        expr->operands.push_back(parseComparison());
+    }
+
+    return expr;
+}
+
+SimpleXPathExprPtr Parser::parseComparison()
+{
+    Operand lhs = parsePrimary();
+
+    if (peek().kind != Token::Eq && peek().kind != Token::NotEq)
+    {
+        // Bare literals (e.g. positional predicates) are not supported.
+        if (!lhs.expr)
+            throw Unsupported();
+
+        return lhs.expr;
+    }
+
+    SimpleXPathExpr::Type type = peek().kind == Token::Eq ?
+        SimpleXPathExpr::Equals : SimpleXPathExpr::NotEquals;
+    ++d_pos;
+
+    Operand rhs = parsePrimary();
+
+    // We only support comparisons of a path with literals.
+    Operand *path = lhs.expr ? &lhs : &rhs;
+    Operand *literals = lhs.expr ? &rhs : &lhs;
+    if (!path->expr || path->expr->type != SimpleXPathExpr::Path ||
+            literals->expr)
+        throw Unsupported();
+
+    std::shared_ptr<SimpleXPathExpr> expr(new SimpleXPathExpr(type));
+    expr->operands.push_back(path->expr);
+    expr->literals = literals->literals;
+    expr->numeric = literals->numeric;
+
+    return expr;
+}
+
+Parser::Operand Parser::parsePrimary()
+{
+    Operand operand;
+
+    Token const &token = peek();
+
+    if (token.kind == Token::String || token.kind == Token::Number)
+        parseLiterals(&operand);
+    else if (token.kind == Token::LParen)
+    {
+        Token::Kind next = peek(1).kind;
+        if (next == Token::String || next == Token::Number)
+        {
+            // Sequence of literals, e.g. ('a','b').
+            ++d_pos;
+            parseLiterals(&operand);
+            while (peek().kind == Token::Comma)
+            {
+                ++d_pos;
+                parseLiterals(&operand);
+            }
+            expect(Token::RParen);
+        }
+        else
+        {
+            ++d_pos;
+            operand.expr = parseOr();
+            expect(Token::RParen);
+        }
+    }
+    else if (isKeyword("not") && peek(1).kind == Token::LParen)
+    {
+        d_pos += 2;
+        std::shared_ptr<SimpleXPathExpr> expr(new SimpleXPathExpr(SimpleXPathExpr::Not));
+        expr->operands.push_back(parseOr());
+        expect(Token::RParen);
+        operand.expr = expr;
+    }
+    else
+        operand.expr = parsePath();
+
+    return operand;
+}
+
+void Parser::parseLiterals(Operand *operand)
+{
+    Token const &token = peek();
+
+    bool numeric = token.kind == Token::Number;
+    if (!operand->literals.empty() && numeric != operand->numeric)
+        throw Unsupported();
+
+    if (token.kind != Token::String && token.kind != Token::Number)
+        throw Unsupported();
+
+    operand->literals.push_back(token.text);
+    operand->numeric = numeric;
+    ++d_pos;
+}
+
+SimpleXPathExprPtr Parser::parsePath()
+{
+    std::shared_ptr<SimpleXPathExpr> expr(new SimpleXPathExpr(SimpleXPathExpr::Path));
+
+    bool descendant = false;
+    if (peek().kind == Token::Slash || peek().kind == Token::DoubleSlash)
+    {
+        expr->absolute = true;
+        descendant = peek().kind == Token::DoubleSlash;
+        ++d_pos;
+    }
+
+    while (true)
+    {
+        expr->steps.push_back(parseStep(descendant));
+
+        if (peek().kind == Token::Slash)
+            descendant = false;
+        else if (peek().kind == Token::DoubleSlash)
+            descendant = true;
+        else
+            break;
+
+        ++d_pos;
+    }
+
+    return expr;
+}
+
+SimpleXPathStep Parser::parseStep(bool descendant)
+{
+    SimpleXPathStep step;
+    step.descendant = descendant;
+
+    Token const &token = peek();
+
+    if (token.kind == Token::Dot)
+    {
+        step.axis = SimpleXPathStep::Self;
+        step.name = "*";
+        ++d_pos;
+    }
+    else if (token.kind == Token::DotDot)
+    {
+        step.axis = SimpleXPathStep::Parent;
+        step.name = "*";
+        ++d_pos;
+    }
+    else
+    {
+        if (token.kind == Token::At)
+        {
+            step.axis = SimpleXPathStep::Attribute;
+            ++d_pos;
+        }
+
+        Token const &nameToken = peek();
+        if (nameToken.kind == Token::Star)
+            step.name = "*";
+        else if (nameToken.kind == Token::Name)
+        {
+            // Function calls are not supported.
+            if (peek(1).kind == Token::LParen)
+                throw Unsupported();
+
+            step.name = nameToken.text;
+        }
+        else
+            throw Unsupported();
+
+        ++d_pos;
+    }
+
+    while (peek().kind == Token::LBracket)
+    {
+        ++d_pos;
+        step.predicates.push_back(parseOr());
+        expect(Token::RBracket);
+    }
+
+    return step;
+}
+
+}
+
+namespace alpinocorpus {
+
+SimpleXPathExprPtr parseSimpleXPath(std::string const &query)
+{
+    try {
+        std::vector<Token> tokens(tokenize(query));
+        Parser parser(tokens);
+        return parser.parse();
+    } catch (Unsupported const &) {
+        return SimpleXPathExprPtr();
+    }
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef ALPINOCORPUS_SIMPLEXPATH_HH
+#define ALPINOCORPUS_SIMPLEXPATH_HH
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace alpinocorpus {
+
+struct SimpleXPathExpr;
+typedef std::shared_ptr<SimpleXPathExpr const> SimpleXPathExprPtr;
+
+/**
+ * A location step of a simple XPath expression.
+ */
+struct SimpleXPathStep
+{
+    enum Axis { Child, Attribute, Self, Parent };
+
+    SimpleXPathStep() : axis(Child), descendant(false) {}
+
+    Axis axis;
+
+    /**
+     * The step was preceded by '//', so the axis is applied to the
+     * context node and all its descendants.
+     */
+    bool descendant;
+
+    /** Element or attribute name, "*" matches any name. */
+    std::string name;
+
+    std::vector<SimpleXPathExprPtr> predicates;
+};
+
+/**
+ * Expression in a small subset of XPath, that is sufficient for most
+ * treebank queries: location paths with the child, attribute, self, and
+ * parent axes (including '//'), name tests, predicates, comparisons of a
+ * path with literals, <tt>and</tt>, <tt>or</tt>, and <tt>not()</tt>.
+ */
+struct SimpleXPathExpr
+{
+    enum Type { Path, And, Or, Not, Equals, NotEquals };
+
+    SimpleXPathExpr(Type newType) :
+        type(newType), absolute(false), numeric(false) {}
+
+    Type type;
+
+    // Path
+    bool absolute;
+    std::vector<SimpleXPathStep> steps;
+
+    // And, Or, Not (one operand), Equals and NotEquals (the path that is
+    // compared).
+    std::vector<SimpleXPathExprPtr> operands;
+
+    // Equals, NotEquals: the path is compared with each of these literals.
+    std::vector<std::string> literals;
+    bool numeric;
+};
+
+/**
+ * Parse a query. Returns a null pointer if the query is not in the
+ * supported subset of XPath.
+ */
+SimpleXPathExprPtr parseSimpleXPath(std::string const &query);
+
+}
+
+#endif // ALPINOCORPUS_SIMPLEXPATH_HH
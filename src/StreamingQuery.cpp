@@ -0,0 +1,366 @@
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libxml/xmlreader.h>
+
+#include "SimpleXPath.hh"
+#include "StreamingQuery.hh"
+#include "util/LibXml.hh"
+
+namespace {
+    // Element steps are tracked in 64-bit masks.
+    size_t const MAX_ELEMENT_STEPS = 64;
+
+    // Names in a namespace are only matched by the wildcard, name tests
+    // of a query are unprefixed.
+    bool nameMatches(std::string const &test, xmlChar const *name,
+        bool inNamespace)
+    {
+        return test == "*" ||
+            (!inNamespace && test == reinterpret_cast<char const *>(name));
+    }
+
+    // Name under which an attribute is stored for predicates. Attributes
+    // in a namespace get their qualified name, which is never equal to
+    // an unprefixed name test.
+    xmlChar const *attributeName(xmlTextReaderPtr reader)
+    {
+        if (xmlTextReaderConstNamespaceUri(reader) != 0)
+            return xmlTextReaderConstName(reader);
+
+        return xmlTextReaderConstLocalName(reader);
+    }
+
+    // A result whose string value is being collected.
+    struct OpenResult
+    {
+        OpenResult(size_t newIndex, int newDepth) :
+            index(newIndex), depth(newDepth) {}
+
+        size_t index;
+        int depth;
+    };
+
+    // Matched element steps of an open element.
+    struct Frame
+    {
+        // Steps matched by this element.
+        uint64_t matched;
+
+        // Steps matched by this element or one of its ancestors.
+        uint64_t reach;
+    };
+}
+
+namespace alpinocorpus {
+
+StreamingQuery::StreamingQuery(SimpleXPathExprPtr expr) :
+    d_expr(expr), d_attributeStep(0)
+{
+}
+
+StreamingQueryPtr StreamingQuery::compile(std::string const &query)
+{
+    SimpleXPathExprPtr expr(parseSimpleXPath(query));
+    if (!expr || expr->type != SimpleXPathExpr::Path)
+        return StreamingQueryPtr();
+
+    std::shared_ptr<StreamingQuery> planned(new StreamingQuery(expr));
+
+    // The context of filter queries is the document node, so relative
+    // and absolute paths are equivalent.
+    for (std::vector<SimpleXPathStep>::const_iterator iter = expr->steps.begin();
+            iter != expr->steps.end(); ++iter)
+    {
+        if (planned->d_attributeStep)
+            return StreamingQueryPtr();
+
+        if (iter->axis == SimpleXPathStep::Attribute)
+        {
+            if (!iter->predicates.empty())
+                return StreamingQueryPtr();
+
+            planned->d_attributeStep = &*iter;
+            continue;
+        }
+
+        if (iter->axis != SimpleXPathStep::Child)
+            return StreamingQueryPtr();
+
+        for (std::vector<SimpleXPathExprPtr>::const_iterator predIter =
+                iter->predicates.begin(); predIter != iter->predicates.end();
+                ++predIter)
+            if (!supportedPredicate(**predIter))
+                return StreamingQueryPtr();
+
+        planned->d_elementSteps.push_back(&*iter);
+    }
+
+    if (planned->d_elementSteps.size() > MAX_ELEMENT_STEPS)
+        return StreamingQueryPtr();
+
+    return planned;
+}
+
+bool StreamingQuery::isAttributeTest(SimpleXPathExpr const &expr)
+{
+    return expr.type == SimpleXPathExpr::Path && !expr.absolute &&
+        expr.steps.size() == 1 &&
+        expr.steps[0].axis == SimpleXPathStep::Attribute &&
+        !expr.steps[0].descendant &&
+        expr.steps[0].predicates.empty();
+}
+
+bool StreamingQuery::supportedPredicate(SimpleXPathExpr const &expr)
+{
+    switch (expr.type)
+    {
+    case SimpleXPathExpr::Path:
+        return isAttributeTest(expr);
+    case SimpleXPathExpr::Equals:
+    case SimpleXPathExpr::NotEquals:
+        // Numeric comparisons cast attribute values to xs:double, with
+        // errors for values that are not numbers. Leave them to the
+        // query engine.
+        return !expr.numeric && isAttributeTest(*expr.operands[0]);
+    case SimpleXPathExpr::And:
+    case SimpleXPathExpr::Or:
+    case SimpleXPathExpr::Not:
+        for (std::vector<SimpleXPathExprPtr>::const_iterator iter =
+                expr.operands.begin(); iter != expr.operands.end(); ++iter)
+            if (!supportedPredicate(**iter))
+                return false;
+        return true;
+    }
+
+    return false;
+}
+
+bool StreamingQuery::evaluatePredicate(SimpleXPathExpr const &expr,
+    Attributes const &attributes)
+{
+    switch (expr.type)
+    {
+    case SimpleXPathExpr::Path:
+    {
+        std::string const &name = expr.steps[0].name;
+        for (Attributes::const_iterator iter = attributes.begin();
+                iter != attributes.end(); ++iter)
+            if (name == "*" || iter->first == name)
+                return true;
+        return false;
+    }
+    case SimpleXPathExpr::And:
+        for (std::vector<SimpleXPathExprPtr>::const_iterator iter =
+                expr.operands.begin(); iter != expr.operands.end(); ++iter)
+            if (!evaluatePredicate(**iter, attributes))
+                return false;
+        return true;
+    case SimpleXPathExpr::Or:
+        for (std::vector<SimpleXPathExprPtr>::const_iterator iter =
+                expr.operands.begin(); iter != expr.operands.end(); ++iter)
+            if (evaluatePredicate(**iter, attributes))
+                return true;
+        return false;
+    case SimpleXPathExpr::Not:
+        return !evaluatePredicate(*expr.operands[0], attributes);
+    case SimpleXPathExpr::Equals:
+    case SimpleXPathExpr::NotEquals:
+    {
+        // General comparison: true if any attribute value compares
+        // successfully with any of the literals.
+        bool wantEqual = expr.type == SimpleXPathExpr::Equals;
+        std::string const &name = expr.operands[0]->steps[0].name;
+
+        for (Attributes::const_iterator iter = attributes.begin();
+                iter != attributes.end(); ++iter)
+        {
+            if (name != "*" && iter->first != name)
+                continue;
+
+            for (std::vector<std::string>::const_iterator litIter =
+                    expr.literals.begin(); litIter != expr.literals.end();
+                    ++litIter)
+                if ((iter->second == *litIter) == wantEqual)
+                    return true;
+        }
+
+        return false;
+    }
+    }
+
+    return false;
+}
+
+void StreamingQuery::evaluate(char const *xml, size_t size,
+    std::queue<std::string> *matches) const
+{
+    std::shared_ptr<xmlTextReader> reader(
+        xmlReaderForMemory(xml, size, NULL, NULL, XML_PARSE_NONET),
+        xmlFreeTextReader);
+    if (!reader)
+        return;
+
+    // Documents that cannot be parsed do not give results, like in the
+    // XQilla evaluator.
+    xmlTextReaderSetStructuredErrorHandler(reader.get(), &util::ignoreStructuredError, 0);
+
+    size_t nSteps = d_elementSteps.size();
+    uint64_t lastStep = nSteps == 0 ? 0 : uint64_t(1) << (nSteps - 1);
+
+    // Results are only added to the queue when the document was parsed
+    // successfully.
+    std::vector<std::string> results;
+    std::vector<OpenResult> open;
+    std::vector<Frame> stack;
+    Attributes attributes;
+
+    int r;
+    while ((r = xmlTextReaderRead(reader.get())) == 1)
+    {
+        int type = xmlTextReaderNodeType(reader.get());
+
+        if (type == XML_READER_TYPE_END_ELEMENT)
+        {
+            int depth = static_cast<int>(stack.size());
+            while (!open.empty() && open.back().depth == depth)
+                open.pop_back();
+            stack.pop_back();
+            continue;
+        }
+
+        if (type == XML_READER_TYPE_TEXT ||
+            type == XML_READER_TYPE_CDATA ||
+            type == XML_READER_TYPE_WHITESPACE ||
+            type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE)
+        {
+            if (open.empty())
+                continue;
+
+            xmlChar const *text = xmlTextReaderConstValue(reader.get());
+            if (text == 0)
+                continue;
+
+            for (std::vector<OpenResult>::const_iterator iter = open.begin();
+                    iter != open.end(); ++iter)
+                results[iter->index] += reinterpret_cast<char const *>(text);
+
+            continue;
+        }
+
+        if (type != XML_READER_TYPE_ELEMENT)
+            continue;
+
+        bool isEmpty = xmlTextReaderIsEmptyElement(reader.get()) == 1;
+        bool isRoot = stack.empty();
+        Frame parent = {0, 0};
+        if (!isRoot)
+            parent = stack.back();
+
+        bool inNamespace = xmlTextReaderConstNamespaceUri(reader.get()) != 0;
+        xmlChar const *name = xmlTextReaderConstLocalName(reader.get());
+
+        attributes.clear();
+        bool attributesRead = false;
+
+        Frame frame = {0, 0};
+        for (size_t k = 0; k < nSteps; ++k)
+        {
+            SimpleXPathStep const &step = *d_elementSteps[k];
+
+            bool context;
+            if (k == 0)
+                context = step.descendant || isRoot;
+            else if (step.descendant)
+                context = (parent.reach >> (k - 1)) & 1;
+            else
+                context = (parent.matched >> (k - 1)) & 1;
+
+            if (!context || !nameMatches(step.name, name, inNamespace))
+                continue;
+
+            if (!step.predicates.empty() && !attributesRead)
+            {
+                while (xmlTextReaderMoveToNextAttribute(reader.get()) == 1)
+                {
+                    if (xmlTextReaderIsNamespaceDecl(reader.get()) == 1)
+                        continue;
+
+                    xmlChar const *value = xmlTextReaderConstValue(reader.get());
+                    attributes.push_back(std::make_pair(
+                        std::string(reinterpret_cast<char const *>(
+                            attributeName(reader.get()))),
+                        std::string(value == 0 ? "" :
+                            reinterpret_cast<char const *>(value))));
+                }
+                xmlTextReaderMoveToElement(reader.get());
+                attributesRead = true;
+            }
+
+            bool predicatesHold = true;
+            for (std::vector<SimpleXPathExprPtr>::const_iterator iter =
+                    step.predicates.begin();
+                    predicatesHold && iter != step.predicates.end(); ++iter)
+                predicatesHold = evaluatePredicate(**iter, attributes);
+
+            if (predicatesHold)
+                frame.matched |= uint64_t(1) << k;
+        }
+        frame.reach = parent.reach | frame.matched;
+
+        int depth = static_cast<int>(stack.size()) + 1;
+
+        if (d_attributeStep)
+        {
+            bool owner;
+            if (nSteps == 0)
+                owner = d_attributeStep->descendant;
+            else if (d_attributeStep->descendant)
+                owner = (frame.reach & lastStep) != 0;
+            else
+                owner = (frame.matched & lastStep) != 0;
+
+            if (owner)
+            {
+                while (xmlTextReaderMoveToNextAttribute(reader.get()) == 1)
+                {
+                    if (xmlTextReaderIsNamespaceDecl(reader.get()) == 1 ||
+                            !nameMatches(d_attributeStep->name,
+                                xmlTextReaderConstLocalName(reader.get()),
+                                xmlTextReaderConstNamespaceUri(reader.get()) != 0))
+                        continue;
+
+                    xmlChar const *value = xmlTextReaderConstValue(reader.get());
+                    results.push_back(value == 0 ? std::string() :
+                        std::string(reinterpret_cast<char const *>(value)));
+                }
+                xmlTextReaderMoveToElement(reader.get());
+            }
+        }
+        else if (frame.matched & lastStep)
+        {
+            // The string value of an element is the concatenation of
+            // its text descendants.
+            results.push_back(std::string());
+            if (!isEmpty)
+                open.push_back(OpenResult(results.size() - 1, depth));
+        }
+
+        // Empty elements do not have an end element event.
+        if (!isEmpty)
+            stack.push_back(frame);
+    }
+
+    if (r != 0)
+        return;
+
+    for (std::vector<std::string>::iterator iter = results.begin();
+            iter != results.end(); ++iter)
+        matches->push(*iter);
+}
+
+}
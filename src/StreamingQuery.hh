@@ -0,0 +1,69 @@
+#ifndef ALPINOCORPUS_STREAMINGQUERY_HH
+#define ALPINOCORPUS_STREAMINGQUERY_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SimpleXPath.hh"
+
+namespace alpinocorpus {
+
+class StreamingQuery;
+typedef std::shared_ptr<StreamingQuery const> StreamingQueryPtr;
+
+/**
+ * XPath query that is evaluated while streaming through a document with
+ * a pull parser, without building a DOM tree.
+ *
+ * Supported are paths of child and descendant element steps, optionally
+ * followed by an attribute step. Element steps can have predicates that
+ * test the existence of their own attributes or compare them with string
+ * literals, combined with <tt>and</tt>, <tt>or</tt>, and <tt>not()</tt>.
+ * For example:
+ *
+ * <tt>//node[@cat="np" and not(@rel="su")]//node[@pt]/@lemma</tt>
+ */
+class StreamingQuery
+{
+public:
+    /**
+     * Plan a query. Returns a null pointer if the query cannot be
+     * evaluated in streaming mode.
+     */
+    static StreamingQueryPtr compile(std::string const &query);
+
+    /**
+     * Evaluate the query on a document, adding the string values of the
+     * results to <i>matches</i>. Nothing is added if the document cannot
+     * be parsed. Can be used from multiple threads simultaneously.
+     */
+    void evaluate(char const *xml, size_t size,
+        std::queue<std::string> *matches) const;
+
+private:
+    typedef std::vector<std::pair<std::string, std::string> > Attributes;
+
+    StreamingQuery(SimpleXPathExprPtr expr);
+
+    static bool supportedPredicate(SimpleXPathExpr const &expr);
+    static bool isAttributeTest(SimpleXPathExpr const &expr);
+    static bool evaluatePredicate(SimpleXPathExpr const &expr,
+        Attributes const &attributes);
+
+    // Keeps the steps alive.
+    SimpleXPathExprPtr d_expr;
+
+    std::vector<SimpleXPathStep const *> d_elementSteps;
+
+    // Final attribute step, if any.
+    SimpleXPathStep const *d_attributeStep;
+};
+
+}
+
+#endif // ALPINOCORPUS_STREAMINGQUERY_HH
@@ -55,22 +55,31 @@ namespace alpinocorpus {
 
 
     std::string Stylesheet::transform(std::string const &xml) const {
+        return transform(DataView(std::shared_ptr<void const>(), xml.data(),
+            xml.size()));
+    }
+
+    std::string Stylesheet::transform(DataView const &xml) const {
         // Read XML data intro an xmlDoc.
         std::shared_ptr<xmlDoc> doc(
-                xmlReadMemory(xml.c_str(), xml.size(), 0, 0, 0),
+                xmlReadMemory(xml.data(), xml.size(), 0, 0, 0),
                 xmlFreeDoc);
 
         if (!doc)
             throw Error("Stylesheet::transform: Could not open XML data");
 
+        return transform(doc.get());
+    }
+
+    std::string Stylesheet::transform(xmlDocPtr doc) const {
         std::shared_ptr<xsltTransformContext> ctx(
-                xsltNewTransformContext(d_xslPtr.get(), doc.get()),
+                xsltNewTransformContext(d_xslPtr.get(), doc),
                 xsltFreeTransformContext);
         xsltSetCtxtParseOptions(ctx.get(), XSLT_PARSE_OPTIONS);
 
         // Transform...
         std::shared_ptr<xmlDoc> res(
-                xsltApplyStylesheetUser(d_xslPtr.get(), doc.get(), NULL, NULL, NULL, ctx.get()),
+                xsltApplyStylesheetUser(d_xslPtr.get(), doc, NULL, NULL, NULL, ctx.get()),
                 xmlFreeDoc);
 
         if (!res)
@@ -1,6 +1,8 @@
 #include <list>
 #include <string>
 #include <typeinfo>
+#include <utility>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/IterImpl.hh>
@@ -8,14 +10,26 @@
 
 #include "StylesheetIter.hh"
 
-namespace alpinocorpus {
+namespace {
+    // Maximum number of entries that is read at once.
+    size_t const MAX_BATCH_SIZE = 64;
+}
 
+namespace alpinocorpus {
 
     IterImpl *StylesheetIter::copy() const
     {
-        // The only state are the wrapped iterators. We can safely reconstruct
-        // the transformer.
-        return new StylesheetIter(d_iter, d_stylesheet, d_markerQueries);
+        // The only state are the wrapped iterators and the buffered
+        // entries. We can safely reconstruct the transformer.
+        StylesheetIter *iter = new StylesheetIter(d_iter, d_stylesheet,
+            d_markerQueries);
+        iter->d_pending = d_pending;
+        iter->d_contents = d_contents;
+        iter->d_batchSize = d_batchSize;
+        iter->d_lastQueued = d_lastQueued;
+        iter->d_lastName = d_lastName;
+        iter->d_lastResult = d_lastResult;
+        return iter;
     }
 
     void StylesheetIter::interrupt()
@@ -30,17 +44,90 @@ namespace alpinocorpus {
 
     bool StylesheetIter::hasNext()
     {
-        return d_iter.hasNext();
+        return !d_pending.empty() || d_iter.hasNext();
     }
 
     Entry StylesheetIter::next(CorpusReader const &rdr)
     {
-        Entry e = d_iter.next(rdr);
-        e.contents = d_stylesheet.transform(rdr.read(e.name, d_markerQueries));
+        if (d_pending.empty())
+            fill(rdr);
+
+        Entry e = d_pending.front();
+        d_pending.pop_front();
+
+        std::string contents;
+        contents.swap(d_contents.front());
+        d_contents.pop_front();
+
+        if (e.name == d_lastName)
+        {
+            e.contents = d_lastResult;
+            return e;
+        }
+
+        if (d_markers)
+            e.contents = d_markers->transform(d_stylesheet, contents);
+        else
+            e.contents = d_stylesheet.transform(contents);
+
+        d_lastName = e.name;
+        d_lastResult = e.contents;
 
         return e;
     }
 
+    void StylesheetIter::fill(CorpusReader const &rdr)
+    {
+        // Entries that are not read, because they repeat the preceding
+        // entry, get empty contents.
+        //
+        // If the iterator returns the contents of entries, they are used,
+        // unless markers have to be added by the reader.
+        bool preloaded = d_iter.hasContents() &&
+            (d_markerQueries.empty() || d_markers);
+
+        std::vector<std::string> names;
+        std::vector<std::string> contents;
+        std::vector<bool> repeated;
+        while (d_pending.size() < d_batchSize &&
+                (d_pending.empty() || d_iter.hasNext()))
+        {
+            d_pending.push_back(d_iter.next(rdr));
+
+            Entry &e = d_pending.back();
+            repeated.push_back(e.name == d_lastQueued);
+            if (!repeated.back())
+            {
+                names.push_back(e.name);
+                if (preloaded)
+                    contents.push_back(std::move(e.contents));
+            }
+            d_lastQueued = e.name;
+        }
+
+        if (d_batchSize < MAX_BATCH_SIZE)
+            d_batchSize *= 2;
+
+        if (!preloaded)
+        {
+            if (d_markerQueries.empty() || d_markers)
+                contents = rdr.readMany(names);
+            else
+                for (std::vector<std::string>::const_iterator iter = names.begin();
+                        iter != names.end(); ++iter)
+                    contents.push_back(rdr.read(*iter, d_markerQueries));
+        }
+
+        std::vector<std::string>::iterator contentsIter = contents.begin();
+        for (std::vector<bool>::const_iterator iter = repeated.begin();
+                iter != repeated.end(); ++iter)
+        {
+            d_contents.push_back(std::string());
+            if (!*iter)
+                d_contents.back().swap(*contentsIter++);
+        }
+    }
+
     double StylesheetIter::progress()
     {
         return d_iter.progress();
@@ -1,6 +1,8 @@
 #ifndef ALPINOCORPUS_STYLESHEETITER_HH
 #define ALPINOCORPUS_STYLESHEETITER_HH
 
+#include <cstddef>
+#include <deque>
 #include <list>
 #include <memory>
 #include <string>
@@ -9,6 +11,8 @@
 #include <AlpinoCorpus/Entry.hh>
 #include <AlpinoCorpus/IterImpl.hh>
 
+#include "CompiledMarkers.hh"
+
 namespace alpinocorpus {
     class Stylesheet;
 
@@ -19,7 +23,12 @@ namespace alpinocorpus {
                        std::list<CorpusReader::MarkerQuery> const &markerQueries) :
                 d_iter(iter),
                 d_markerQueries(markerQueries),
-                d_stylesheet(stylesheet) {}
+                d_stylesheet(stylesheet),
+                d_batchSize(1)
+        {
+            if (!markerQueries.empty())
+                d_markers = CompiledMarkers::compile(markerQueries);
+        }
 
         virtual ~StylesheetIter() {}
 
@@ -41,9 +50,26 @@ namespace alpinocorpus {
 
         StylesheetIter &operator=(StylesheetIter const &other);
 
+        void fill(CorpusReader const &rdr);
+
         CorpusReader::EntryIterator d_iter;
         std::list<CorpusReader::MarkerQuery> d_markerQueries;
         Stylesheet const d_stylesheet;
+
+        // Entries are read in batches. The batch size grows, so that
+        // the first results are returned quickly.
+        std::deque<Entry> d_pending;
+        std::deque<std::string> d_contents;
+        size_t d_batchSize;
+
+        // If set, marking and the transformation share a parse.
+        CompiledMarkersPtr d_markers;
+
+        // Query iterators return an entry once per match. Consecutive
+        // duplicates are only read and transformed once.
+        std::string d_lastQueued;
+        std::string d_lastName;
+        std::string d_lastResult;
     };
 }
 
@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <libxml/xmlreader.h>
+
+#include <AlpinoCorpus/CorpusInfo.hh>
+#include <AlpinoCorpus/Token.hh>
+
+#include "TokenStore.hh"
+#include "util/LibXml.hh"
+#include "util/LittleEndian.hh"
+#include "util/parseString.hh"
+
+// Token store layout, all integers are little-endian:
+//
+// header (64 bytes):
+//   magic            8 bytes, "ACTOKENS"
+//   version          uint32
+//   reserved         uint32
+//   entry count      uint64
+//   token count      uint64
+//   attribute count  uint64
+//   names size       uint64
+//   string count     uint64
+//   strings size     uint64
+// names (names size bytes):
+//   lexical element, token attribute, and the stored attributes,
+//   NUL-terminated
+// entries ((entry count + 1) * 8 bytes):
+//   uint64 number of the first token of each entry, followed by the
+//   token count
+// begins (token count * 4 bytes):
+//   uint32 begin position of each token, in document order
+// columns (attribute count * token count * 4 bytes):
+//   for each attribute, the uint32 string id of its value for each token,
+//   0xffffffff if the token does not have the attribute
+// string offsets ((string count + 1) * 8 bytes):
+//   uint64 offset of each string, followed by the strings size
+// strings (strings size bytes):
+//   unique attribute values, not terminated
+
+using alpinocorpus::util::readUint;
+using alpinocorpus::util::writeUint;
+
+namespace {
+    char const TOKEN_STORE_MAGIC[8] = {'A', 'C', 'T', 'O', 'K', 'E', 'N', 'S'};
+    uint32_t const TOKEN_STORE_VERSION = 1;
+
+    size_t const HEADER_SIZE = 64;
+    uint32_t const ABSENT = std::numeric_limits<uint32_t>::max();
+
+    // A token in document order, values[i] is only valid if present[i].
+    struct ScannedToken
+    {
+        size_t begin;
+        std::vector<std::string> values;
+        std::vector<bool> present;
+    };
+
+    // Scan the tokens of an entry. If <i>corpusInfo</i> is null, the
+    // corpus information of the type of the entry is used and stored in
+    // <i>typeInfo</i>. Returns false if the entry cannot be parsed.
+    bool scanTokens(char const *xml, size_t len,
+        alpinocorpus::CorpusInfo const *corpusInfo,
+        std::vector<std::string> const &attributes,
+        std::shared_ptr<alpinocorpus::CorpusInfo> *typeInfo,
+        std::vector<ScannedToken> *tokens)
+    {
+        std::shared_ptr<xmlTextReader> reader(
+            xmlReaderForMemory(xml, len, NULL, NULL, XML_PARSE_NONET),
+            xmlFreeTextReader);
+        if (!reader)
+            return false;
+
+        xmlTextReaderSetStructuredErrorHandler(reader.get(), &alpinocorpus::util::ignoreStructuredError, 0);
+
+        int r;
+        while ((r = xmlTextReaderRead(reader.get())) == 1)
+        {
+            if (xmlTextReaderNodeType(reader.get()) != XML_READER_TYPE_ELEMENT)
+                continue;
+
+            char const *name = reinterpret_cast<char const *>(
+                xmlTextReaderConstLocalName(reader.get()));
+
+            if (corpusInfo == 0)
+            {
+                typeInfo->reset(new alpinocorpus::CorpusInfo(
+                    alpinocorpus::predefinedCorpusOrFallback(name)));
+                corpusInfo = typeInfo->get();
+            }
+
+            if (xmlTextReaderConstNamespaceUri(reader.get()) != 0 ||
+                    corpusInfo->lexicalElement() != name)
+                continue;
+
+            ScannedToken token;
+            token.begin = 0;
+            token.values.resize(attributes.size());
+            token.present.resize(attributes.size());
+
+            bool hasToken = false;
+            while (xmlTextReaderMoveToNextAttribute(reader.get()) == 1)
+            {
+                if (xmlTextReaderIsNamespaceDecl(reader.get()) == 1)
+                    continue;
+
+                std::string attribute(reinterpret_cast<char const *>(
+                    xmlTextReaderConstLocalName(reader.get())));
+                xmlChar const *value = xmlTextReaderConstValue(reader.get());
+                char const *valueStr = value == 0 ? "" :
+                    reinterpret_cast<char const *>(value);
+
+                if (attribute == corpusInfo->tokenAttribute())
+                    hasToken = true;
+
+                if (attribute == "begin")
+                {
+                    try {
+                        token.begin = alpinocorpus::util::parseString<size_t>(valueStr);
+                    } catch (std::invalid_argument &e) {
+                    }
+                }
+
+                for (size_t i = 0; i < attributes.size(); ++i)
+                    if (!token.present[i] && attributes[i] == attribute)
+                    {
+                        token.values[i] = valueStr;
+                        token.present[i] = true;
+                    }
+            }
+            xmlTextReaderMoveToElement(reader.get());
+
+            if (hasToken)
+                tokens->push_back(token);
+        }
+
+        return r == 0;
+    }
+
+    bool beginLess(alpinocorpus::Token const &a, alpinocorpus::Token const &b)
+    {
+        return a.begin < b.begin;
+    }
+
+    // Take a section of count elements from the remaining file size,
+    // returns false if the section does not fit. Sizes are checked
+    // without multiplying, so that corrupt counts cannot overflow.
+    bool takeSection(uint64_t *remaining, uint64_t count, uint64_t elemSize)
+    {
+        if (elemSize != 0 && count > *remaining / elemSize)
+            return false;
+
+        *remaining -= count * elemSize;
+        return true;
+    }
+}
+
+namespace alpinocorpus {
+
+std::vector<Token> extractTokens(char const *xml, size_t len,
+    std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo)
+{
+    std::vector<ScannedToken> scanned;
+    if (!scanTokens(xml, len, &corpusInfo, attributes, 0, &scanned))
+        return std::vector<Token>();
+
+    std::vector<Token> tokens;
+    tokens.reserve(scanned.size());
+
+    for (std::vector<ScannedToken>::iterator iter = scanned.begin();
+            iter != scanned.end(); ++iter)
+    {
+        Token token;
+        token.begin = iter->begin;
+        token.values.swap(iter->values);
+        for (size_t i = 0; i < attributes.size(); ++i)
+            if (!iter->present[i])
+                token.values[i] = defaultValue;
+
+        tokens.push_back(token);
+    }
+
+    std::stable_sort(tokens.begin(), tokens.end(), beginLess);
+
+    return tokens;
+}
+
+TokenStore::TokenStore(std::string const &filename) :
+    d_file(filename)
+{
+    unsigned char const *data = d_file.data();
+
+    if (d_file.size() < HEADER_SIZE ||
+            std::memcmp(data, TOKEN_STORE_MAGIC, sizeof(TOKEN_STORE_MAGIC)) != 0)
+        throw std::runtime_error("TokenStore: not a token store: " + filename);
+
+    if (readUint(data + 8, 4) != TOKEN_STORE_VERSION)
+        throw std::runtime_error("TokenStore: unsupported store version: " + filename);
+
+    d_nEntries = readUint(data + 16, 8);
+    d_nTokens = readUint(data + 24, 8);
+    uint64_t nAttributes = readUint(data + 32, 8);
+    uint64_t namesSize = readUint(data + 40, 8);
+    d_nStrings = readUint(data + 48, 8);
+    d_stringsSize = readUint(data + 56, 8);
+
+    // Every attribute has a name, so the attribute count is bounded by
+    // the names size, and the size of a column of all attributes cannot
+    // overflow.
+    uint64_t remaining = d_file.size() - HEADER_SIZE;
+    if (nAttributes > namesSize ||
+            !takeSection(&remaining, namesSize, 1) ||
+            !takeSection(&remaining, d_nEntries, 8) ||
+            !takeSection(&remaining, 1, 8) ||
+            !takeSection(&remaining, d_nTokens, 4 * (nAttributes + 1)) ||
+            !takeSection(&remaining, d_nStrings, 8) ||
+            !takeSection(&remaining, 1, 8) ||
+            !takeSection(&remaining, d_stringsSize, 1) ||
+            remaining != 0)
+        throw std::runtime_error("TokenStore: corrupt store: " + filename);
+
+    std::vector<std::string> names;
+    char const *namesPtr = reinterpret_cast<char const *>(data + HEADER_SIZE);
+    char const *namesEnd = namesPtr + namesSize;
+    while (namesPtr != namesEnd)
+    {
+        char const *end = std::find(namesPtr, namesEnd, '\0');
+        if (end == namesEnd)
+            throw std::runtime_error("TokenStore: corrupt store: " + filename);
+
+        names.push_back(std::string(namesPtr, end));
+        namesPtr = end + 1;
+    }
+
+    if (names.size() != nAttributes + 2)
+        throw std::runtime_error("TokenStore: corrupt store: " + filename);
+
+    d_lexicalElement = names[0];
+    d_tokenAttribute = names[1];
+    for (size_t i = 2; i < names.size(); ++i)
+        d_columns[names[i]] = i - 2;
+
+    d_entries = data + HEADER_SIZE + namesSize;
+    d_begins = d_entries + (d_nEntries + 1) * 8;
+    d_ids = d_begins + d_nTokens * 4;
+    d_stringOffsets = d_ids + nAttributes * d_nTokens * 4;
+    d_strings = d_stringOffsets + (d_nStrings + 1) * 8;
+}
+
+bool TokenStore::covers(std::vector<std::string> const &attributes,
+    CorpusInfo const &corpusInfo) const
+{
+    if (corpusInfo.lexicalElement() != d_lexicalElement ||
+            corpusInfo.tokenAttribute() != d_tokenAttribute)
+        return false;
+
+    for (std::vector<std::string>::const_iterator iter = attributes.begin();
+            iter != attributes.end(); ++iter)
+        if (d_columns.find(*iter) == d_columns.end())
+            return false;
+
+    return true;
+}
+
+std::vector<Token> TokenStore::tokens(size_t entry,
+    std::vector<std::string> const &attributes,
+    std::string const &defaultValue) const
+{
+    if (entry >= d_nEntries)
+        throw std::runtime_error("TokenStore: entry out of range");
+
+    std::vector<unsigned char const *> columns;
+    for (std::vector<std::string>::const_iterator iter = attributes.begin();
+            iter != attributes.end(); ++iter)
+        columns.push_back(d_ids + d_columns.at(*iter) * d_nTokens * 4);
+
+    size_t first = readUint(d_entries + entry * 8, 8);
+    size_t last = readUint(d_entries + (entry + 1) * 8, 8);
+    if (first > last || last > d_nTokens)
+        throw std::runtime_error("TokenStore: corrupt store");
+
+    std::vector<Token> tokens(last - first);
+    for (size_t i = first; i < last; ++i)
+    {
+        Token &token = tokens[i - first];
+        token.begin = readUint(d_begins + i * 4, 4);
+        token.values.reserve(columns.size());
+
+        for (std::vector<unsigned char const *>::const_iterator iter =
+                columns.begin(); iter != columns.end(); ++iter)
+        {
+            uint32_t id = readUint(*iter + i * 4, 4);
+            if (id == ABSENT)
+            {
+                token.values.push_back(defaultValue);
+                continue;
+            }
+
+            if (id >= d_nStrings)
+                throw std::runtime_error("TokenStore: corrupt store");
+
+            uint64_t offset = readUint(d_stringOffsets + id * 8, 8);
+            uint64_t end = readUint(d_stringOffsets + (id + 1) * 8, 8);
+            if (offset > end || end > d_stringsSize)
+                throw std::runtime_error("TokenStore: corrupt store");
+
+            token.values.push_back(std::string(
+                reinterpret_cast<char const *>(d_strings + offset),
+                end - offset));
+        }
+    }
+
+    std::stable_sort(tokens.begin(), tokens.end(), beginLess);
+
+    return tokens;
+}
+
+TokenStoreWriter::TokenStoreWriter(std::string const &filename,
+        std::vector<std::string> const &attributes) :
+    d_filename(filename), d_attributes(attributes),
+    d_columns(attributes.size()), d_failed(false)
+{
+    d_entries.push_back(0);
+    d_stringOffsets.push_back(0);
+}
+
+TokenStoreWriter::~TokenStoreWriter()
+{
+    // The token store is optional, readers parse entries if it is
+    // missing. Do not leave a store behind that lacks entries.
+    try {
+        if (d_failed)
+            std::remove(d_filename.c_str());
+        else
+            write();
+    } catch (...) {
+        std::remove(d_filename.c_str());
+    }
+}
+
+uint32_t TokenStoreWriter::stringId(std::string const &str)
+{
+    std::unordered_map<std::string, uint32_t>::const_iterator iter =
+        d_stringIds.find(str);
+    if (iter != d_stringIds.end())
+        return iter->second;
+
+    uint32_t id = d_stringOffsets.size() - 1;
+    if (id == ABSENT)
+    {
+        d_failed = true;
+        return ABSENT;
+    }
+
+    d_stringIds[str] = id;
+    d_strings += str;
+    d_stringOffsets.push_back(d_strings.size());
+
+    return id;
+}
+
+void TokenStoreWriter::add(char const *xml, size_t len)
+{
+    if (d_failed)
+        return;
+
+    std::shared_ptr<CorpusInfo> typeInfo;
+    std::vector<ScannedToken> tokens;
+    if (!scanTokens(xml, len, 0, d_attributes, &typeInfo, &tokens) || !typeInfo)
+    {
+        // Entries that cannot be parsed would be missing from the store.
+        d_failed = true;
+        return;
+    }
+
+    if (d_entries.size() == 1)
+    {
+        d_lexicalElement = typeInfo->lexicalElement();
+        d_tokenAttribute = typeInfo->tokenAttribute();
+    }
+    else if (typeInfo->lexicalElement() != d_lexicalElement ||
+            typeInfo->tokenAttribute() != d_tokenAttribute)
+    {
+        d_failed = true;
+        return;
+    }
+
+    for (std::vector<ScannedToken>::const_iterator iter = tokens.begin();
+            iter != tokens.end(); ++iter)
+    {
+        if (iter->begin >= ABSENT)
+        {
+            d_failed = true;
+            return;
+        }
+
+        d_begins.push_back(iter->begin);
+
+        for (size_t i = 0; i < d_attributes.size(); ++i)
+            d_columns[i].push_back(iter->present[i] ?
+                stringId(iter->values[i]) : ABSENT);
+    }
+
+    d_entries.push_back(d_begins.size());
+}
+
+void TokenStoreWriter::write() const
+{
+    std::string names(d_lexicalElement);
+    names.push_back('\0');
+    names += d_tokenAttribute;
+    names.push_back('\0');
+    for (std::vector<std::string>::const_iterator iter = d_attributes.begin();
+            iter != d_attributes.end(); ++iter)
+    {
+        names += *iter;
+        names.push_back('\0');
+    }
+
+    std::ofstream out(d_filename.c_str(), std::ios::binary);
+    if (!out)
+        throw std::runtime_error("TokenStoreWriter: could not open " + d_filename);
+
+    out.write(TOKEN_STORE_MAGIC, sizeof(TOKEN_STORE_MAGIC));
+    writeUint(out, TOKEN_STORE_VERSION, 4);
+    writeUint(out, 0, 4);
+    writeUint(out, d_entries.size() - 1, 8);
+    writeUint(out, d_begins.size(), 8);
+    writeUint(out, d_attributes.size(), 8);
+    writeUint(out, names.size(), 8);
+    writeUint(out, d_stringOffsets.size() - 1, 8);
+    writeUint(out, d_strings.size(), 8);
+
+    out.write(names.data(), names.size());
+
+    for (std::vector<uint64_t>::const_iterator iter = d_entries.begin();
+            iter != d_entries.end(); ++iter)
+        writeUint(out, *iter, 8);
+
+    for (std::vector<uint32_t>::const_iterator iter = d_begins.begin();
+            iter != d_begins.end(); ++iter)
+        writeUint(out, *iter, 4);
+
+    for (std::vector<std::vector<uint32_t> >::const_iterator column =
+            d_columns.begin(); column != d_columns.end(); ++column)
+        for (std::vector<uint32_t>::const_iterator iter = column->begin();
+                iter != column->end(); ++iter)
+            writeUint(out, *iter, 4);
+
+    for (std::vector<uint64_t>::const_iterator iter = d_stringOffsets.begin();
+            iter != d_stringOffsets.end(); ++iter)
+        writeUint(out, *iter, 8);
+
+    out.write(d_strings.data(), d_strings.size());
+
+    out.close();
+    if (!out)
+        throw std::runtime_error("TokenStoreWriter: could not write " + d_filename);
+}
+
+}
@@ -0,0 +1,124 @@
+#ifndef ALPINOCORPUS_TOKENSTORE_HH
+#define ALPINOCORPUS_TOKENSTORE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <AlpinoCorpus/CorpusInfo.hh>
+#include <AlpinoCorpus/Token.hh>
+
+#include "util/MappedFile.hh"
+
+namespace alpinocorpus {
+
+/**
+ * Extract the tokens of a sentence from its XML data, ordered by their
+ * begin position. Tokens are the lexical elements that have the token
+ * attribute of the corpus. Tokens that lack an attribute get
+ * <i>defaultValue</i>. Returns an empty list if the data cannot be parsed.
+ */
+std::vector<Token> extractTokens(char const *xml, size_t len,
+    std::vector<std::string> const &attributes,
+    std::string const &defaultValue, CorpusInfo const &corpusInfo);
+
+/**
+ * Columnar store of the tokens of every entry of a corpus, so that
+ * sentences can be shown without parsing entries. For each stored
+ * attribute, the values of all tokens are kept as a column of ids in a
+ * table of unique strings. Entries are identified by their position in
+ * the corpus (in the order in which they were written).
+ *
+ * The store is memory-mapped.
+ */
+class TokenStore
+{
+public:
+    /**
+     * Open a token store, throws std::runtime_error if the file cannot
+     * be mapped or is not a valid token store.
+     */
+    TokenStore(std::string const &filename);
+
+    /** The number of entries in the corpus. */
+    size_t nEntries() const;
+
+    /**
+     * Can the store provide tokens of the given attributes, as defined
+     * by <i>corpusInfo</i>?
+     */
+    bool covers(std::vector<std::string> const &attributes,
+        CorpusInfo const &corpusInfo) const;
+
+    /**
+     * Get the tokens of an entry, as extractTokens() does. The store
+     * should cover the attributes. Throws std::runtime_error if the
+     * tokens of the entry are corrupt.
+     */
+    std::vector<Token> tokens(size_t entry,
+        std::vector<std::string> const &attributes,
+        std::string const &defaultValue) const;
+
+private:
+    util::MappedFile d_file;
+    size_t d_nEntries;
+    size_t d_nTokens;
+    size_t d_nStrings;
+    size_t d_stringsSize;
+    std::string d_lexicalElement;
+    std::string d_tokenAttribute;
+    std::unordered_map<std::string, size_t> d_columns;
+    unsigned char const *d_entries;
+    unsigned char const *d_begins;
+    unsigned char const *d_ids;
+    unsigned char const *d_stringOffsets;
+    unsigned char const *d_strings;
+};
+
+inline size_t TokenStore::nEntries() const
+{
+    return d_nEntries;
+}
+
+/**
+ * Writer for token stores. Tokens are collected in memory and the store
+ * is written when the writer is destructed. The lexical element and
+ * token attribute are those of the corpus type of the first entry. If an
+ * entry of another type is added, no store is written.
+ */
+class TokenStoreWriter
+{
+public:
+    TokenStoreWriter(std::string const &filename,
+        std::vector<std::string> const &attributes);
+    ~TokenStoreWriter();
+
+    /** Add the next entry. */
+    void add(char const *xml, size_t len);
+
+private:
+    TokenStoreWriter(TokenStoreWriter const &) = delete;
+    TokenStoreWriter &operator=(TokenStoreWriter const &) = delete;
+
+    uint32_t stringId(std::string const &str);
+    void write() const;
+
+    std::string d_filename;
+    std::vector<std::string> d_attributes;
+    std::string d_lexicalElement;
+    std::string d_tokenAttribute;
+
+    std::vector<uint64_t> d_entries;
+    std::vector<uint32_t> d_begins;
+    std::vector<std::vector<uint32_t> > d_columns;
+    std::unordered_map<std::string, uint32_t> d_stringIds;
+    std::vector<uint64_t> d_stringOffsets;
+    std::string d_strings;
+    bool d_failed;
+};
+
+}
+
+#endif // ALPINOCORPUS_TOKENSTORE_HH
@@ -57,6 +57,14 @@ size_t const GZ_TRAILER_SIZE = 8;
 size_t const GZ_TRAILER_CRC32 = 0;
 size_t const GZ_TRAILER_ISIZE = 4;
 
+// Compressed chunk of a dictzip file.
+struct DzChunk
+{
+    DzChunk(size_t newOffset, size_t newSize) : offset(newOffset), size(newSize) {}
+    size_t offset;
+    size_t size;
+};
+
 }
 
 #endif // GZIP_HH
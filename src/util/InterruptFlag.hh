@@ -0,0 +1,42 @@
+#ifndef ALPINOCORPUS_UTIL_INTERRUPTFLAG_HH
+#define ALPINOCORPUS_UTIL_INTERRUPTFLAG_HH
+
+#include <atomic>
+
+namespace alpinocorpus { namespace util {
+
+/**
+ * Boolean flag for the interrupt() method of iterators, which can be
+ * called from another thread. Unlike std::atomic<bool>, it can be copied,
+ * so that iterators can keep their implicit copy constructors.
+ */
+class InterruptFlag
+{
+public:
+    InterruptFlag(bool set = false) : d_set(set) {}
+    InterruptFlag(InterruptFlag const &other) : d_set(other.d_set.load()) {}
+
+    InterruptFlag &operator=(InterruptFlag const &other)
+    {
+        d_set = other.d_set.load();
+        return *this;
+    }
+
+    InterruptFlag &operator=(bool set)
+    {
+        d_set = set;
+        return *this;
+    }
+
+    operator bool() const
+    {
+        return d_set;
+    }
+
+private:
+    std::atomic<bool> d_set;
+};
+
+} } // namespace alpinocorpus::util
+
+#endif // ALPINOCORPUS_UTIL_INTERRUPTFLAG_HH
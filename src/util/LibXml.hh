@@ -0,0 +1,18 @@
+#ifndef ALPINOCORPUS_UTIL_LIBXML_HH
+#define ALPINOCORPUS_UTIL_LIBXML_HH
+
+#include <libxml/xmlerror.h>
+
+namespace alpinocorpus { namespace util {
+
+/**
+ * Structured error handler that discards libxml2 errors, for parsers
+ * and XPath contexts whose errors are reported through return values.
+ */
+inline void ignoreStructuredError(void *, xmlErrorPtr)
+{
+}
+
+} } // namespace alpinocorpus::util
+
+#endif // ALPINOCORPUS_UTIL_LIBXML_HH
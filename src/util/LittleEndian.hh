@@ -0,0 +1,36 @@
+#ifndef ALPINOCORPUS_UTIL_LITTLEENDIAN_HH
+#define ALPINOCORPUS_UTIL_LITTLEENDIAN_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace alpinocorpus { namespace util {
+
+/**
+ * Read an unsigned little-endian integer of <i>n</i> (at most 8) bytes,
+ * as used by the on-disk indexes of compact corpora.
+ */
+inline uint64_t readUint(unsigned char const *buf, size_t n)
+{
+    uint64_t val = 0;
+    for (size_t i = n; i != 0; --i)
+        val = (val << 8) | buf[i - 1];
+    return val;
+}
+
+/** Write an unsigned integer as <i>n</i> (at most 8) little-endian bytes. */
+inline void writeUint(std::ostream &out, uint64_t val, size_t n)
+{
+    char buf[8];
+    for (size_t i = 0; i < n; ++i)
+    {
+        buf[i] = static_cast<char>(val & 0xff);
+        val >>= 8;
+    }
+    out.write(buf, n);
+}
+
+} } // namespace alpinocorpus::util
+
+#endif // ALPINOCORPUS_UTIL_LITTLEENDIAN_HH
@@ -0,0 +1,58 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedFile.hh"
+
+namespace alpinocorpus { namespace util {
+
+MappedFile::MappedFile(std::string const &filename) : d_data(0), d_size(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error(std::string("MappedFile: could not open '") +
+            filename + "': " + std::strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error(std::string("MappedFile: could not stat '") +
+            filename + "': " + std::strerror(err));
+    }
+
+    d_size = st.st_size;
+
+    // Empty files cannot be mapped.
+    if (d_size != 0)
+    {
+        void *data = mmap(0, d_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            int err = errno;
+            close(fd);
+            throw std::runtime_error(std::string("MappedFile: could not map '") +
+                filename + "': " + std::strerror(err));
+        }
+
+        d_data = static_cast<unsigned char const *>(data);
+    }
+
+    // The mapping stays valid after closing the descriptor.
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (d_data != 0)
+        munmap(const_cast<unsigned char *>(d_data), d_size);
+}
+
+} } // namespace alpinocorpus::util
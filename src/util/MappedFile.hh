@@ -0,0 +1,46 @@
+#ifndef ALPINOCORPUS_UTIL_MAPPEDFILE_HH
+#define ALPINOCORPUS_UTIL_MAPPEDFILE_HH
+
+#include <cstddef>
+#include <string>
+
+namespace alpinocorpus { namespace util {
+
+/**
+ * Read-only memory map of a complete file. The mapping is shared between
+ * all threads and is never modified, so it can be read without locking.
+ */
+class MappedFile
+{
+public:
+    /**
+     * Map a file, throws std::runtime_error if the file cannot be opened
+     * or mapped.
+     */
+    MappedFile(std::string const &filename);
+    ~MappedFile();
+
+    unsigned char const *data() const;
+    size_t size() const;
+
+private:
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    unsigned char const *d_data;
+    size_t d_size;
+};
+
+inline unsigned char const *MappedFile::data() const
+{
+    return d_data;
+}
+
+inline size_t MappedFile::size() const
+{
+    return d_size;
+}
+
+} } // namespace alpinocorpus::util
+
+#endif // ALPINOCORPUS_UTIL_MAPPEDFILE_HH
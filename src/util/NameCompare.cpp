@@ -1,79 +1,105 @@
-#include <cctype>
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include <boost/filesystem.hpp>
 
-#include "InfInt.h"
 #include "NameCompare.hh"
-#include "parseString.hh"
+
+// Names are compared as sequences of components: runs of digits, which
+// are compared by their value, and single other characters, which are
+// compared by their byte value. A number compares to a character as its
+// first digit does. A name that starts with a character has an empty
+// first component, so it sorts before names that start with a number.
+//
+// The sort key of a name encodes the components such that keys sort
+// bytewise in the same order:
+//
+//   empty first component  '\0'
+//   character              the character itself
+//   number                 '0', the number of significant digits (one
+//                          byte if less than 255, otherwise 0xff and
+//                          four bytes, big-endian), the significant
+//                          digits
+//
+// Since a character is never a digit, it compares to the '0' of a
+// number as it would to any digit.
 
 namespace {
 
-    std::vector<std::string> nameIndex(std::string const &name)
+    bool isDigit(char c)
     {
-        std::vector<std::string> index;
-
-        if (name.size() == 0)
-            return index;
-
-        std::ostringstream buf;
+        return c >= '0' && c <= '9';
+    }
 
-        bool prevIsDigit = std::isdigit(name[0]);
-        for (std::string::const_iterator iter = name.begin(); iter != name.end();
-            ++iter)
+    void appendLength(size_t len, std::string *key)
+    {
+        if (len < 0xff)
         {
-            bool curIsDigit = std::isdigit(*iter);
-
-            if (curIsDigit && prevIsDigit)
-                buf << *iter;
-            else
-            {
-                index.push_back(buf.str());
-                buf.str("");
-                buf << *iter;
-            }
-
-            prevIsDigit = curIsDigit;
+            key->push_back(static_cast<char>(len));
+            return;
         }
 
-        // Leftover
-        index.push_back(buf.str());
+        if (len > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("appendNameKey: number too long");
 
-        return index;
+        key->push_back(static_cast<char>(0xff));
+        for (int shift = 24; shift >= 0; shift -= 8)
+            key->push_back(static_cast<char>((len >> shift) & 0xff));
     }
 
 }
 
 namespace alpinocorpus {
 
-    bool NameCompare::operator()(std::string const &s1, std::string const &s2) const
+    void appendNameKey(std::string const &name, std::string *key)
     {
-        std::vector<std::string> const &i1 = nameIndex(s1);
-        std::vector<std::string> const &i2 = nameIndex(s2);
+        if (name.empty())
+            return;
+
+        if (!isDigit(name[0]))
+            key->push_back('\0');
 
-        for (size_t i = 0; i < i1.size() && i < i2.size(); ++i)
+        size_t i = 0;
+        while (i < name.size())
         {
-                // Both digits? Sort on digits!
-            if (std::isdigit(i1[i][0]) && std::isdigit(i2[i][0]))
+            if (!isDigit(name[i]))
             {
-                InfInt d1 = util::parseString<InfInt>(i1[i]);
-                InfInt d2 = util::parseString<InfInt>(i2[i]);
-
-                if (d1 != d2)
-                    return d1 < d2;
-            }
-            else
-                if (i1[i] != i2[i])
-                    return i1[i] < i2[i];
+                key->push_back(name[i]);
+                ++i;
+                continue;
             }
 
-        if (i1.size() != i2.size())
-          return i1.size() < i2.size();
+            size_t end = i;
+            while (end < name.size() && isDigit(name[end]))
+                ++end;
+
+            // Leading zeros do not change the value of a number.
+            while (i < end && name[i] == '0')
+                ++i;
+
+            key->push_back('0');
+            appendLength(end - i, key);
+            key->append(name, i, end - i);
+
+            i = end;
+        }
+    }
+
+    std::string nameKey(std::string const &name)
+    {
+        std::string key;
+        key.reserve(name.size() + 8);
+        appendNameKey(name, &key);
+        return key;
+    }
 
-        // The pairs are equal...
-        return false;
+    bool NameCompare::operator()(std::string const &s1, std::string const &s2) const
+    {
+        return nameKey(s1) < nameKey(s2);
     }
 
     bool PathCompare::operator()(boost::filesystem::path const &p1,
@@ -81,4 +107,48 @@ namespace alpinocorpus {
     {
         return d_nameCompare(p1.string(), p2.string());
     }
+
+    NameKeys::NameKeys() : d_offsets(1, 0)
+    {
+    }
+
+    void NameKeys::push_back(std::string const &name)
+    {
+        if (size() == std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("NameKeys: too many names");
+
+        appendNameKey(name, &d_keys);
+        d_offsets.push_back(d_keys.size());
+    }
+
+    void NameKeys::reserve(size_t names)
+    {
+        d_offsets.reserve(names + 1);
+    }
+
+    std::vector<uint32_t> NameKeys::order() const
+    {
+        std::vector<uint32_t> order(size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        char const *keys = d_keys.data();
+        std::vector<size_t> const &offsets = d_offsets;
+        std::sort(order.begin(), order.end(),
+            [keys, &offsets](uint32_t a, uint32_t b) {
+                size_t sizeA = offsets[a + 1] - offsets[a];
+                size_t sizeB = offsets[b + 1] - offsets[b];
+
+                int r = std::memcmp(keys + offsets[a], keys + offsets[b],
+                    std::min(sizeA, sizeB));
+                if (r != 0)
+                    return r < 0;
+                if (sizeA != sizeB)
+                    return sizeA < sizeB;
+
+                return a < b;
+            });
+
+        return order;
+    }
 }
@@ -1,13 +1,30 @@
 #ifndef ALPINOCORPUS_NAME_COMPARE
 #define ALPINOCORPUS_NAME_COMPARE
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
 namespace alpinocorpus
 {
 
+/**
+ * Get the sort key of a name. Names are ordered by NameCompare as their
+ * keys are ordered bytewise (as by memcmp), so that a key only has to
+ * be computed once per name.
+ */
+std::string nameKey(std::string const &name);
+
+/** Append the sort key of a name to <i>key</i>. */
+void appendNameKey(std::string const &name, std::string *key);
+
+/**
+ * Compare names 'naturally': numbers in names are compared by their
+ * value, other characters by their byte value.
+ */
 struct NameCompare
 {
     bool operator()(std::string const &s1, std::string const &s2) const;
@@ -21,6 +38,38 @@ private:
     NameCompare d_nameCompare;
 };
 
+/**
+ * Sort keys of a list of names, stored in a single buffer. Sorting many
+ * names through their keys does not parse names or allocate per
+ * comparison.
+ */
+class NameKeys
+{
+public:
+    NameKeys();
+
+    void push_back(std::string const &name);
+    void reserve(size_t names);
+    size_t size() const;
+
+    /**
+     * The positions of the names in NameCompare order. Names that
+     * compare equal keep their relative order.
+     */
+    std::vector<uint32_t> order() const;
+
+private:
+    std::string d_keys;
+
+    // Key i is stored from d_offsets[i] up to d_offsets[i + 1].
+    std::vector<size_t> d_offsets;
+};
+
+inline size_t NameKeys::size() const
+{
+    return d_offsets.size() - 1;
+}
+
 }
 
 #endif // ALPINOCORPUS_NAME_COMPARE
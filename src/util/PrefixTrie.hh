@@ -0,0 +1,142 @@
+#ifndef ALPINOCORPUS_UTIL_PREFIXTRIE_HH
+#define ALPINOCORPUS_UTIL_PREFIXTRIE_HH
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace alpinocorpus { namespace util {
+
+/**
+ * A trie that maps strings to values, supporting longest-prefix lookups
+ * in time that is linear in the length of the string that is looked up.
+ */
+template <typename T>
+class PrefixTrie
+{
+public:
+    PrefixTrie();
+
+    /** Add a key, replacing the value if the key already exists. */
+    void insert(std::string const &key, T const &value);
+
+    /**
+     * Find the value of the longest key that is a prefix of <i>str</i>.
+     * Returns a null pointer if no key is a prefix of <i>str</i>. If
+     * <i>length</i> is not null, it is set to the length of the key.
+     */
+    T const *longestPrefix(std::string const &str, size_t *length = 0) const;
+
+    void clear();
+
+private:
+    struct Node
+    {
+        Node() : hasValue(false) {}
+
+        // Sorted by character, the second element is the node index.
+        std::vector<std::pair<char, size_t> > children;
+        bool hasValue;
+        T value;
+    };
+
+    size_t child(size_t node, char c) const;
+
+    std::vector<Node> d_nodes;
+};
+
+template <typename T>
+PrefixTrie<T>::PrefixTrie() : d_nodes(1)
+{
+}
+
+template <typename T>
+size_t PrefixTrie<T>::child(size_t node, char c) const
+{
+    std::vector<std::pair<char, size_t> > const &children =
+        d_nodes[node].children;
+
+    size_t lo = 0;
+    size_t hi = children.size();
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (children[mid].first < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo != children.size() && children[lo].first == c)
+        return children[lo].second;
+
+    return 0;
+}
+
+template <typename T>
+void PrefixTrie<T>::insert(std::string const &key, T const &value)
+{
+    size_t node = 0;
+    for (std::string::const_iterator iter = key.begin(); iter != key.end();
+            ++iter)
+    {
+        size_t next = child(node, *iter);
+        if (next == 0)
+        {
+            next = d_nodes.size();
+            d_nodes.push_back(Node());
+
+            std::vector<std::pair<char, size_t> > &children =
+                d_nodes[node].children;
+            typename std::vector<std::pair<char, size_t> >::iterator pos =
+                children.begin();
+            while (pos != children.end() && pos->first < *iter)
+                ++pos;
+            children.insert(pos, std::make_pair(*iter, next));
+        }
+
+        node = next;
+    }
+
+    d_nodes[node].hasValue = true;
+    d_nodes[node].value = value;
+}
+
+template <typename T>
+T const *PrefixTrie<T>::longestPrefix(std::string const &str,
+    size_t *length) const
+{
+    T const *match = d_nodes[0].hasValue ? &d_nodes[0].value : 0;
+    size_t matchLength = 0;
+
+    size_t node = 0;
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        node = child(node, str[i]);
+        if (node == 0)
+            break;
+
+        if (d_nodes[node].hasValue)
+        {
+            match = &d_nodes[node].value;
+            matchLength = i + 1;
+        }
+    }
+
+    if (match && length)
+        *length = matchLength;
+
+    return match;
+}
+
+template <typename T>
+void PrefixTrie<T>::clear()
+{
+    d_nodes.clear();
+    d_nodes.push_back(Node());
+}
+
+} } // namespace alpinocorpus::util
+
+#endif // ALPINOCORPUS_UTIL_PREFIXTRIE_HH
@@ -0,0 +1,75 @@
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "ThreadPool.hh"
+
+namespace alpinocorpus { namespace util {
+
+ThreadPool::ThreadPool(size_t nThreads) : d_stop(false)
+{
+    if (nThreads == 0)
+        nThreads = defaultSize();
+
+    for (size_t i = 0; i < nThreads; ++i)
+        d_threads.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stop = true;
+        d_tasks.clear();
+    }
+
+    d_cond.notify_all();
+
+    for (std::vector<std::thread>::iterator iter = d_threads.begin();
+            iter != d_threads.end(); ++iter)
+        iter->join();
+}
+
+size_t ThreadPool::defaultSize()
+{
+    size_t n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void ThreadPool::post(std::function<void()> const &task)
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_tasks.push_back(task);
+    }
+
+    d_cond.notify_one();
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(d_mutex);
+            d_cond.wait(lock, [this]() { return d_stop || !d_tasks.empty(); });
+
+            if (d_stop)
+                return;
+
+            task = d_tasks.front();
+            d_tasks.pop_front();
+        }
+
+        try {
+            task();
+        } catch (...) {
+            // Tasks are responsible for their own error reporting.
+        }
+    }
+}
+
+} } // namespace alpinocorpus::util
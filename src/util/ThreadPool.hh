@@ -0,0 +1,86 @@
+#ifndef ALPINOCORPUS_UTIL_THREADPOOL_HH
+#define ALPINOCORPUS_UTIL_THREADPOOL_HH
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace alpinocorpus { namespace util {
+
+/**
+ * A fixed-size pool of worker threads that execute tasks in FIFO order.
+ *
+ * Tasks that are still queued when the pool is destroyed are discarded,
+ * tasks that are running are allowed to finish.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * Construct a pool with the given number of threads. If the number
+     * of threads is zero, defaultSize() threads are used.
+     */
+    explicit ThreadPool(size_t nThreads);
+    ~ThreadPool();
+
+    /**
+     * Queue a task. Exceptions that escape the task are swallowed, tasks
+     * that can fail should report errors themselves.
+     */
+    void post(std::function<void()> const &task);
+
+    /**
+     * Queue a task, the result (or exception) is provided through the
+     * returned future.
+     */
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F f);
+
+    size_t size() const;
+
+    /** The number of hardware threads, or one if that is unknown. */
+    static size_t defaultSize();
+
+private:
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    void work();
+
+    std::vector<std::thread> d_threads;
+    std::deque<std::function<void()> > d_tasks;
+    std::mutex d_mutex;
+    std::condition_variable d_cond;
+    bool d_stop;
+};
+
+template <typename F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F f)
+{
+    typedef typename std::result_of<F()>::type Result;
+
+    // std::function requires copyable targets, packaged_task is move-only.
+    std::shared_ptr<std::packaged_task<Result()> > task(
+        new std::packaged_task<Result()>(f));
+    std::future<Result> result(task->get_future());
+
+    post([task]() { (*task)(); });
+
+    return result;
+}
+
+inline size_t ThreadPool::size() const
+{
+    return d_threads.size();
+}
+
+} } // namespace alpinocorpus::util
+
+#endif // ALPINOCORPUS_UTIL_THREADPOOL_HH
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AlpinoCorpus/CompactCorpusReader.hh>
+#include <AlpinoCorpus/CompactCorpusWriter.hh>
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/CorpusReaderFactory.hh>
+
+#include "compact_fixture.hh"
+
+namespace bf = boost::filesystem;
+
+typedef std::vector<std::pair<std::string, std::string> > Matches;
+
+static char const *queries[] = {
+  "//node[@cat=\"ti\"]",
+  "//node[@cat=\"du\" and @rel=\"--\"]",
+  "//node[@cat=\"ti\" or @word=\"Havelaar\"]",
+  "//node[@cat=\"smain\"]/node[@rel=\"su\"]",
+  "//node[@cat=\"np\"]//node[@pos=\"noun\"]",
+  "//node[@word=\"xyzzy\"]",
+  "//node[not(@cat=\"np\")]",
+  "//node[@pos]"
+};
+
+Matches matches(ac::CorpusReader const &corpus, std::string const &query,
+  ac::SortOrder sortOrder)
+{
+  Matches result;
+
+  ac::CorpusReader::EntryIterator iter =
+    corpus.query(ac::CorpusReader::XPATH, query, sortOrder);
+  while (iter.hasNext())
+  {
+    ac::Entry e = iter.next(corpus);
+    result.push_back(std::make_pair(e.name, e.contents));
+  }
+
+  return result;
+}
+
+bool check(bool ok, std::string const &what, std::string const &query)
+{
+  if (!ok)
+    std::cerr << what << " differs for " << query << std::endl;
+
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  std::unique_ptr<ac::CorpusReader> ref(
+    ac::CorpusReaderFactory::open(test_suite_path));
+
+  ac::CompactCorpusWriter::Options options;
+  options.indexedAttributes =
+    ac::CompactCorpusWriter::defaultIndexedAttributes();
+
+  TempCompactCorpus corpus;
+  corpus.write(*ref, options);
+
+  std::string dataPath = corpus.basename() + ".data.dz";
+  std::string attrIndexPath = corpus.basename() + ".index.attr";
+  if (!bf::is_regular_file(attrIndexPath))
+    return 1;
+
+  size_t nQueries = sizeof(queries) / sizeof(queries[0]);
+
+  // Results of queries on the candidates of the attribute index.
+  std::vector<Matches> indexed;
+  std::vector<Matches> indexedNumerical;
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    for (size_t i = 0; i < nQueries; ++i)
+    {
+      indexed.push_back(matches(reader, queries[i], ac::NaturalOrder));
+      indexedNumerical.push_back(matches(reader, queries[i],
+        ac::NumericalOrder));
+    }
+  }
+
+  // Without the attribute index, all entries are evaluated.
+  bf::remove(attrIndexPath);
+  ac::CompactCorpusReader reader(dataPath);
+
+  bool ok = true;
+  for (size_t i = 0; i < nQueries; ++i)
+  {
+    ok &= check(indexed[i] == matches(*ref, queries[i], ac::NaturalOrder),
+      "Directory corpus", queries[i]);
+    ok &= check(indexed[i] == matches(reader, queries[i], ac::NaturalOrder),
+      "Compact corpus without attribute index", queries[i]);
+    ok &= check(indexedNumerical[i] ==
+      matches(reader, queries[i], ac::NumericalOrder),
+      "Numerical order", queries[i]);
+  }
+
+  // The comparisons should not all be between empty results.
+  ok &= check(!indexed[0].empty(), "Number of matches", queries[0]);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+#include <memory>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <AlpinoCorpus/CompactCorpusReader.hh>
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/CorpusReaderFactory.hh>
+
+#include "compact_fixture.hh"
+
+namespace bf = boost::filesystem;
+
+int main(int argc, char *argv[])
+{
+  std::unique_ptr<ac::CorpusReader> ref(
+    ac::CorpusReaderFactory::open(test_suite_path));
+
+  TempCompactCorpus corpus;
+  corpus.write(*ref);
+
+  std::string dataPath = corpus.basename() + ".data.dz";
+  std::string binaryIndexPath = corpus.basename() + ".index.bin";
+  if (!bf::is_regular_file(binaryIndexPath))
+    return 1;
+
+  // Read through the binary index.
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    if (!sameEntries(*ref, reader))
+      return 1;
+  }
+
+  // A corrupt binary index is ignored, the text index is used instead.
+  bf::resize_file(binaryIndexPath, bf::file_size(binaryIndexPath) / 2);
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    if (!sameEntries(*ref, reader))
+      return 1;
+  }
+
+  // Read through the text index.
+  bf::remove(binaryIndexPath);
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    if (!sameEntries(*ref, reader))
+      return 1;
+  }
+
+  return 0;
+}
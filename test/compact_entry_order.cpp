@@ -0,0 +1,122 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AlpinoCorpus/CompactCorpusReader.hh>
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/CorpusReaderFactory.hh>
+#include <AlpinoCorpus/Entry.hh>
+
+#include "compact_fixture.hh"
+
+namespace bf = boost::filesystem;
+
+// Names in the order in which they are written.
+static char const *names[] = {
+  "b10.xml", "9.xml", "a.xml", "100.xml", "b9.xml", "01.xml", "b1.xml",
+  "10.xml"
+};
+
+// The same names in numerical order. Names that start with a letter
+// come before names that start with a number.
+static char const *numericalNames[] = {
+  "a.xml", "b1.xml", "b9.xml", "b10.xml", "01.xml", "9.xml", "10.xml",
+  "100.xml"
+};
+
+bool numericalOrderIsCorrect(ac::CorpusReader const &corpus,
+  std::vector<ac::Entry> const &entries)
+{
+  size_t nNames = sizeof(numericalNames) / sizeof(numericalNames[0]);
+
+  ac::CorpusReader::EntryIterator iter = corpus.entries(ac::NumericalOrder);
+  for (size_t i = 0; i < nNames; ++i)
+  {
+    if (!iter.hasNext())
+      return false;
+
+    ac::Entry e = iter.next(corpus);
+    if (e.name != numericalNames[i])
+      return false;
+
+    // The entry is still the one that was written under this name.
+    for (std::vector<ac::Entry>::const_iterator entry = entries.begin();
+        entry != entries.end(); ++entry)
+      if (entry->name == e.name && corpus.read(e.name) != entry->contents)
+        return false;
+  }
+
+  return !iter.hasNext();
+}
+
+int main(int argc, char *argv[])
+{
+  std::unique_ptr<ac::CorpusReader> ref(
+    ac::CorpusReaderFactory::open(test_suite_path));
+
+  std::vector<std::string> contents;
+  ac::CorpusReader::EntryIterator iter = ref->entries();
+  while (iter.hasNext())
+    contents.push_back(ref->read(iter.next(*ref).name));
+
+  std::vector<ac::Entry> entries;
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+  {
+    ac::Entry e = {names[i], contents[i % contents.size()]};
+    entries.push_back(e);
+  }
+
+  TempCompactCorpus corpus;
+  corpus.write(entries);
+
+  std::string dataPath = corpus.basename() + ".data.dz";
+  std::string orderPath = corpus.basename() + ".index.order";
+
+  bool ok = true;
+
+  // The order is computed and stored next to the index.
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    ok &= numericalOrderIsCorrect(reader, entries);
+  }
+
+  if (!bf::is_regular_file(orderPath))
+  {
+    std::cerr << "The order was not stored" << std::endl;
+    return 1;
+  }
+
+  // The stored order is used.
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    ok &= numericalOrderIsCorrect(reader, entries);
+  }
+
+  // A stored order that is older than the data is not used.
+  bf::last_write_time(orderPath, bf::last_write_time(dataPath) - 60);
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    ok &= numericalOrderIsCorrect(reader, entries);
+  }
+
+  if (bf::last_write_time(orderPath) < bf::last_write_time(dataPath))
+  {
+    std::cerr << "The outdated order was not replaced" << std::endl;
+    ok = false;
+  }
+
+  // A corrupt order is not used.
+  bf::resize_file(orderPath, bf::file_size(orderPath) / 2);
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    ok &= numericalOrderIsCorrect(reader, entries);
+  }
+
+  if (!ok)
+    std::cerr << "Entries are not in numerical order" << std::endl;
+
+  return ok ? 0 : 1;
+}
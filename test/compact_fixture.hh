@@ -0,0 +1,88 @@
+#ifndef ALPINOCORPUS_COMPACT_FIXTURE_TEST
+#define ALPINOCORPUS_COMPACT_FIXTURE_TEST
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AlpinoCorpus/CompactCorpusWriter.hh>
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/Entry.hh>
+
+namespace ac = alpinocorpus;
+
+// The reference corpus, relative to the source root.
+static std::string const test_suite_path = "test/test_suite";
+
+/**
+ * Compact corpus that is written to a temporary directory, which is
+ * removed again when the fixture is destructed.
+ */
+class TempCompactCorpus
+{
+public:
+  TempCompactCorpus() :
+    d_dir(boost::filesystem::temp_directory_path() /
+      boost::filesystem::unique_path("alpinocorpus-test-%%%%-%%%%-%%%%"))
+  {
+    boost::filesystem::create_directory(d_dir);
+  }
+
+  ~TempCompactCorpus()
+  {
+    boost::filesystem::remove_all(d_dir);
+  }
+
+  /** The corpus files are <basename>.data.dz, <basename>.index, etc. */
+  std::string basename() const
+  {
+    return (d_dir / "corpus").string();
+  }
+
+  void write(ac::CorpusReader const &corpus,
+    ac::CompactCorpusWriter::Options const &options =
+      ac::CompactCorpusWriter::Options())
+  {
+    ac::CompactCorpusWriter writer(basename(), options);
+    writer.write(corpus);
+  }
+
+  void write(std::vector<ac::Entry> const &entries,
+    ac::CompactCorpusWriter::Options const &options =
+      ac::CompactCorpusWriter::Options())
+  {
+    ac::CompactCorpusWriter writer(basename(), options);
+    for (std::vector<ac::Entry>::const_iterator iter = entries.begin();
+        iter != entries.end(); ++iter)
+      writer.write(iter->name, iter->contents);
+  }
+
+private:
+  TempCompactCorpus(TempCompactCorpus const &);
+  TempCompactCorpus &operator=(TempCompactCorpus const &);
+
+  boost::filesystem::path d_dir;
+};
+
+/** Do the corpora have the same entries, in the same order? */
+inline bool sameEntries(ac::CorpusReader const &ref,
+  ac::CorpusReader const &corpus)
+{
+  ac::CorpusReader::EntryIterator refIter = ref.entries();
+  ac::CorpusReader::EntryIterator iter = corpus.entries();
+  while (refIter.hasNext())
+  {
+    if (!iter.hasNext())
+      return false;
+
+    std::string name = refIter.next(ref).name;
+    if (iter.next(corpus).name != name ||
+        corpus.read(name) != ref.read(name))
+      return false;
+  }
+
+  return !iter.hasNext() && corpus.size() == ref.size();
+}
+
+#endif // ALPINOCORPUS_COMPACT_FIXTURE_TEST
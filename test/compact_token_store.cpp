@@ -0,0 +1,121 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AlpinoCorpus/CompactCorpusReader.hh>
+#include <AlpinoCorpus/CompactCorpusWriter.hh>
+#include <AlpinoCorpus/CorpusInfo.hh>
+#include <AlpinoCorpus/CorpusReader.hh>
+#include <AlpinoCorpus/CorpusReaderFactory.hh>
+#include <AlpinoCorpus/Token.hh>
+
+#include "compact_fixture.hh"
+
+namespace bf = boost::filesystem;
+
+typedef std::vector<std::vector<ac::Token> > CorpusTokens;
+
+// Stored attributes in another order, a subset, an attribute that is
+// absent from the test suite and an attribute that is not stored.
+static char const *attributeLists[][3] = {
+  {"word", "lemma", "pos"},
+  {"pos", "word", 0},
+  {"lemma", 0, 0},
+  {"root", "word", 0}
+};
+
+CorpusTokens corpusTokens(ac::CorpusReader const &corpus,
+  std::vector<std::string> const &attributes)
+{
+  ac::CorpusInfo corpusInfo = ac::predefinedCorpusOrFallback(corpus.type());
+
+  CorpusTokens result;
+
+  ac::CorpusReader::EntryIterator iter = corpus.entries();
+  while (iter.hasNext())
+    result.push_back(corpus.tokens(iter.next(corpus).name, attributes,
+      "_", corpusInfo));
+
+  return result;
+}
+
+bool sameTokens(CorpusTokens const &tokens1, CorpusTokens const &tokens2)
+{
+  if (tokens1.size() != tokens2.size())
+    return false;
+
+  for (size_t i = 0; i < tokens1.size(); ++i)
+  {
+    if (tokens1[i].size() != tokens2[i].size())
+      return false;
+
+    for (size_t j = 0; j < tokens1[i].size(); ++j)
+      if (tokens1[i][j].begin != tokens2[i][j].begin ||
+          tokens1[i][j].values != tokens2[i][j].values)
+        return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  std::unique_ptr<ac::CorpusReader> ref(
+    ac::CorpusReaderFactory::open(test_suite_path));
+
+  ac::CompactCorpusWriter::Options options;
+  options.tokenAttributes = ac::CompactCorpusWriter::defaultTokenAttributes();
+
+  TempCompactCorpus corpus;
+  corpus.write(*ref, options);
+
+  std::string dataPath = corpus.basename() + ".data.dz";
+  std::string tokenStorePath = corpus.basename() + ".index.tokens";
+  if (!bf::is_regular_file(tokenStorePath))
+    return 1;
+
+  size_t nLists = sizeof(attributeLists) / sizeof(attributeLists[0]);
+
+  std::vector<std::vector<std::string> > attributes;
+  for (size_t i = 0; i < nLists; ++i)
+  {
+    std::vector<std::string> list;
+    for (size_t j = 0; j < 3 && attributeLists[i][j] != 0; ++j)
+      list.push_back(attributeLists[i][j]);
+    attributes.push_back(list);
+  }
+
+  // Tokens from the token store.
+  std::vector<CorpusTokens> stored;
+  {
+    ac::CompactCorpusReader reader(dataPath);
+    for (size_t i = 0; i < nLists; ++i)
+      stored.push_back(corpusTokens(reader, attributes[i]));
+  }
+
+  // Without the token store, tokens are extracted from the entries.
+  bf::remove(tokenStorePath);
+  ac::CompactCorpusReader reader(dataPath);
+
+  bool ok = true;
+  for (size_t i = 0; i < nLists; ++i)
+  {
+    if (!sameTokens(stored[i], corpusTokens(*ref, attributes[i])) ||
+        !sameTokens(stored[i], corpusTokens(reader, attributes[i])))
+    {
+      std::cerr << "Tokens differ for attribute list " << i << std::endl;
+      ok = false;
+    }
+
+    if (stored[i].empty() || stored[i][0].empty())
+    {
+      std::cerr << "No tokens for attribute list " << i << std::endl;
+      ok = false;
+    }
+  }
+
+  return ok ? 0 : 1;
+}
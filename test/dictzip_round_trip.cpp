@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <zlib.h>
+
+#include "DzIstream.hh"
+#include "DzMappedReader.hh"
+#include "DzOstream.hh"
+
+namespace ac = alpinocorpus;
+namespace bf = boost::filesystem;
+
+namespace {
+
+// Text that compresses, but not to almost nothing.
+std::string testData(size_t size)
+{
+  std::string data;
+  data.reserve(size);
+
+  unsigned int state = 42;
+  while (data.size() < size)
+  {
+    state = state * 1103515245 + 12345;
+    data += "<node word=\"";
+    data += static_cast<char>('a' + (state >> 16) % 26);
+    data += std::to_string((state >> 8) % 1000);
+    data += "\"/>\n";
+  }
+
+  data.resize(size);
+  return data;
+}
+
+// Read the file as a plain gzip file.
+std::string gunzip(std::string const &filename)
+{
+  std::string data;
+
+  gzFile file = gzopen(filename.c_str(), "rb");
+  if (file == NULL)
+    return data;
+
+  char buf[16384];
+  int n;
+  while ((n = gzread(file, buf, sizeof(buf))) > 0)
+    data.append(buf, n);
+
+  gzclose(file);
+
+  return data;
+}
+
+bool roundTrip(std::string const &filename, std::string const &data,
+  size_t nThreads, bool singlePass)
+{
+  {
+    ac::DzOstream out(filename.c_str(), Z_BEST_COMPRESSION, nThreads,
+      singlePass);
+    out.write(data.data(), data.size());
+  }
+
+  bool ok = true;
+
+  ok &= gunzip(filename) == data;
+
+  {
+    ac::DzIstream in(filename.c_str());
+    std::string read((std::istreambuf_iterator<char>(in)),
+      std::istreambuf_iterator<char>());
+    ok &= read == data;
+
+    // Seek across chunk boundaries.
+    for (size_t offset = 0; offset + 1000 <= data.size(); offset += 40009)
+    {
+      std::string buf(1000, '\0');
+      in.clear();
+      in.seekg(offset);
+      in.read(&buf[0], buf.size());
+      ok &= buf == data.substr(offset, buf.size());
+    }
+  }
+
+  std::shared_ptr<ac::DzMappedReader const> reader(
+    new ac::DzMappedReader(filename));
+
+  ok &= reader->read(0, data.size()) == data;
+
+  for (size_t offset = 0; offset + 1000 <= data.size(); offset += 40009)
+    ok &= reader->read(offset, 1000) == data.substr(offset, 1000);
+
+  // Sequential reads with gaps, followed by a read before the current
+  // position, which goes through the random access reader.
+  {
+    ac::DzMappedScanner scanner(reader);
+    for (size_t offset = 0; offset + 1000 <= data.size(); offset += 1500)
+      ok &= scanner.read(offset, 1000) == data.substr(offset, 1000);
+
+    ok &= scanner.read(0, data.size()) == data;
+  }
+
+  if (!ok)
+    std::cerr << "round trip failed for " << data.size() << " bytes, " <<
+      nThreads << " thread(s), single pass: " << singlePass << std::endl;
+
+  return ok;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::string filename = (bf::temp_directory_path() /
+    bf::unique_path("alpinocorpus-test-%%%%-%%%%-%%%%.dz")).string();
+
+  // Sizes are: no chunks, a partial chunk, and many chunks.
+  size_t const sizes[] = {0, 1000, 2 * 1024 * 1024};
+
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+  {
+    std::string data = testData(sizes[i]);
+    ok &= roundTrip(filename, data, 1, false);
+    ok &= roundTrip(filename, data, 1, true);
+    ok &= roundTrip(filename, data, 4, false);
+    ok &= roundTrip(filename, data, 4, true);
+  }
+
+  std::remove(filename.c_str());
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util/NameCompare.hh"
+
+namespace ac = alpinocorpus;
+
+namespace {
+
+// The name comparison before sort keys were introduced. Names are split
+// in runs of digits and single other characters. A name that starts with
+// another character gets an empty first component. Runs of digits are
+// compared by their value, other components as strings.
+
+bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+std::vector<std::string> components(std::string const &name)
+{
+  std::vector<std::string> result;
+  if (name.empty())
+    return result;
+
+  std::string cur;
+  bool prevIsDigit = isDigit(name[0]);
+  for (std::string::const_iterator iter = name.begin(); iter != name.end();
+      ++iter)
+  {
+    bool curIsDigit = isDigit(*iter);
+    if (curIsDigit && prevIsDigit)
+      cur += *iter;
+    else
+    {
+      result.push_back(cur);
+      cur = *iter;
+    }
+
+    prevIsDigit = curIsDigit;
+  }
+
+  result.push_back(cur);
+
+  return result;
+}
+
+// Compare the values of two runs of digits of arbitrary length.
+int compareNumbers(std::string const &n1, std::string const &n2)
+{
+  std::string::size_type b1 = std::min(n1.find_first_not_of('0'), n1.size());
+  std::string::size_type b2 = std::min(n2.find_first_not_of('0'), n2.size());
+
+  if (n1.size() - b1 != n2.size() - b2)
+    return n1.size() - b1 < n2.size() - b2 ? -1 : 1;
+
+  return n1.compare(b1, std::string::npos, n2, b2, std::string::npos);
+}
+
+bool oldNameCompare(std::string const &s1, std::string const &s2)
+{
+  std::vector<std::string> i1 = components(s1);
+  std::vector<std::string> i2 = components(s2);
+
+  for (size_t i = 0; i < i1.size() && i < i2.size(); ++i)
+  {
+    if (!i1[i].empty() && isDigit(i1[i][0]) &&
+        !i2[i].empty() && isDigit(i2[i][0]))
+    {
+      int r = compareNumbers(i1[i], i2[i]);
+      if (r != 0)
+        return r < 0;
+    }
+    else if (i1[i] != i2[i])
+      return i1[i] < i2[i];
+  }
+
+  return i1.size() < i2.size();
+}
+
+std::vector<std::string> testNames()
+{
+  std::vector<std::string> names;
+
+  // Numbers with leading zeros.
+  names.push_back("1");
+  names.push_back("01");
+  names.push_back("001");
+  names.push_back("0");
+  names.push_back("00");
+  names.push_back("2");
+  names.push_back("10");
+  names.push_back("9.xml");
+  names.push_back("10.xml");
+  names.push_back("010.xml");
+
+  // Names that start with a letter or another character.
+  names.push_back("");
+  names.push_back("a");
+  names.push_back("b");
+  names.push_back("1a");
+  names.push_back("01a");
+  names.push_back("-1");
+  names.push_back(" 1");
+  names.push_back("a.xml");
+
+  // Component prefixes.
+  names.push_back("a1");
+  names.push_back("a01");
+  names.push_back("a1b");
+  names.push_back("a1b2");
+  names.push_back("a1b10");
+  names.push_back("a2");
+  names.push_back("a9");
+  names.push_back("a10");
+  names.push_back("a10b");
+  names.push_back("a1-1");
+  names.push_back("a1.1");
+
+  // Runs of 255 digits or more, which have a longer length in the key.
+  names.push_back("a" + std::string(254, '9'));
+  names.push_back("a" + std::string(255, '9'));
+  names.push_back("a1" + std::string(255, '0'));
+  names.push_back("a00" + std::string(255, '9'));
+  names.push_back("a" + std::string(300, '7') + "b");
+  names.push_back("a" + std::string(300, '7') + "1");
+  names.push_back(std::string(256, '1'));
+
+  // Bytes outside ASCII.
+  names.push_back("\xc3\xa9");
+  names.push_back("a\xc3\xa9");
+  names.push_back("a\xc3\xa9" "1");
+  names.push_back("a\xff");
+  names.push_back("1\xc3\xa9");
+  names.push_back("\x7f");
+
+  return names;
+}
+
+bool check(bool ok, std::string const &what, std::string const &s1,
+  std::string const &s2)
+{
+  if (!ok)
+    std::cerr << what << " differs for '" << s1 << "' and '" << s2 << "'" <<
+      std::endl;
+
+  return ok;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::string> names = testNames();
+
+  ac::NameCompare nameCompare;
+
+  bool ok = true;
+  for (std::vector<std::string>::const_iterator i1 = names.begin();
+      i1 != names.end(); ++i1)
+    for (std::vector<std::string>::const_iterator i2 = names.begin();
+        i2 != names.end(); ++i2)
+    {
+      bool expected = oldNameCompare(*i1, *i2);
+      ok &= check(nameCompare(*i1, *i2) == expected, "NameCompare", *i1, *i2);
+      ok &= check((ac::nameKey(*i1) < ac::nameKey(*i2)) == expected,
+        "nameKey", *i1, *i2);
+    }
+
+  // Sorting through the keys is stable, like sorting with the old
+  // comparator. Equal names ("1", "01") keep their order.
+  ac::NameKeys keys;
+  std::vector<uint32_t> expected;
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    keys.push_back(names[i]);
+    expected.push_back(i);
+  }
+
+  std::stable_sort(expected.begin(), expected.end(),
+    [&names](uint32_t a, uint32_t b) {
+      return oldNameCompare(names[a], names[b]);
+    });
+
+  if (keys.order() != expected)
+  {
+    std::cerr << "NameKeys::order() differs from the old order" << std::endl;
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
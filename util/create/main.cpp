@@ -45,10 +45,15 @@ void usage(std::string const &programName)
       std::endl << std::endl <<
       "  -c filename\tCreate a compact corpus archive" << std::endl <<
       "  -d filename\tCreate a Dact dbxml archive" << std::endl <<
+      "  -i\t\tWrite an attribute index for a compact corpus" << std::endl <<
+      "  -j threads\tCompress a compact corpus using multiple threads (0: all cores)" << std::endl <<
+      "  -l level\tCompression level of a compact corpus (0-9)" << std::endl <<
       "  -m filename\tLoad macro file" << std::endl <<
       "  -n\t\tUse numerical sorting (when available)" << std::endl <<
       "  -q query\tFilter the treebank using the given query" << std::endl <<
-      "  -r\t\tProcess a directory of corpora recursively" << std::endl << std::endl;
+      "  -r\t\tProcess a directory of corpora recursively" << std::endl <<
+      "  -s\t\tWrite a compact corpus in a single pass, without a temporary file" << std::endl <<
+      "  -t\t\tWrite a token store for a compact corpus" << std::endl << std::endl;
 }
 
 void writeCorpus(std::shared_ptr<CorpusReader> reader,
@@ -58,7 +63,7 @@ void writeCorpus(std::shared_ptr<CorpusReader> reader,
 {
   CorpusReader::EntryIterator i;
   if (query.empty())
-    i = reader->entries(sortOrder);
+    i = reader->entriesWithContents(sortOrder);
   else
     i = reader->query(CorpusReader::XPATH, query, sortOrder);
   
@@ -69,7 +74,7 @@ void writeCorpus(std::shared_ptr<CorpusReader> reader,
     Entry e = i.next(*reader);
 
     if (seen.find(e.name) == seen.end()) {
-        writer->write(e.name, reader->read(e.name));
+        writer->write(e.name, i.hasContents() ? e.contents : reader->read(e.name));
         seen.insert(e.name);
     } else
       std::cerr << "Duplicate entry: " << e.name << std::endl;
@@ -81,7 +86,7 @@ int main(int argc, char *argv[])
   std::unique_ptr<ProgramOptions> opts;
   try {
     opts.reset(new ProgramOptions(argc, const_cast<char const **>(argv),
-      "c:d:m:nq:r"));
+      "c:d:ij:l:m:nq:rst"));
   } catch (std::exception &e) {
     std::cerr << e.what() << std::endl;
     return 1;
@@ -107,6 +112,37 @@ int main(int argc, char *argv[])
     return 1;
   }
 
+  CompactCorpusWriter::Options writerOptions;
+  if (opts->option('j')) {
+    try {
+      writerOptions.nThreads = std::stoul(opts->optionValue('j'));
+    } catch (std::logic_error const &) {
+      std::cerr << "Invalid number of threads: " << opts->optionValue('j') << std::endl;
+      return 1;
+    }
+  }
+
+  if (opts->option('l')) {
+    try {
+      writerOptions.compressionLevel = std::stoi(opts->optionValue('l'));
+    } catch (std::logic_error const &) {
+      writerOptions.compressionLevel = -1;
+    }
+
+    if (writerOptions.compressionLevel < 0 || writerOptions.compressionLevel > 9) {
+      std::cerr << "Invalid compression level: " << opts->optionValue('l') << std::endl;
+      return 1;
+    }
+  }
+
+  writerOptions.singlePass = opts->option('s');
+  if (opts->option('i'))
+    writerOptions.indexedAttributes =
+      CompactCorpusWriter::defaultIndexedAttributes();
+  if (opts->option('t'))
+    writerOptions.tokenAttributes =
+      CompactCorpusWriter::defaultTokenAttributes();
+
   SortOrder sortOrder = NaturalOrder;
   if (opts->option('n')) {
       sortOrder = NumericalOrder;
@@ -183,7 +219,8 @@ int main(int argc, char *argv[])
           if (bf::equivalent(outIndex, *iter) || bf::equivalent(outDataDz, *iter))
             throw std::runtime_error("Attempting to write to the source treebank.");
   
-        std::shared_ptr<CorpusWriter> wr(new CompactCorpusWriter(treebankOut));
+        std::shared_ptr<CorpusWriter> wr(new CompactCorpusWriter(treebankOut,
+          writerOptions));
         writeCorpus(reader, wr, query, sortOrder);
 
     } catch (std::runtime_error const &e) {
@@ -6,6 +6,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <AlpinoCorpus/CorpusReader.hh>
 #include <AlpinoCorpus/macros.hh>
@@ -18,7 +19,7 @@ using alpinocorpus::CorpusReader;
 using alpinocorpus::Either;
 
 void usage(std::string const &programName) {
-    std::cerr << "Usage: " << programName << " treebank entry" <<
+    std::cerr << "Usage: " << programName << " treebank entry [entry ...]" <<
       std::endl << std::endl <<
       "  -a attribute\tAttribute for marking (default: active)" << std::endl <<
       "  -m filename\tLoad macro file" << std::endl <<
@@ -83,6 +84,22 @@ int main(int argc, char *argv[]) {
         markerQueries.push_back(CorpusReader::MarkerQuery(query, attribute, value));
     }
 
-    std::cout << reader->read(opts->arguments().at(1), markerQueries);
+    std::vector<std::string> entries(opts->arguments().begin() + 1,
+        opts->arguments().end());
+
+    try {
+        if (markerQueries.empty()) {
+            std::vector<std::string> contents(reader->readMany(entries));
+            for (std::vector<std::string>::const_iterator iter = contents.begin();
+                    iter != contents.end(); ++iter)
+                std::cout << *iter;
+        } else
+            for (std::vector<std::string>::const_iterator iter = entries.begin();
+                    iter != entries.end(); ++iter)
+                std::cout << reader->read(*iter, markerQueries);
+    } catch (std::runtime_error &e) {
+        std::cerr << "Could not read entry: " << e.what() << std::endl;
+        return 1;
+    }
 
 }
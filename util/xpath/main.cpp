@@ -1,11 +1,13 @@
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -16,7 +18,7 @@
 #include <AlpinoCorpus/MultiCorpusReader.hh>
 #include <AlpinoCorpus/util/Either.hh>
 
-#include <AlpinoCorpus/LexItem.hh>
+#include <AlpinoCorpus/Sentence.hh>
 #include <AlpinoCorpus/macros.hh>
 
 #include <EqualsPrevious.hh>
@@ -27,16 +29,21 @@ using alpinocorpus::CorpusInfo;
 using alpinocorpus::CorpusReader;
 using alpinocorpus::Either;
 using alpinocorpus::Entry;
-using alpinocorpus::LexItem;
+using alpinocorpus::Sentence;
 
 namespace bf = boost::filesystem;
 
-template<typename T>
-std::set<T> unique_to_first(std::set<T> const &a, std::set<T> const &b)
+// Number of entries for which sentences are retrieved at once.
+size_t const SENTENCE_BATCH_SIZE = 64;
+
+// The match ids of the first item that the second item does not have.
+std::vector<size_t> unique_to_first(Sentence const &sentence, size_t a,
+    size_t b)
 {
-  std::set<T> result;
-  std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
-      std::inserter(result, result.begin()));
+  std::vector<size_t> result;
+  std::set_difference(sentence.matchesBegin(a), sentence.matchesEnd(a),
+      sentence.matchesBegin(b), sentence.matchesEnd(b),
+      std::back_inserter(result));
   return result;
 }
 
@@ -55,83 +62,117 @@ void output_depth_color(size_t depth) {
     std::cout << "\033[38;5;119m";
 }
 
+void printSentence(Sentence const &sentence, bool colorBrackets)
+{
+  for (size_t i = 0; i < sentence.size(); ++i)
+  {
+    // Find the set of matches starting before the current word.
+    std::vector<size_t> startAtCurrent;
+    if (i == 0)
+      startAtCurrent.assign(sentence.matchesBegin(i), sentence.matchesEnd(i));
+    else
+      startAtCurrent = unique_to_first(sentence, i, i - 1);
+
+    if (colorBrackets) {
+      if (startAtCurrent.size() != 0) {
+        output_depth_color(sentence.nMatches(i));
+      }
+    } else {
+      for (std::vector<size_t>::const_iterator iter = startAtCurrent.begin();
+          iter != startAtCurrent.end(); ++iter) {
+        std::cout << *iter << ":[ ";
+      }
+    }
+
+    std::cout.write(sentence.wordData(i), sentence.wordSize(i));
+
+    // Find the set of matches ending after the current word.
+    bool hasNext = i + 1 != sentence.size();
+    std::vector<size_t> endAtCurrent;
+    if (hasNext)
+      endAtCurrent = unique_to_first(sentence, i, i + 1);
+    else
+      endAtCurrent.assign(sentence.matchesBegin(i), sentence.matchesEnd(i));
+
+    if (colorBrackets) {
+      if (hasNext && endAtCurrent.size() != 0) {
+        std::cout << "\033[0;22m";
+      } 
+    } else {
+      for (std::vector<size_t>::const_iterator iter = endAtCurrent.begin();
+          iter != endAtCurrent.end(); ++iter)
+        std::cout << " ]";
+    }
+
+    std::cout << " ";
+  }
+}
+
+// Sentences are retrieved in batches, so that the corpus reader can read
+// the entries efficiently and compile the query once.
+void printSentences(std::shared_ptr<CorpusReader> reader,
+  std::vector<std::string> const &names,
+  std::string const &query,
+  bool colorBrackets,
+  std::string const &attribute,
+  CorpusInfo const &corpusInfo)
+{
+  std::vector<Sentence> sentences = reader->compactSentences(names,
+    query, attribute, "_missing_", corpusInfo);
+
+  for (size_t i = 0; i < names.size(); ++i) {
+    std::cout << names[i] << " ";
+    printSentence(sentences[i], colorBrackets);
+    std::cout << std::endl;
+  }
+}
+
 void listCorpus(std::shared_ptr<CorpusReader> reader,
   std::string const &query,
   bool bracketed,
   bool colorBrackets,
   std::string const &attribute,
-  CorpusInfo const &corpusInfo)
+  CorpusInfo const &corpusInfo,
+  size_t nThreads,
+  bool preserveOrder)
 {
   CorpusReader::EntryIterator i;
   
   if (query.empty())
     i = reader->entries();
+  else if (nThreads != 1)
+    i = reader->parallelQuery(query, nThreads, preserveOrder);
   else
     i = reader->query(CorpusReader::XPATH, query);
 
   NotEqualsPrevious<std::string> pred;
 
   std::unordered_set<std::string> seen;
+  std::vector<std::string> pending;
   while (i.hasNext())
   {
     Entry entry = i.next(*reader);
-    if (seen.find(entry.name) == seen.end()) {
-      std::cout << entry.name;
-
-      if (bracketed) {
-        std::cout << " ";
-
-        std::vector<LexItem> items = reader->sentence(entry.name, query,
-            attribute, "_missing_", corpusInfo);
-
-        std::set<size_t> prevMatches = std::set<size_t>();
-        for (std::vector<LexItem>::const_iterator itemIter = items.begin();
-          itemIter != items.end(); ++itemIter)
-        {
-          // Find the set of matches starting before the current word.
-          std::set<size_t> startAtCurrent = unique_to_first(itemIter->matches,
-              prevMatches);
-
-          if (colorBrackets) {
-            if (startAtCurrent.size() != 0) {
-              output_depth_color(itemIter->matches.size());
-            }
-          } else {
-            for (std::set<size_t>::const_iterator iter = startAtCurrent.begin();
-                iter != startAtCurrent.end(); ++iter) {
-              std::cout << *iter << ":[ ";
-            }
-          }
-
-          std::cout << itemIter->word;
-
-          // Find the set of matches ending after the current word.
-          std::vector<LexItem>::const_iterator next = itemIter + 1;
-          std::set<size_t> endAtCurrent = itemIter->matches;
-          if (next != items.end()) {
-            endAtCurrent = unique_to_first(itemIter->matches, next->matches);
-          }
-
-          if (colorBrackets) {
-            if (next != items.end() && endAtCurrent.size() != 0) {
-              std::cout << "\033[0;22m";
-            } 
-          } else {
-            for (std::set<size_t>::const_iterator iter = endAtCurrent.begin();
-                iter != endAtCurrent.end(); ++iter)
-              std::cout << " ]";
-          }
-
-          std::cout << " ";
-
-          prevMatches = itemIter->matches;
-        }
-      }
+    if (seen.find(entry.name) != seen.end())
+      continue;
+
+    seen.insert(entry.name);
 
-      std::cout << std::endl;
-      seen.insert(entry.name);
+    if (!bracketed) {
+      std::cout << entry.name << std::endl;
+      continue;
+    }
+
+    pending.push_back(entry.name);
+    if (pending.size() == SENTENCE_BATCH_SIZE) {
+      printSentences(reader, pending, query, colorBrackets, attribute,
+        corpusInfo);
+      pending.clear();
     }
   }
+
+  if (!pending.empty())
+    printSentences(reader, pending, query, colorBrackets, attribute,
+      corpusInfo);
 }
 
 void usage(std::string const &programName)
@@ -140,9 +181,12 @@ void usage(std::string const &programName)
       std::endl << std::endl <<
       "  -a attr\tLexical attribute to show (default: word)" << std::endl <<
       "  -c\t\tUse colored bracketing" << std::endl <<
+      "  -j threads\tEvaluate the query using multiple threads (0: all cores)" << std::endl <<
       "  -m filename\tLoad macro file" << std::endl <<
+      "  -p depth\tRead up to depth entries ahead on a background thread" << std::endl <<
       "  -q query\tFilter the treebank using the given query" << std::endl <<
-      "  -s\t\tInclude a bracketed sentence" << std::endl << std::endl;
+      "  -s\t\tInclude a bracketed sentence" << std::endl <<
+      "  -u\t\tDo not preserve the corpus order with multiple threads" << std::endl << std::endl;
 }
 
 int main(int argc, char *argv[])
@@ -150,7 +194,7 @@ int main(int argc, char *argv[])
   std::unique_ptr<ProgramOptions> opts;
   try {
     opts.reset(new ProgramOptions(argc, const_cast<char const **>(argv),
-      "a:cm:q:s"));
+      "a:cj:m:p:q:su"));
   } catch (std::exception &e) {
     std::cerr << e.what() << std::endl;
     return 1;
@@ -202,8 +246,28 @@ int main(int argc, char *argv[])
     }
   }
   
+  size_t nThreads = 1;
+  if (opts->option('j')) {
+    try {
+      nThreads = std::stoul(opts->optionValue('j'));
+    } catch (std::logic_error &e) {
+      std::cerr << "Invalid number of threads: " << opts->optionValue('j') << std::endl;
+      return 1;
+    }
+  }
+
+  if (opts->option('p')) {
+    try {
+      CorpusReader::setPrefetchLimits(std::stoul(opts->optionValue('p')));
+    } catch (std::logic_error &e) {
+      std::cerr << "Invalid prefetch depth: " << opts->optionValue('p') << std::endl;
+      return 1;
+    }
+  }
+
   try {
-      listCorpus(reader, query, opts->option('s'), opts->option('c'), attr, corpusInfo);
+      listCorpus(reader, query, opts->option('s'), opts->option('c'), attr,
+        corpusInfo, nThreads, !opts->option('u'));
   } catch (std::runtime_error const &e) {
       std::cerr << opts->programName() <<
       ": error listing treebank: " << e.what() << std::endl;
@@ -24,7 +24,8 @@ using alpinocorpus::CorpusReader;
 using alpinocorpus::Either;
 
 void transformCorpus(std::shared_ptr<CorpusReader> reader,
-  std::string const &query, std::string const &stylesheetFilename)
+  std::string const &query, std::string const &stylesheetFilename,
+  size_t nThreads)
 {
     std::list<CorpusReader::MarkerQuery> markerQueries;
     if (!query.empty()) {
@@ -39,9 +40,12 @@ void transformCorpus(std::shared_ptr<CorpusReader> reader,
 
     if (!query.empty())
         i = reader->queryWithStylesheet(CorpusReader::XPATH, query,
-            *parsedStylesheet, markerQueries);
+            *parsedStylesheet, markerQueries, alpinocorpus::NaturalOrder,
+            nThreads);
     else
-        i = reader->entriesWithStylesheet(*parsedStylesheet);
+        i = reader->entriesWithStylesheet(*parsedStylesheet,
+            std::list<CorpusReader::MarkerQuery>(), alpinocorpus::NaturalOrder,
+            nThreads);
 
     std::unordered_set<std::string> seen;
 
@@ -77,7 +81,9 @@ void usage(std::string const &programName)
     std::cerr << "Usage: " << programName << " [OPTION] stylesheet treebanks" <<
       std::endl << std::endl <<
       "  -g entry\tApply the stylesheet to a single entry" << std::endl <<
+      "  -j threads\tApply the stylesheet using the given number of threads" << std::endl <<
       "  -m filename\tLoad macro file" << std::endl <<
+      "  -p depth\tRead up to depth entries ahead on a background thread" << std::endl <<
       "  -q query\tFilter the treebank using the given query" << std::endl << std::endl;
 }
 
@@ -95,7 +101,7 @@ int main (int argc, char *argv[])
   std::unique_ptr<ProgramOptions> opts;
   try {
     opts.reset(new ProgramOptions(argc, const_cast<char const **>(argv),
-      "g:m:q:"));
+      "g:j:m:p:q:"));
   } catch (std::exception &e) {
     std::cerr << e.what() << std::endl;
     return 1;
@@ -146,11 +152,30 @@ int main (int argc, char *argv[])
     }
   }
 
+  size_t nThreads = 1;
+  if (opts->option('j')) {
+    try {
+      nThreads = std::stoul(opts->optionValue('j'));
+    } catch (std::logic_error &e) {
+      std::cerr << "Invalid number of threads: " << opts->optionValue('j') << std::endl;
+      return 1;
+    }
+  }
+
+  if (opts->option('p')) {
+    try {
+      CorpusReader::setPrefetchLimits(std::stoul(opts->optionValue('p')));
+    } catch (std::logic_error &e) {
+      std::cerr << "Invalid prefetch depth: " << opts->optionValue('p') << std::endl;
+      return 1;
+    }
+  }
+
   try {
     if (opts->option('g'))
       transformEntry(reader, query, stylesheetFilename, opts->optionValue('g'));
     else
-      transformCorpus(reader, query, stylesheetFilename);
+      transformCorpus(reader, query, stylesheetFilename, nThreads);
   } catch (std::runtime_error &e) {
     std::cerr << "Error while transforming corpus: " << e.what() << std::endl;
     return 1;